@@ -5,7 +5,9 @@
 //Project includes
 #include "Renderer.h"
 #include "Maths.h"
+#include "PerfCounters.h"
 #include "Texture.h"
+#include "Trace.h"
 #include "Utils.h"
 #include <iostream>
 
@@ -90,6 +92,7 @@ void Renderer::Update(Timer* pTimer)
 
 void Renderer::Render()
 {
+	TRACE_SCOPE("Renderer::Render");
 	//@START
 	//Lock BackBuffer
 	SDL_LockSurface(m_pBackBuffer);
@@ -118,6 +121,7 @@ void Renderer::Render()
 	//@END
 	//Update SDL Surface
 	SDL_UnlockSurface(m_pBackBuffer);
+	TRACE_SCOPE("Present");
 	SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
 	SDL_UpdateWindowSurface(m_pWindow);
 }
@@ -165,7 +169,14 @@ void Renderer::Final()
 	for (auto& mesh : meshes_world)
 	{
 		// Apply the world-view-projection matrix
-		VertexTransformationFunction(mesh.vertices, mesh.vertices_out, mesh.worldMatrix); // worldViewProjectionMatrix = worldmatrix * viewMatrix * projectionMatrix
+		{
+			TRACE_SCOPE("Vertex transform");
+			const PerfStageScope vertexScope{ PerfStage::Vertex };
+			VertexTransformationFunction(mesh.vertices, mesh.vertices_out, mesh.worldMatrix); // worldViewProjectionMatrix = worldmatrix * viewMatrix * projectionMatrix
+		}
+		// Clearing the buffers and every triangle of the mesh, up to the end of this iteration
+		TRACE_SCOPE("Raster");
+		const PerfStageScope rasterScope{ PerfStage::Raster };
 
 		// Initialize the depth buffer and back buffer
 		std::vector<float> depthBuffer(m_Width * m_Height, std::numeric_limits<float>::infinity());
@@ -185,6 +196,8 @@ void Renderer::Final()
 		// Process triangles as TriangleList
 		for (size_t i = 0; i < mesh.indices.size(); i += 3) // Each triangle
 		{
+			// Counters switch stage per pixel in a sample of the triangles only
+			const PerfBatchScope triangleScope{ PerfStage::Raster };
 			int idx0 = mesh.indices[i], idx1 = mesh.indices[i + 1], idx2 = mesh.indices[i + 2];
 
 			const Vertex_Out& v0 = mesh.vertices_out[idx0];
@@ -258,6 +271,7 @@ void Renderer::Final()
 							if (!m_Buffer)
 							{
 								// Normal pixel shading (apply lighting, textures, etc.)
+								const PerfStageScope shadeScope{ PerfStage::Shade };
 								Vertex_Out pixelOut;
 
 								pixelOut.color = m_ptexture->Sample(uv);
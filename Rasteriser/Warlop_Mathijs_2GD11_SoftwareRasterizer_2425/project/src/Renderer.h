@@ -19,6 +19,16 @@ namespace dae
 	class Timer;
 	class Scene;
 
+	//Where the time goes, for PerfCounters; everything outside a PerfStageScope is Other
+	enum class PerfStage : uint32_t
+	{
+		Other,
+		Vertex, //transforming a mesh's vertices to screen space
+		Raster, //clearing, bounding boxes, barycentrics and the depth test
+		Shade //texture sampling and pixel shading of the pixels that pass the depth test
+	};
+	inline constexpr const char* g_PerfStageNames[]{ "other", "vertex", "raster", "shade" };
+
 	class Renderer final
 	{
 	public:
@@ -8,10 +8,13 @@
 
 //Standard includes
 #include <iostream>
+#include <string>
 
 //Project includes
 #include "Timer.h"
+#include "PerfCounters.h"
 #include "Renderer.h"
+#include "Trace.h"
 
 using namespace dae;
 
@@ -21,12 +24,31 @@ void ShutDown(SDL_Window* pWindow)
 	SDL_Quit();
 }
 
+//F11 starts a recording, the next F11 writes it as a trace for Perfetto
+void ToggleTrace()
+{
+	if (!Trace::IsRecording())
+	{
+		Trace::Start();
+		std::cout << "Recording trace, F11 again to write it" << std::endl;
+		return;
+	}
+
+	const std::string filename{ "Rasterizer_Trace.json" };
+	if (Trace::Stop(filename))
+		std::cout << "Trace written to " << filename << ", open it in Perfetto" << std::endl;
+	else
+		std::cout << "Could not write " << filename << std::endl;
+}
+
 int main(int argc, char* args[])
 {
 	//Unreferenced parameters
 	(void)argc;
 	(void)args;
 
+	Trace::SetThreadName("Main");
+
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
 
@@ -75,6 +97,16 @@ int main(int argc, char* args[])
 					pRenderer->ToggleNormal();
 				if (e.key.keysym.scancode == SDL_SCANCODE_F7)
 					pRenderer->ToggleLightingMode();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F11)
+					ToggleTrace();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+				{
+					//Counts per stage are printed with the FPS every second
+					if (PerfCounters::IsEnabled())
+						PerfCounters::Disable();
+					else if (PerfCounters::Enable(g_PerfStageNames))
+						PerfCounters::Collect();
+				}
 				else if (e.key.keysym.scancode == SDL_SCANCODE_X)
 					takeScreenshot = true;
 				break;
@@ -82,7 +114,10 @@ int main(int argc, char* args[])
 		}
 
 		//--------- Update ---------
-		pRenderer->Update(pTimer);
+		{
+			TRACE_SCOPE("Renderer::Update");
+			pRenderer->Update(pTimer);
+		}
 
 		//--------- Render ---------
 		pRenderer->Render();
@@ -94,6 +129,8 @@ int main(int argc, char* args[])
 		{
 			printTimer = 0.f;
 			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+			if (PerfCounters::IsEnabled())
+				PerfCounters::WriteReport(std::cout, PerfCounters::Collect());
 		}
 
 		//Save screenshot after full render
@@ -107,6 +144,8 @@ int main(int argc, char* args[])
 		}
 	}
 	pTimer->Stop();
+	if (Trace::IsRecording())
+		ToggleTrace();
 
 	//Shutdown "framework"
 	delete pRenderer;
@@ -0,0 +1,218 @@
+#include <benchmark/benchmark.h>
+#include "../src/AssetCache.h"
+#include "../src/Scene.h"
+#include "../src/Utils.h"
+
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	//Every kernel runs over the same fixed rays, so numbers from different runs and machines compare
+	constexpr int g_AmountOfRays{ 4096 };
+	constexpr uint32_t g_Seed{ 1234 };
+
+	enum class RayPattern
+	{
+		Coherent, //camera rays through a 64x64 block of neighbouring pixels, like a tile of the renderer
+		Incoherent //random origins around the camera, random directions, like bounce or shadow rays
+	};
+
+	//Camera rays exactly as Renderer::RenderPixel builds them for a 640x480 frame
+	std::vector<Ray> CreateRays(RayPattern pattern, Camera camera)
+	{
+		std::vector<Ray> rays{};
+		rays.reserve(g_AmountOfRays);
+
+		const Matrix cameraToWorld = camera.CalculateCameraToWorld();
+		if (pattern == RayPattern::Coherent)
+		{
+			constexpr int width{ 640 }, height{ 480 }, blockSize{ 64 };
+			const float aspectRatio = static_cast<float>(width) / height;
+			const float fov = tan(camera.fovAngle / 2);
+			for (int py{ (height - blockSize) / 2 }; py < (height + blockSize) / 2; ++py)
+			{
+				for (int px{ (width - blockSize) / 2 }; px < (width + blockSize) / 2; ++px)
+				{
+					const float cx = ((2 * ((px + 0.5f) / float(width))) - 1) * aspectRatio * fov;
+					const float cy = (1 - 2 * ((py + 0.5f) / float(height))) * fov;
+					rays.emplace_back(Ray{ camera.origin, cameraToWorld.TransformVector(Vector3{ cx, cy, 1 }).Normalized() });
+				}
+			}
+			return rays;
+		}
+
+		std::mt19937 engine{ g_Seed };
+		const auto next = [&engine] { return static_cast<float>(engine() >> 8) * (2.f / 16777216.f) - 1.f; };
+		while (rays.size() < g_AmountOfRays)
+		{
+			const Vector3 direction{ next(), next(), next() };
+			const float sqrLength = Vector3::Dot(direction, direction);
+			if (sqrLength > 1.f || sqrLength < 1e-4f) continue; //uniform over the sphere by rejection
+
+			const Vector3 origin = camera.origin + Vector3{ next(), next(), next() } * .5f;
+			rays.emplace_back(Ray{ origin, direction / std::sqrt(sqrLength) });
+		}
+		return rays;
+	}
+
+	//Shared by the kernel benchmarks: a default camera at the origin looking down +z at the primitive
+	const std::vector<Ray>& GetKernelRays(RayPattern pattern)
+	{
+		static const std::vector<Ray> coherent = CreateRays(RayPattern::Coherent, Camera{ Vector3{ 0.f, 0.f, 0.f }, 45.f });
+		static const std::vector<Ray> incoherent = CreateRays(RayPattern::Incoherent, Camera{ Vector3{ 0.f, 0.f, 0.f }, 45.f });
+		return pattern == RayPattern::Coherent ? coherent : incoherent;
+	}
+
+	template<typename Kernel>
+	void TraceRays(benchmark::State& state, const std::vector<Ray>& rays, Kernel kernel)
+	{
+		for (auto _ : state)
+		{
+			for (const Ray& ray : rays)
+				benchmark::DoNotOptimize(kernel(ray));
+		}
+		state.counters["rays"] = benchmark::Counter(static_cast<double>(state.iterations()) * rays.size(), benchmark::Counter::kIsRate);
+	}
+
+	void BM_HitTest_Sphere(benchmark::State& state, RayPattern pattern)
+	{
+		Sphere sphere{};
+		sphere.origin = { 0.f, 0.f, 5.f };
+		sphere.radius = 1.f;
+		HitRecord hitRecord{};
+		TraceRays(state, GetKernelRays(pattern), [&](const Ray& ray) { return GeometryUtils::HitTest_Sphere(sphere, ray, hitRecord); });
+	}
+
+	void BM_HitTest_Plane(benchmark::State& state, RayPattern pattern)
+	{
+		Plane plane{};
+		plane.origin = { 0.f, 0.f, 5.f };
+		plane.normal = { 0.f, 0.f, -1.f };
+		HitRecord hitRecord{};
+		TraceRays(state, GetKernelRays(pattern), [&](const Ray& ray) { return GeometryUtils::HitTest_Plane(plane, ray, hitRecord); });
+	}
+
+	void BM_HitTest_Triangle(benchmark::State& state, RayPattern pattern)
+	{
+		Triangle triangle{ { -1.f, -1.f, 5.f }, { 0.f, 1.f, 5.f }, { 1.f, -1.f, 5.f } };
+		triangle.cullMode = TriangleCullMode::NoCulling;
+		HitRecord hitRecord{};
+		TraceRays(state, GetKernelRays(pattern), [&](const Ray& ray) { return GeometryUtils::HitTest_Triangle(triangle, ray, hitRecord); });
+	}
+
+	void BM_SlabTest_TriangleMesh(benchmark::State& state, RayPattern pattern)
+	{
+		//Only the bounds matter to the slab test, two triangles spanning a unit cube are enough
+		TriangleMesh mesh{};
+		mesh.AppendTriangle(Triangle{ { -1.f, -1.f, 4.f }, { 1.f, -1.f, 4.f }, { 1.f, 1.f, 6.f } }, true);
+		mesh.AppendTriangle(Triangle{ { -1.f, -1.f, 4.f }, { 1.f, 1.f, 6.f }, { -1.f, 1.f, 6.f } }, true);
+		mesh.UpdateAABB();
+		mesh.UpdateTransforms();
+		TraceRays(state, GetKernelRays(pattern), [&](const Ray& ray) { return GeometryUtils::SlabTest_TriangleMesh(mesh, ray); });
+	}
+
+	//Scenes are built once, the scene benchmarks only trace
+	struct BenchmarkScene
+	{
+		std::string name{};
+		std::unique_ptr<Scene> pScene{};
+		std::vector<Ray> rays[2]{};
+		bool hasMissingMesh{ false };
+	};
+
+	void BM_GetClosestHit(benchmark::State& state, const BenchmarkScene* pBenchmarkScene, RayPattern pattern)
+	{
+		if (pBenchmarkScene->hasMissingMesh)
+		{
+			state.SkipWithError("mesh not found, run from the folder with resources/");
+			return;
+		}
+		HitRecord hitRecord{};
+		TraceRays(state, pBenchmarkScene->rays[static_cast<int>(pattern)], [&](const Ray& ray)
+			{
+				hitRecord = HitRecord{};
+				pBenchmarkScene->pScene->GetClosestHit(ray, hitRecord);
+				return hitRecord.didHit;
+			});
+	}
+
+	void BM_DoesHit(benchmark::State& state, const BenchmarkScene* pBenchmarkScene, RayPattern pattern)
+	{
+		if (pBenchmarkScene->hasMissingMesh)
+		{
+			state.SkipWithError("mesh not found, run from the folder with resources/");
+			return;
+		}
+		TraceRays(state, pBenchmarkScene->rays[static_cast<int>(pattern)], [&](const Ray& ray) { return pBenchmarkScene->pScene->DoesHit(ray); });
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace dae;
+
+	const std::pair<const char*, std::function<Scene*()>> sceneFactories[]
+	{
+		{ "W1", [] { return new Scene_W1(); } },
+		{ "W2", [] { return new Scene_W2(); } },
+		{ "W3", [] { return new Scene_W3(); } },
+		{ "W3_TestScene1", [] { return new Scene_W3_TestScene1(); } },
+		{ "W3_TestScene2", [] { return new Scene_W3_TestScene2(); } },
+		{ "W4_TestScene1", [] { return new Scene_W4_TestScene1(); } },
+		{ "W4_TestScene2", [] { return new Scene_W4_TestScene2(); } },
+		{ "W4_TestScene3", [] { return new Scene_W4_TestScene3(); } },
+		{ "Reference", [] { return new Scene_W4_RefrenceScene(); } },
+		{ "Bunny", [] { return new Scene_W4_BunnyScene(); } },
+		{ "AreaLight", [] { return new Scene_W5_AreaLightScene(); } },
+	};
+
+	const std::pair<const char*, RayPattern> patterns[]{ { "coherent", RayPattern::Coherent }, { "incoherent", RayPattern::Incoherent } };
+
+	for (const auto& [name, pattern] : patterns)
+	{
+		benchmark::RegisterBenchmark((std::string("HitTest_Sphere/") + name).c_str(), BM_HitTest_Sphere, pattern);
+		benchmark::RegisterBenchmark((std::string("HitTest_Plane/") + name).c_str(), BM_HitTest_Plane, pattern);
+		benchmark::RegisterBenchmark((std::string("HitTest_Triangle/") + name).c_str(), BM_HitTest_Triangle, pattern);
+		benchmark::RegisterBenchmark((std::string("SlabTest_TriangleMesh/") + name).c_str(), BM_SlabTest_TriangleMesh, pattern);
+	}
+
+	std::vector<std::unique_ptr<BenchmarkScene>> scenes{};
+	for (const auto& [sceneName, createScene] : sceneFactories)
+	{
+		auto pBenchmarkScene = std::make_unique<BenchmarkScene>();
+		pBenchmarkScene->name = sceneName;
+		pBenchmarkScene->pScene.reset(createScene());
+		pBenchmarkScene->pScene->Activate();
+		pBenchmarkScene->pScene->WaitForContent();
+
+		//The bunny scene quietly renders without its bunny when the OBJ isn't found
+		if (pBenchmarkScene->name == "Bunny")
+		{
+			const std::shared_ptr<const MeshData> pMesh = AssetCache::FindMesh("resources/lowpoly_bunny.obj");
+			pBenchmarkScene->hasMissingMesh = !pMesh || pMesh->indices.empty();
+		}
+
+		for (const auto& [patternName, pattern] : patterns)
+			pBenchmarkScene->rays[static_cast<int>(pattern)] = CreateRays(pattern, pBenchmarkScene->pScene->GetCamera());
+
+		for (const auto& [patternName, pattern] : patterns)
+		{
+			const std::string suffix = "/" + pBenchmarkScene->name + "/" + patternName;
+			benchmark::RegisterBenchmark(("GetClosestHit" + suffix).c_str(), BM_GetClosestHit, pBenchmarkScene.get(), pattern);
+			benchmark::RegisterBenchmark(("DoesHit" + suffix).c_str(), BM_DoesHit, pBenchmarkScene.get(), pattern);
+		}
+		scenes.emplace_back(std::move(pBenchmarkScene));
+	}
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -0,0 +1,74 @@
+#include "AssetCache.h"
+#include "Utils.h"
+
+#include <mutex>
+#include <unordered_map>
+
+using namespace dae;
+
+namespace
+{
+	std::mutex g_MeshMutex{};
+	std::unordered_map<std::string, std::weak_ptr<const MeshData>> g_Meshes{};
+
+	std::mutex g_MaterialMutex{};
+	std::unordered_map<std::string, std::weak_ptr<Material>> g_Materials{};
+}
+
+std::shared_ptr<const MeshData> AssetCache::GetMesh(const std::string& filename)
+{
+	{
+		const std::lock_guard lock{ g_MeshMutex };
+		if (std::shared_ptr<const MeshData> pMesh = g_Meshes[filename].lock())
+			return pMesh;
+	}
+
+	//Parse without holding the lock, a preload shouldn't block other lookups
+	const auto pLoaded = std::make_shared<MeshData>();
+	if (!Utils::ParseOBJCached(filename, pLoaded->positions, pLoaded->normals, pLoaded->indices))
+		return nullptr;
+
+	const std::lock_guard lock{ g_MeshMutex };
+	std::weak_ptr<const MeshData>& entry = g_Meshes[filename];
+	if (std::shared_ptr<const MeshData> pMesh = entry.lock())
+		return pMesh; //loaded by another thread in the meantime
+
+	entry = pLoaded;
+	return pLoaded;
+}
+
+std::shared_ptr<const MeshData> AssetCache::FindMesh(const std::string& filename)
+{
+	const std::lock_guard lock{ g_MeshMutex };
+	const auto it = g_Meshes.find(filename);
+	return it != g_Meshes.end() ? it->second.lock() : nullptr;
+}
+
+std::shared_ptr<const MeshData> AssetCache::ReloadMesh(const std::string& filename)
+{
+	const auto pLoaded = std::make_shared<MeshData>();
+	if (!Utils::ParseOBJCached(filename, pLoaded->positions, pLoaded->normals, pLoaded->indices))
+		return nullptr;
+
+	const std::lock_guard lock{ g_MeshMutex };
+	g_Meshes[filename] = pLoaded;
+	return pLoaded;
+}
+
+std::shared_ptr<Material> AssetCache::FindMaterial(const std::string& key)
+{
+	const std::lock_guard lock{ g_MaterialMutex };
+	const auto it = g_Materials.find(key);
+	return it != g_Materials.end() ? it->second.lock() : nullptr;
+}
+
+std::shared_ptr<Material> AssetCache::AddMaterial(const std::string& key, std::shared_ptr<Material> pMaterial)
+{
+	const std::lock_guard lock{ g_MaterialMutex };
+	std::weak_ptr<Material>& entry = g_Materials[key];
+	if (std::shared_ptr<Material> pExisting = entry.lock())
+		return pExisting;
+
+	entry = pMaterial;
+	return pMaterial;
+}
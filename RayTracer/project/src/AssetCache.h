@@ -0,0 +1,58 @@
+#pragma once
+
+//Standard includes
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+
+//Project includes
+#include "DataTypes.h"
+#include "Material.h"
+
+namespace dae
+{
+	//Process wide cache of immutable scene data. Only weak references are kept, an asset lives as long as
+	//one of the scenes using it does, so memory scales with the scenes that are actually loaded.
+	//Safe to use from background (preloading) threads.
+	class AssetCache final
+	{
+	public:
+		AssetCache() = delete;
+
+		//Returns the already loaded mesh or parses it, nullptr if the file can't be read
+		static std::shared_ptr<const MeshData> GetMesh(const std::string& filename);
+		//The mesh if it's loaded, never parses
+		static std::shared_ptr<const MeshData> FindMesh(const std::string& filename);
+		//Parses the file again and makes later lookups return the new data, users of the old data keep it alive
+		//until they swap. nullptr (and the cache unchanged) if the file can't be read
+		static std::shared_ptr<const MeshData> ReloadMesh(const std::string& filename);
+
+		//Returns an existing material of the same type created with identical arguments, or creates one
+		template<typename T, typename... Args>
+		static std::shared_ptr<Material> GetMaterial(const Args&... args)
+		{
+			static_assert(std::is_base_of_v<Material, T>, "AssetCache only shares materials");
+			static_assert((std::is_trivially_copyable_v<Args> && ...), "Material arguments are compared bytewise");
+
+			std::string key{ typeid(T).name() };
+			(key.append(reinterpret_cast<const char*>(&args), sizeof(Args)), ...);
+
+			return FindOrAddMaterial(key, [&]() -> Material* { return new T(args...); });
+		}
+
+	private:
+		template<typename Factory>
+		static std::shared_ptr<Material> FindOrAddMaterial(const std::string& key, Factory&& factory)
+		{
+			if (std::shared_ptr<Material> pMaterial = FindMaterial(key))
+				return pMaterial;
+
+			return AddMaterial(key, std::shared_ptr<Material>(factory()));
+		}
+
+		static std::shared_ptr<Material> FindMaterial(const std::string& key);
+		//Keeps the material that was added first if another thread raced us
+		static std::shared_ptr<Material> AddMaterial(const std::string& key, std::shared_ptr<Material> pMaterial);
+	};
+}
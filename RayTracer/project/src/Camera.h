@@ -1,13 +1,29 @@
 #pragma once
+#if !defined(RT_NO_SDL)
 #include <SDL_keyboard.h>
 #include <SDL_mouse.h>
+#endif
 #include <iostream>
 #include "Maths.h"
 #include "Timer.h"
 #include "Renderer.h"
+#include "Trace.h"
 
 namespace dae
 {
+    // What the keyboard and mouse did during one frame, read from SDL or replayed from a recording
+    struct CameraInput
+    {
+        bool isMovingForward{ false };
+        bool isMovingBack{ false };
+        bool isMovingRight{ false };
+        bool isMovingLeft{ false };
+        bool isBoosting{ false }; // LSHIFT
+        int mouseX{}, mouseY{}; // relative motion since the last frame
+        bool isLeftButtonDown{ false };
+        bool isRightButtonDown{ false };
+    };
+
     struct Camera
     {
         Camera() = default;
@@ -37,9 +53,13 @@ namespace dae
         float baseMovementSpeed{ 4.f };
         float boostMultiplier{ 4.f }; // LSHIFT boost
         const float rotationSpeed{ 0.003f };
+        bool isInputEnabled{ true }; // Off for offline renders, the camera only moves when the scene moves it
+        bool hasExternalInput{ false }; // input is set from outside every frame (a replay, or the main thread for a render thread) instead of read from SDL
+        CameraInput input{}; // what moved the camera last frame
 
         Matrix CalculateCameraToWorld()
         {
+            TRACE_SCOPE("Camera::CalculateCameraToWorld");
             // Build rotation from yaw and pitch
             transformationMatrix = Matrix::CreateRotation(totalPitch, totalYaw, 0.f);
 
@@ -62,35 +82,62 @@ namespace dae
             return cameraToWorld;
         }
 
+        // With external input (replays, the render thread) the keyboard and mouse aren't read here
         void Update(Timer* pTimer)
         {
-            const float deltaTime = pTimer->GetElapsed();
+            if (!isInputEnabled)
+                return;
 
-            // Keyboard Input
+            if (!hasExternalInput)
+                input = ReadInput();
+            ApplyInput(input, pTimer->GetElapsed());
+        }
+
+        static CameraInput ReadInput()
+        {
+            CameraInput input{};
+#if !defined(RT_NO_SDL)
             const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
+            input.isMovingForward = pKeyboardState[SDL_SCANCODE_W] || pKeyboardState[SDL_SCANCODE_UP];
+            input.isMovingBack = pKeyboardState[SDL_SCANCODE_S] || pKeyboardState[SDL_SCANCODE_DOWN];
+            input.isMovingRight = pKeyboardState[SDL_SCANCODE_D] || pKeyboardState[SDL_SCANCODE_RIGHT];
+            input.isMovingLeft = pKeyboardState[SDL_SCANCODE_A] || pKeyboardState[SDL_SCANCODE_LEFT];
+            input.isBoosting = pKeyboardState[SDL_SCANCODE_LSHIFT];
+
+            SDL_GetRelativeMouseState(&input.mouseX, &input.mouseY);
+            const uint32_t mouseState = SDL_GetMouseState(nullptr, nullptr);
+            input.isLeftButtonDown = mouseState & SDL_BUTTON(SDL_BUTTON_LEFT);
+            input.isRightButtonDown = mouseState & SDL_BUTTON(SDL_BUTTON_RIGHT);
+#endif
+            return input;
+        }
 
+        // Everything that moves the camera goes through here, the same input and time step give the same pose
+        void ApplyInput(const CameraInput& frameInput, float deltaTime)
+        {
+            // Keyboard Input
             float movementSpeed = baseMovementSpeed;
-            if (pKeyboardState[SDL_SCANCODE_LSHIFT])
+            if (frameInput.isBoosting)
                 movementSpeed *= boostMultiplier;
 
-            if (pKeyboardState[SDL_SCANCODE_W] || pKeyboardState[SDL_SCANCODE_UP])
+            if (frameInput.isMovingForward)
                 origin += forward * movementSpeed * deltaTime;
 
-            if (pKeyboardState[SDL_SCANCODE_S] || pKeyboardState[SDL_SCANCODE_DOWN])
+            if (frameInput.isMovingBack)
                 origin -= forward * movementSpeed * deltaTime;
 
-            if (pKeyboardState[SDL_SCANCODE_D] || pKeyboardState[SDL_SCANCODE_RIGHT])
+            if (frameInput.isMovingRight)
                 origin += right * movementSpeed * deltaTime;
 
-            if (pKeyboardState[SDL_SCANCODE_A] || pKeyboardState[SDL_SCANCODE_LEFT])
+            if (frameInput.isMovingLeft)
                 origin -= right * movementSpeed * deltaTime;
 
             // Mouse Input
-            SDL_GetRelativeMouseState(&mouseX, &mouseY);
-            uint32_t mouseState = SDL_GetMouseState(nullptr, nullptr);
+            mouseX = frameInput.mouseX;
+            mouseY = frameInput.mouseY;
 
-            bool lmb = mouseState & SDL_BUTTON(SDL_BUTTON_LEFT);
-            bool rmb = mouseState & SDL_BUTTON(SDL_BUTTON_RIGHT);
+            const bool lmb = frameInput.isLeftButtonDown;
+            const bool rmb = frameInput.isRightButtonDown;
 
             if (rmb && !lmb)
             {
@@ -0,0 +1,640 @@
+#include "ClusteredMesh.h"
+#include "MappedFile.h"
+#include "RayStats.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace dae;
+
+namespace
+{
+	//Bump the version whenever the header, the cluster table or the triangle layout changes
+	constexpr char g_ClusterFileMagic[4]{ 'R', 'T', 'C', 'L' };
+	constexpr uint32_t g_ClusterFileVersion{ 3 };
+
+	//The triangles of every cluster follow the header, the cluster table is at tableOffset after the last of them,
+	//followed by the nodes of the tree over the clusters
+	struct ClusterFileHeader
+	{
+		char magic[4]{};
+		uint32_t version{ 0 };
+		uint64_t sourceHash{ 0 };
+		uint64_t sourceSize{ 0 };
+		int64_t sourceModifiedTime{ 0 }; //file clock ticks, a match (with the size) skips hashing the source
+		float transform[16]{};
+		uint32_t amountOfClusters{ 0 };
+		uint32_t amountOfTriangles{ 0 };
+		uint64_t tableOffset{ 0 };
+		uint32_t amountOfNodes{ 0 };
+		uint32_t padding{ 0 };
+	};
+
+	//Cluster table entry, every cluster's triangles are 3 packed Vector3 each
+	struct ClusterFileEntry
+	{
+		Vector3 minAABB{};
+		Vector3 maxAABB{};
+		uint64_t offset{ 0 };
+		uint32_t firstTriangle{ 0 };
+		uint32_t amountOfTriangles{ 0 };
+	};
+
+	//Tree node in depth first order, the first child of an inner node is the next node
+	struct ClusterFileNode
+	{
+		Vector3 minAABB{};
+		Vector3 maxAABB{};
+		uint32_t index{ 0 }; //cluster of a leaf, second child of an inner node
+		uint32_t axis{ 0 }; //split axis, g_LeafAxis for a leaf
+	};
+
+	static_assert(sizeof(ClusterFileHeader) == 120, "Cluster file header layout changed, bump g_ClusterFileVersion");
+	static_assert(sizeof(ClusterFileEntry) == 40, "Cluster table layout changed, bump g_ClusterFileVersion");
+	static_assert(sizeof(ClusterFileNode) == 32, "Cluster tree layout changed, bump g_ClusterFileVersion");
+	static_assert(sizeof(Vector3) == 3 * sizeof(float), "Cluster files store Vector3 as 3 packed floats");
+
+	thread_local bool t_HadMiss{ false };
+
+	//Binned splits stop at this depth, from there ranges are halved so 2^32 triangles stay within g_MaxTreeDepth levels
+	constexpr int g_MaxBinnedDepth{ 32 };
+	constexpr int g_MaxTreeDepth{ 64 };
+	constexpr uint32_t g_LeafAxis{ 3 };
+
+	void StoreTransform(const Matrix& transform, float(&values)[16])
+	{
+		for (int row{ 0 }; row < 4; ++row)
+		{
+			const Vector4 axis = transform[row];
+			values[row * 4 + 0] = axis.x;
+			values[row * 4 + 1] = axis.y;
+			values[row * 4 + 2] = axis.z;
+			values[row * 4 + 3] = axis.w;
+		}
+	}
+
+	//Slab test limited to [ray.min, maxT], so clusters behind the closest hit so far are skipped
+	bool SlabTest(const Vector3& minAABB, const Vector3& maxAABB, const Ray& ray, float maxT)
+	{
+		float tmin{ ray.min }, tmax{ maxT };
+		for (int axis{ 0 }; axis < 3; ++axis)
+		{
+			const float inverseDirection = 1.f / ray.direction[axis];
+			float t1 = (minAABB[axis] - ray.origin[axis]) * inverseDirection;
+			float t2 = (maxAABB[axis] - ray.origin[axis]) * inverseDirection;
+			if (t1 > t2) std::swap(t1, t2);
+
+			tmin = std::max(tmin, t1);
+			tmax = std::min(tmax, t2);
+		}
+		return tmax >= tmin;
+	}
+
+	//Scratch files of a build next to the cluster file, removed however the build ends
+	struct TempFiles final
+	{
+		std::vector<std::string> filenames{};
+		~TempFiles()
+		{
+			for (const std::string& filename : filenames)
+				std::remove(filename.c_str());
+		}
+	};
+
+	struct TriangleRecord
+	{
+		Vector3 corners[3]{};
+		Vector3 GetCentroid() const { return (corners[0] + corners[1] + corners[2]) / 3.f; }
+	};
+
+	/**
+	 * Median split along the longest axis until every range fits in a cluster, with only a few blocks of triangles in
+	 * memory at a time. A range is read twice from one scratch file: once for a histogram of its centroids, which
+	 * gives the split closest to the median, once to write both halves to the other scratch file at the same place.
+	 * Ranges small enough are appended to the cluster file as they're found, in depth first order.
+	 * Below g_MaxBinnedDepth ranges are halved in file order, which keeps the tree within g_MaxTreeDepth levels.
+	 */
+	class ClusterSplitter final
+	{
+	public:
+		ClusterSplitter(std::fstream (&scratch)[2], std::ofstream& output, uint32_t trianglesPerCluster) :
+			m_Scratch{ scratch },
+			m_Output{ output },
+			m_TrianglesPerCluster{ trianglesPerCluster }
+		{
+		}
+
+		//Triangles [begin, end) of scratch file depth % 2, with centroids within minCentroid and maxCentroid
+		void Split(uint64_t begin, uint64_t end, int depth, const Vector3& minCentroid, const Vector3& maxCentroid)
+		{
+			const size_t nodeIndex = m_Nodes.size();
+			m_Nodes.emplace_back();
+			if (end - begin <= m_TrianglesPerCluster)
+			{
+				WriteCluster(begin, end, depth);
+				const ClusterFileEntry& entry = m_Entries.back();
+				m_Nodes[nodeIndex] = ClusterFileNode{ entry.minAABB, entry.maxAABB, static_cast<uint32_t>(m_Entries.size() - 1), g_LeafAxis };
+				return;
+			}
+
+			const Vector3 extent = maxCentroid - minCentroid;
+			const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+			const float binScale = extent[axis] > 0.f ? m_AmountOfBins / extent[axis] : 0.f;
+			const auto getBin = [&](const TriangleRecord& triangle)
+				{
+					const int bin = static_cast<int>((triangle.GetCentroid()[axis] - minCentroid[axis]) * binScale);
+					return std::clamp(bin, 0, m_AmountOfBins - 1);
+				};
+
+			std::vector<uint64_t> histogram(m_AmountOfBins);
+			ForEachBlock(begin, end, depth, [&](const TriangleRecord* pTriangles, size_t amount)
+				{
+					for (size_t i{ 0 }; i < amount; ++i)
+						++histogram[getBin(pTriangles[i])];
+				});
+
+			//Last bin of the left half, the one whose cumulative count is nearest to half the range
+			const uint64_t half = (end - begin) / 2;
+			int splitBin{ -1 };
+			uint64_t leftCount{ 0 }, bestLeftCount{ 0 };
+			for (int bin{ 0 }; bin + 1 < m_AmountOfBins; ++bin)
+			{
+				leftCount += histogram[bin];
+				if (leftCount == 0 || leftCount == end - begin) continue;
+				if (splitBin < 0 || (leftCount > half ? leftCount - half : half - leftCount) < (bestLeftCount > half ? bestLeftCount - half : half - bestLeftCount))
+				{
+					splitBin = bin;
+					bestLeftCount = leftCount;
+				}
+			}
+			//Every centroid in one bin, or too deep: split in file order instead
+			const bool isSplitByOrder = splitBin < 0 || depth >= g_MaxBinnedDepth;
+			if (isSplitByOrder)
+				bestLeftCount = half;
+
+			//Both halves to the other scratch file, each with the bounds of its centroids
+			std::fstream& destination = m_Scratch[(depth + 1) % 2];
+			std::vector<TriangleRecord> left{}, right{};
+			uint64_t leftEnd{ begin }, rightEnd{ begin + bestLeftCount }, index{ begin };
+			Vector3 bounds[4]{ maxCentroid, minCentroid, maxCentroid, minCentroid }; //left min, max, right min, max
+			const auto flush = [&](std::vector<TriangleRecord>& triangles, uint64_t& position)
+				{
+					destination.seekp(static_cast<std::streamoff>(position * sizeof(TriangleRecord)));
+					destination.write(reinterpret_cast<const char*>(triangles.data()), triangles.size() * sizeof(TriangleRecord));
+					position += triangles.size();
+					triangles.clear();
+				};
+			ForEachBlock(begin, end, depth, [&](const TriangleRecord* pTriangles, size_t amount)
+				{
+					for (size_t i{ 0 }; i < amount; ++i, ++index)
+					{
+						const bool isLeft = isSplitByOrder ? index < begin + bestLeftCount : getBin(pTriangles[i]) <= splitBin;
+						const Vector3 centroid = pTriangles[i].GetCentroid();
+						Vector3* pBounds = isLeft ? bounds : bounds + 2;
+						pBounds[0] = Vector3::Min(pBounds[0], centroid);
+						pBounds[1] = Vector3::Max(pBounds[1], centroid);
+						(isLeft ? left : right).emplace_back(pTriangles[i]);
+					}
+					flush(left, leftEnd);
+					flush(right, rightEnd);
+				});
+
+			Split(begin, begin + bestLeftCount, depth + 1, bounds[0], bounds[1]);
+			const size_t secondChild = m_Nodes.size();
+			Split(begin + bestLeftCount, end, depth + 1, bounds[2], bounds[3]);
+
+			ClusterFileNode& node = m_Nodes[nodeIndex];
+			node.minAABB = Vector3::Min(m_Nodes[nodeIndex + 1].minAABB, m_Nodes[secondChild].minAABB);
+			node.maxAABB = Vector3::Max(m_Nodes[nodeIndex + 1].maxAABB, m_Nodes[secondChild].maxAABB);
+			node.index = static_cast<uint32_t>(secondChild);
+			node.axis = static_cast<uint32_t>(axis);
+		}
+
+		const std::vector<ClusterFileEntry>& GetEntries() const { return m_Entries; }
+		const std::vector<ClusterFileNode>& GetNodes() const { return m_Nodes; }
+		uint64_t GetOutputOffset() const { return m_OutputOffset; }
+
+	private:
+		static constexpr int m_AmountOfBins{ 1024 };
+		static constexpr size_t m_BlockSize{ 16384 }; //triangles
+
+		std::fstream (&m_Scratch)[2];
+		std::ofstream& m_Output;
+		uint32_t m_TrianglesPerCluster;
+		uint64_t m_OutputOffset{ sizeof(ClusterFileHeader) };
+		std::vector<ClusterFileEntry> m_Entries{};
+		std::vector<ClusterFileNode> m_Nodes{};
+		std::vector<TriangleRecord> m_Block{};
+
+		template<typename Function>
+		void ForEachBlock(uint64_t begin, uint64_t end, int depth, const Function& function)
+		{
+			std::fstream& source = m_Scratch[depth % 2];
+			for (uint64_t first{ begin }; first < end; first += m_BlockSize)
+			{
+				m_Block.resize(std::min<uint64_t>(m_BlockSize, end - first));
+				source.seekg(static_cast<std::streamoff>(first * sizeof(TriangleRecord)));
+				source.read(reinterpret_cast<char*>(m_Block.data()), m_Block.size() * sizeof(TriangleRecord));
+				function(m_Block.data(), m_Block.size());
+			}
+		}
+
+		void WriteCluster(uint64_t begin, uint64_t end, int depth)
+		{
+			if (begin == end) return;
+
+			ClusterFileEntry entry{};
+			entry.offset = m_OutputOffset;
+			entry.firstTriangle = static_cast<uint32_t>(begin);
+			entry.amountOfTriangles = static_cast<uint32_t>(end - begin);
+			entry.minAABB = Vector3{ FLT_MAX, FLT_MAX, FLT_MAX };
+			entry.maxAABB = Vector3{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			ForEachBlock(begin, end, depth, [&](const TriangleRecord* pTriangles, size_t amount)
+				{
+					for (size_t i{ 0 }; i < amount; ++i)
+					{
+						for (const Vector3& corner : pTriangles[i].corners)
+						{
+							entry.minAABB = Vector3::Min(entry.minAABB, corner);
+							entry.maxAABB = Vector3::Max(entry.maxAABB, corner);
+						}
+					}
+					m_Output.write(reinterpret_cast<const char*>(pTriangles), amount * sizeof(TriangleRecord));
+				});
+			m_OutputOffset += entry.amountOfTriangles * sizeof(TriangleRecord);
+			m_Entries.emplace_back(entry);
+		}
+	};
+
+	bool GetSourceStamp(const std::string& filename, ClusterFileHeader& header)
+	{
+		std::error_code error{};
+		header.sourceSize = std::filesystem::file_size(filename, error);
+		if (error)
+			return false;
+		header.sourceModifiedTime = std::filesystem::last_write_time(filename, error).time_since_epoch().count();
+		return !error;
+	}
+
+	uint64_t HashFile(const std::string& filename)
+	{
+		MappedFile source{};
+		return source.Open(filename) ? Utils::HashBytes(source.GetData(), source.GetSize()) : 0;
+	}
+}
+
+bool ClusteredMesh::Build(const std::string& objFilename, const std::string& clusterFilename, const Matrix& transform, uint32_t trianglesPerCluster)
+{
+	ClusterFileHeader header{};
+	std::memcpy(header.magic, g_ClusterFileMagic, sizeof(header.magic));
+	header.version = g_ClusterFileVersion;
+	StoreTransform(transform, header.transform);
+	if (!GetSourceStamp(objFilename, header))
+		return false;
+
+	//Up to date already? The source is only hashed when its size matches but its time doesn't
+	{
+		std::fstream existing(clusterFilename, std::ios::binary | std::ios::in | std::ios::out);
+		ClusterFileHeader existingHeader{};
+		if (existing.read(reinterpret_cast<char*>(&existingHeader), sizeof(ClusterFileHeader))
+			&& std::memcmp(existingHeader.magic, header.magic, sizeof(header.magic)) == 0
+			&& existingHeader.version == header.version
+			&& existingHeader.sourceSize == header.sourceSize
+			&& std::memcmp(existingHeader.transform, header.transform, sizeof(header.transform)) == 0)
+		{
+			if (existingHeader.sourceModifiedTime == header.sourceModifiedTime)
+				return true;
+			if (HashFile(objFilename) == existingHeader.sourceHash)
+			{
+				existingHeader.sourceModifiedTime = header.sourceModifiedTime;
+				existing.seekp(0);
+				existing.write(reinterpret_cast<const char*>(&existingHeader), sizeof(ClusterFileHeader));
+				return true;
+			}
+		}
+	}
+	header.sourceHash = HashFile(objFilename);
+
+	//Never the whole mesh in memory, and no mesh cache: the OBJ is streamed into a file of transformed vertices and one
+	//of triangle indices, which are then joined into a file of triangles for the splitter
+	TempFiles tempFiles{};
+	const std::string vertexFilename{ clusterFilename + ".vertices.tmp" };
+	const std::string indexFilename{ clusterFilename + ".indices.tmp" };
+	const std::string scratchFilenames[2]{ clusterFilename + ".split0.tmp", clusterFilename + ".split1.tmp" };
+	const std::string tempFilename{ clusterFilename + ".tmp" };
+	tempFiles.filenames = { vertexFilename, indexFilename, scratchFilenames[0], scratchFilenames[1], tempFilename };
+	{
+		std::ofstream vertexFile(vertexFilename, std::ios::binary | std::ios::trunc);
+		std::ofstream indexFile(indexFilename, std::ios::binary | std::ios::trunc);
+		std::vector<Vector3> transformed{};
+		constexpr size_t batchSize{ 64 << 20 };
+		const bool isParsed = Utils::ParseOBJBatches(objFilename, batchSize, [&](const std::vector<Vector3>& positions, const std::vector<int>& indices)
+			{
+				transformed.resize(positions.size());
+				std::transform(positions.begin(), positions.end(), transformed.begin(), [&](const Vector3& position)
+					{
+						return transform.TransformPoint(position);
+					});
+				vertexFile.write(reinterpret_cast<const char*>(transformed.data()), transformed.size() * sizeof(Vector3));
+				indexFile.write(reinterpret_cast<const char*>(indices.data()), indices.size() / 3 * 3 * sizeof(int));
+			});
+		if (!isParsed || !vertexFile || !indexFile)
+			return false;
+	}
+
+	std::fstream scratch[2]{};
+	for (int i{ 0 }; i < 2; ++i)
+	{
+		scratch[i].open(scratchFilenames[i], std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+		if (!scratch[i])
+			return false;
+	}
+
+	//Triangles with their corners looked up in the mapped vertex file, faces referring to vertices that don't exist are dropped
+	uint64_t amountOfTriangles{ 0 };
+	Vector3 minCentroid{ FLT_MAX, FLT_MAX, FLT_MAX }, maxCentroid{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	{
+		MappedFile vertices{};
+		vertices.Open(vertexFilename); //empty when the OBJ has no vertices
+		const auto pVertices = reinterpret_cast<const Vector3*>(vertices.GetData());
+		const uint64_t amountOfVertices = vertices.GetSize() / sizeof(Vector3);
+
+		std::ifstream indexFile(indexFilename, std::ios::binary);
+		std::vector<int> indices(3 * 65536);
+		std::vector<TriangleRecord> triangles{};
+		while (indexFile.read(reinterpret_cast<char*>(indices.data()), indices.size() * sizeof(int)) || indexFile.gcount() > 0)
+		{
+			const size_t amountRead = static_cast<size_t>(indexFile.gcount()) / sizeof(int);
+			triangles.clear();
+			for (size_t index{ 0 }; index + 2 < amountRead; index += 3)
+			{
+				TriangleRecord triangle{};
+				bool isValid{ true };
+				for (int corner{ 0 }; corner < 3; ++corner)
+				{
+					const int vertex = indices[index + corner];
+					isValid = isValid && vertex >= 0 && static_cast<uint64_t>(vertex) < amountOfVertices;
+					if (isValid) triangle.corners[corner] = pVertices[vertex];
+				}
+				if (!isValid) continue;
+
+				const Vector3 centroid = triangle.GetCentroid();
+				minCentroid = Vector3::Min(minCentroid, centroid);
+				maxCentroid = Vector3::Max(maxCentroid, centroid);
+				triangles.emplace_back(triangle);
+			}
+			scratch[0].write(reinterpret_cast<const char*>(triangles.data()), triangles.size() * sizeof(TriangleRecord));
+			amountOfTriangles += triangles.size();
+		}
+		if (!scratch[0] || amountOfTriangles > UINT32_MAX)
+			return false;
+	}
+
+	//Written to a temporary file first so an interrupted build never looks up to date
+	{
+		std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+		file.write(reinterpret_cast<const char*>(&header), sizeof(ClusterFileHeader)); //completed at the end
+
+		ClusterSplitter splitter{ scratch, file, std::max(trianglesPerCluster, 1u) };
+		if (amountOfTriangles > 0)
+			splitter.Split(0, amountOfTriangles, 0, minCentroid, maxCentroid);
+		if (!scratch[0] || !scratch[1])
+			return false;
+
+		const std::vector<ClusterFileEntry>& entries = splitter.GetEntries();
+		const std::vector<ClusterFileNode>& nodes = splitter.GetNodes();
+		header.amountOfClusters = static_cast<uint32_t>(entries.size());
+		header.amountOfTriangles = static_cast<uint32_t>(amountOfTriangles);
+		header.tableOffset = splitter.GetOutputOffset();
+		header.amountOfNodes = static_cast<uint32_t>(nodes.size());
+		file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ClusterFileEntry));
+		file.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(ClusterFileNode));
+
+		file.seekp(0);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(ClusterFileHeader));
+		if (!file)
+			return false;
+	}
+
+	std::remove(clusterFilename.c_str()); //rename doesn't overwrite on Windows
+	return std::rename(tempFilename.c_str(), clusterFilename.c_str()) == 0;
+}
+
+bool ClusteredMesh::Open(const std::string& clusterFilename)
+{
+	std::ifstream file(clusterFilename, std::ios::binary);
+	ClusterFileHeader header{};
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(ClusterFileHeader))
+		|| std::memcmp(header.magic, g_ClusterFileMagic, sizeof(header.magic)) != 0
+		|| header.version != g_ClusterFileVersion)
+		return false;
+
+	std::vector<ClusterFileEntry> entries(header.amountOfClusters);
+	std::vector<ClusterFileNode> nodes(header.amountOfNodes);
+	if (!file.seekg(static_cast<std::streamoff>(header.tableOffset))
+		|| !file.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(ClusterFileEntry))
+		|| !file.read(reinterpret_cast<char*>(nodes.data()), nodes.size() * sizeof(ClusterFileNode)))
+		return false;
+
+	m_Filename = clusterFilename;
+	m_AmountOfTriangles = header.amountOfTriangles;
+	m_Clusters.clear();
+	m_Clusters.reserve(entries.size());
+	for (const ClusterFileEntry& entry : entries)
+	{
+		m_Clusters.emplace_back(ClusterInfo{ entry.minAABB, entry.maxAABB, entry.offset, entry.firstTriangle, entry.amountOfTriangles });
+	}
+	m_pStates = std::make_unique<ClusterState[]>(m_Clusters.size());
+
+	m_Nodes.clear();
+	m_Nodes.reserve(nodes.size());
+	for (const ClusterFileNode& node : nodes)
+	{
+		m_Nodes.emplace_back(ClusterNode{ node.minAABB, node.maxAABB, node.index, node.axis });
+	}
+
+	return true;
+}
+
+const ClusteredMesh::ClusterState* ClusteredMesh::UseCluster(uint32_t clusterIndex, uint32_t frame) const
+{
+	const ClusterState& state = m_pStates[clusterIndex];
+	if (!state.isResident)
+	{
+		//Checking first keeps the cache line shared while many threads miss the same cluster
+		if (!state.isRequested.load(std::memory_order_relaxed))
+			state.isRequested.store(true, std::memory_order_relaxed);
+
+		t_HadMiss = true;
+		return nullptr;
+	}
+
+	if (state.lastUsedFrame.load(std::memory_order_relaxed) != frame)
+		state.lastUsedFrame.store(frame, std::memory_order_relaxed);
+
+	return &state;
+}
+
+template<typename LeafFunction>
+void ClusteredMesh::Traverse(const Ray& ray, const float& maxT, const LeafFunction& testLeaf) const
+{
+	if (m_Nodes.empty())
+		return;
+
+	RayStats& stats = RayStats::GetThreadStats();
+	uint32_t stack[g_MaxTreeDepth];
+	int stackSize{ 0 };
+	uint32_t nodeIndex{ 0 };
+	while (true)
+	{
+		const ClusterNode& node = m_Nodes[nodeIndex];
+		if (!SlabTest(node.minAABB, node.maxAABB, ray, std::min(ray.max, maxT)))
+		{
+			++stats.slabTestsFailed;
+		}
+		else
+		{
+			++stats.slabTestsPassed;
+			if (node.axis != g_LeafAxis)
+			{
+				//Near child first, the far one is skipped when a hit in the near one is closer than its bounds
+				const bool isFirstNear = ray.direction[static_cast<int>(node.axis)] >= 0.f;
+				stack[stackSize++] = isFirstNear ? node.index : nodeIndex + 1;
+				nodeIndex = isFirstNear ? nodeIndex + 1 : node.index;
+				continue;
+			}
+			if (testLeaf(node.index))
+				return;
+		}
+
+		if (stackSize == 0)
+			return;
+		nodeIndex = stack[--stackSize];
+	}
+}
+
+void ClusteredMesh::GetClosestHit(const Ray& ray, HitRecord& closestHit, uint32_t firstPrimitiveId, uint32_t frame) const
+{
+	RayStats& stats = RayStats::GetThreadStats();
+	Traverse(ray, closestHit.t, [&](uint32_t clusterIndex)
+		{
+			const ClusterState* pState = UseCluster(clusterIndex, frame);
+			if (!pState)
+				return false;
+
+			const std::vector<Vector3>& positions = pState->positions;
+			stats.triangleTests += positions.size() / 3;
+			for (size_t vertex{ 0 }; vertex < positions.size(); vertex += 3)
+			{
+				Triangle triangle{ positions[vertex], positions[vertex + 1], positions[vertex + 2] };
+				triangle.cullMode = cullMode;
+				triangle.materialIndex = materialIndex;
+
+				HitRecord hit{};
+				if (GeometryUtils::HitTest_Triangle(triangle, ray, hit) && hit.t < closestHit.t)
+				{
+					closestHit = hit;
+					closestHit.primitiveId = firstPrimitiveId + m_Clusters[clusterIndex].firstTriangle + static_cast<uint32_t>(vertex / 3);
+				}
+			}
+			return false;
+		});
+}
+
+bool ClusteredMesh::DoesHit(const Ray& ray, uint32_t frame) const
+{
+	RayStats& stats = RayStats::GetThreadStats();
+	bool isHit{ false };
+	Traverse(ray, ray.max, [&](uint32_t clusterIndex)
+		{
+			const ClusterState* pState = UseCluster(clusterIndex, frame);
+			if (!pState)
+				return false;
+
+			const std::vector<Vector3>& positions = pState->positions;
+			for (size_t vertex{ 0 }; vertex < positions.size(); vertex += 3)
+			{
+				Triangle triangle{ positions[vertex], positions[vertex + 1], positions[vertex + 2] };
+				triangle.cullMode = cullMode;
+
+				++stats.triangleTests;
+				if (GeometryUtils::HitTest_Triangle(triangle, ray))
+				{
+					isHit = true;
+					return true;
+				}
+			}
+			return false;
+		});
+	return isHit;
+}
+
+void ClusteredMesh::ResetMissFlag()
+{
+	t_HadMiss = false;
+}
+
+bool ClusteredMesh::HadMiss()
+{
+	return t_HadMiss;
+}
+
+std::vector<uint32_t> ClusteredMesh::TakeRequests()
+{
+	std::vector<uint32_t> requests{};
+	for (uint32_t clusterIndex{ 0 }; clusterIndex < m_Clusters.size(); ++clusterIndex)
+	{
+		ClusterState& state = m_pStates[clusterIndex];
+		if (state.isRequested.exchange(false, std::memory_order_relaxed) && !state.isResident)
+			requests.emplace_back(clusterIndex);
+	}
+	return requests;
+}
+
+std::vector<ClusteredMesh::ClusterUsage> ClusteredMesh::GetResidentClusters() const
+{
+	std::vector<ClusterUsage> resident{};
+	for (uint32_t clusterIndex{ 0 }; clusterIndex < m_Clusters.size(); ++clusterIndex)
+	{
+		const ClusterState& state = m_pStates[clusterIndex];
+		if (state.isResident)
+			resident.emplace_back(ClusterUsage{ clusterIndex, state.lastUsedFrame.load(std::memory_order_relaxed), GetClusterBytes(clusterIndex) });
+	}
+	return resident;
+}
+
+size_t ClusteredMesh::GetClusterBytes(uint32_t clusterIndex) const
+{
+	return m_Clusters[clusterIndex].amountOfTriangles * 3ull * sizeof(Vector3);
+}
+
+bool ClusteredMesh::LoadCluster(uint32_t clusterIndex)
+{
+	const ClusterInfo& info = m_Clusters[clusterIndex];
+	ClusterState& state = m_pStates[clusterIndex];
+
+	//Every load opens its own stream so clusters can be paged in concurrently
+	std::ifstream file(m_Filename, std::ios::binary);
+	std::vector<Vector3> positions(info.amountOfTriangles * 3ull);
+	if (!file.seekg(static_cast<std::streamoff>(info.offset))
+		|| !file.read(reinterpret_cast<char*>(positions.data()), positions.size() * sizeof(Vector3)))
+		return false;
+
+	state.positions = std::move(positions);
+	state.isResident = true;
+	return true;
+}
+
+void ClusteredMesh::EvictCluster(uint32_t clusterIndex)
+{
+	ClusterState& state = m_pStates[clusterIndex];
+	state.positions = {};
+	state.isResident = false;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+//Standard includes
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "DataTypes.h"
+#include "Matrix.h"
+
+namespace dae
+{
+	/**
+	 * \brief Out-of-core triangle mesh. The triangles are split into spatial clusters stored in a file on disk,
+	 * only the bounds of every cluster and the tree over them stay in memory. Rays that reach a cluster that isn't resident flag a miss
+	 * (see HadMiss) and request it; the Scene pages requested clusters in between trace passes.
+	 * Geometry is stored in world space, the transform is baked in when the cluster file is built.
+	 */
+	class ClusteredMesh final
+	{
+	public:
+		ClusteredMesh() = default;
+		~ClusteredMesh() = default;
+
+		ClusteredMesh(const ClusteredMesh&) = delete;
+		ClusteredMesh(ClusteredMesh&&) noexcept = delete;
+		ClusteredMesh& operator=(const ClusteredMesh&) = delete;
+		ClusteredMesh& operator=(ClusteredMesh&&) noexcept = delete;
+
+		/**
+		 * \brief Splits an OBJ into clusters of at most trianglesPerCluster triangles and writes them to clusterFilename.
+		 * Does nothing when clusterFilename was already built from the same source and transform.
+		 */
+		static bool Build(const std::string& objFilename, const std::string& clusterFilename, const Matrix& transform, uint32_t trianglesPerCluster = 2048);
+
+		//Reads the cluster index, no geometry is loaded yet
+		bool Open(const std::string& clusterFilename);
+
+		TriangleCullMode cullMode{ TriangleCullMode::BackFaceCulling };
+		unsigned char materialIndex{};
+
+		uint32_t GetAmountOfTriangles() const { return m_AmountOfTriangles; }
+		uint32_t GetAmountOfClusters() const { return static_cast<uint32_t>(m_Clusters.size()); }
+
+		//Safe to call from any number of render threads, as long as no paging happens at the same time
+		void GetClosestHit(const Ray& ray, HitRecord& closestHit, uint32_t firstPrimitiveId, uint32_t frame) const;
+		bool DoesHit(const Ray& ray, uint32_t frame) const;
+
+		//Set by GetClosestHit/DoesHit on the calling thread when a ray reached a cluster that isn't resident
+		static void ResetMissFlag();
+		static bool HadMiss();
+
+		//Paging, only call these while nothing is tracing
+		struct ClusterUsage
+		{
+			uint32_t clusterIndex{};
+			uint32_t lastUsedFrame{};
+			size_t bytes{};
+		};
+		std::vector<uint32_t> TakeRequests();
+		std::vector<ClusterUsage> GetResidentClusters() const;
+		size_t GetClusterBytes(uint32_t clusterIndex) const;
+		bool LoadCluster(uint32_t clusterIndex);
+		void EvictCluster(uint32_t clusterIndex);
+
+	private:
+		struct ClusterInfo
+		{
+			Vector3 minAABB{};
+			Vector3 maxAABB{};
+			uint64_t offset{ 0 }; //in bytes, from the start of the file
+			uint32_t firstTriangle{ 0 };
+			uint32_t amountOfTriangles{ 0 };
+		};
+
+		//Depth first, the first child of an inner node is the next node
+		struct ClusterNode
+		{
+			Vector3 minAABB{};
+			Vector3 maxAABB{};
+			uint32_t index{ 0 }; //cluster of a leaf, second child of an inner node
+			uint32_t axis{ 0 }; //split axis, 3 for a leaf
+		};
+
+		struct ClusterState
+		{
+			std::vector<Vector3> positions{}; //3 per triangle, empty when not resident
+			bool isResident{ false };
+			mutable std::atomic<bool> isRequested{ false };
+			mutable std::atomic<uint32_t> lastUsedFrame{ 0 };
+		};
+
+		std::string m_Filename{};
+		std::vector<ClusterInfo> m_Clusters{};
+		std::vector<ClusterNode> m_Nodes{};
+		std::unique_ptr<ClusterState[]> m_pStates{};
+		uint32_t m_AmountOfTriangles{ 0 };
+
+		//The cluster if it is resident, otherwise requests it and flags a miss
+		const ClusterState* UseCluster(uint32_t clusterIndex, uint32_t frame) const;
+		//Calls testLeaf(clusterIndex) for every leaf the ray reaches before maxT, near child first, until it returns true
+		template<typename LeafFunction>
+		void Traverse(const Ray& ray, const float& maxT, const LeafFunction& testLeaf) const;
+	};
+}
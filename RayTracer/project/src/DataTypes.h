@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
@@ -55,6 +56,14 @@ namespace dae
 		unsigned char materialIndex{};
 	};
 
+	//Immutable object space mesh data, shared between meshes through the AssetCache
+	struct MeshData
+	{
+		std::vector<Vector3> positions{};
+		std::vector<Vector3> normals{};
+		std::vector<int> indices{};
+	};
+
 	struct TriangleMesh
 	{
 		TriangleMesh() = default;
@@ -94,13 +103,27 @@ namespace dae
 		std::vector<Vector3> transformedPositions{};
 		std::vector<Vector3> transformedNormals{};
 
+		//When set, this is used instead of positions/normals/indices (which then stay empty)
+		std::shared_ptr<const MeshData> pSharedData{};
+
+		const std::vector<Vector3>& GetPositions() const { return pSharedData ? pSharedData->positions : positions; }
+		const std::vector<Vector3>& GetNormals() const { return pSharedData ? pSharedData->normals : normals; }
+		const std::vector<int>& GetIndices() const { return pSharedData ? pSharedData->indices : indices; }
+
+		void SetSharedData(std::shared_ptr<const MeshData> pData)
+		{
+			pSharedData = std::move(pData);
+			UpdateAABB();
+		}
+
 		void UpdateAABB()
 		{
-			if (positions.size() > 0)
+			const std::vector<Vector3>& meshPositions = GetPositions();
+			if (meshPositions.size() > 0)
 			{
-				minAABB = positions[0];
-				maxAABB = positions[0];
-				for (auto& p : positions)
+				minAABB = meshPositions[0];
+				maxAABB = meshPositions[0];
+				for (auto& p : meshPositions)
 				{
 					minAABB = Vector3::Min(p, minAABB);
 					maxAABB = Vector3::Max(p, maxAABB);
@@ -207,23 +230,21 @@ namespace dae
 			//std::cout << finalTransform[2][1] << "," << finalTransform[2][2] << "," << finalTransform[2][3] << std::endl;
 			//std::cout << finalTransform[3][1] << "," << finalTransform[3][2] << "," << finalTransform[3][3] << std::endl << std::endl;
 
+			const std::vector<Vector3>& meshPositions = GetPositions();
+			const std::vector<Vector3>& meshNormals = GetNormals();
+
 			transformedPositions.clear();
-			transformedPositions.reserve(positions.size());
-			for (int posIdx{ 0 }; posIdx < positions.size(); ++posIdx)
+			transformedPositions.reserve(meshPositions.size());
+			for (int posIdx{ 0 }; posIdx < meshPositions.size(); ++posIdx)
 			{
-				transformedPositions.emplace_back(finalTransform.TransformPoint(positions[posIdx]));
+				transformedPositions.emplace_back(finalTransform.TransformPoint(meshPositions[posIdx]));
 			}
 
 			transformedNormals.clear();
-			transformedNormals.reserve(normals.size());
-			for (int normIdx{ 0 }; normIdx < normals.size(); ++normIdx)
+			transformedNormals.reserve(meshNormals.size());
+			for (int normIdx{ 0 }; normIdx < meshNormals.size(); ++normIdx)
 			{
-				transformedNormals.emplace_back(finalTransform.TransformVector(normals[normIdx]));
-			}
-
-			for (auto& p : positions)
-			{
-				transformedPositions.emplace_back(finalTransform.TransformPoint(p));
+				transformedNormals.emplace_back(finalTransform.TransformVector(meshNormals[normIdx]));
 			}
 
 			// Update AABB
@@ -235,7 +256,9 @@ namespace dae
 	enum class LightType
 	{
 		Point,
-		Directional
+		Directional,
+		SphereArea,
+		RectArea
 	};
 
 	struct Light
@@ -245,6 +268,11 @@ namespace dae
 		ColorRGB color{};
 		float intensity{};
 
+		//Area lights
+		float radius{}; //SphereArea
+		Vector3 halfExtentU{}; //RectArea, spans origin +- halfExtentU +- halfExtentV
+		Vector3 halfExtentV{};
+
 		LightType type{};
 	};
 #pragma endregion
@@ -266,6 +294,7 @@ namespace dae
 
 		bool didHit{ false };
 		unsigned char materialIndex{ 0 };
+		uint32_t primitiveId{ 0 }; //unique per sphere/plane/triangle in the scene, 0 = nothing hit
 	};
 #pragma endregion
 }
\ No newline at end of file
@@ -0,0 +1,734 @@
+#include "DistributedRenderer.h"
+#include "Renderer.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace dae;
+
+namespace
+{
+	enum class MessageType : uint32_t
+	{
+		Job = 1, //coordinator -> worker, once per connection
+		Tile, //coordinator -> worker
+		TileResult //worker -> coordinator, the tile's pixels
+	};
+
+	//Every message starts with this, size counts the bytes after it
+	struct MessageHeader
+	{
+		uint32_t type{};
+		uint32_t size{};
+	};
+
+	//Raw host order values, a message is only ever read by the same build on a machine of the same endianness
+	class MessageWriter final
+	{
+	public:
+		explicit MessageWriter(MessageType type)
+		{
+			Write(MessageHeader{ static_cast<uint32_t>(type), 0 });
+		}
+
+		template<typename T>
+		void Write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			WriteBytes(&value, sizeof(T));
+		}
+
+		void WriteString(const std::string& text)
+		{
+			Write(static_cast<uint32_t>(text.size()));
+			WriteBytes(text.data(), text.size());
+		}
+
+		void WriteBytes(const void* pData, size_t size)
+		{
+			const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+			m_Bytes.insert(m_Bytes.end(), pBytes, pBytes + size);
+		}
+
+		//The whole message, header included
+		const std::vector<uint8_t>& Finish()
+		{
+			const uint32_t size = static_cast<uint32_t>(m_Bytes.size() - sizeof(MessageHeader));
+			std::memcpy(m_Bytes.data() + offsetof(MessageHeader, size), &size, sizeof(size));
+			return m_Bytes;
+		}
+
+	private:
+		std::vector<uint8_t> m_Bytes{};
+	};
+
+	class MessageReader final
+	{
+	public:
+		MessageReader(const uint8_t* pData, size_t size) :
+			m_pData{ pData },
+			m_Remaining{ size }
+		{
+		}
+
+		template<typename T>
+		bool Read(T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			return ReadBytes(&value, sizeof(T));
+		}
+
+		bool ReadString(std::string& text)
+		{
+			uint32_t size{};
+			if (!Read(size) || size > m_Remaining)
+				return false;
+			text.assign(reinterpret_cast<const char*>(m_pData), size);
+			return Skip(size);
+		}
+
+		bool ReadBytes(void* pData, size_t size)
+		{
+			if (size > m_Remaining)
+				return false;
+			std::memcpy(pData, m_pData, size);
+			return Skip(size);
+		}
+
+		//What hasn't been read yet
+		const uint8_t* GetPosition() const { return m_pData; }
+
+	private:
+		const uint8_t* m_pData{};
+		size_t m_Remaining{};
+
+		bool Skip(size_t size)
+		{
+			m_pData += size;
+			m_Remaining -= size;
+			return true;
+		}
+	};
+
+	struct TileAssignment
+	{
+		uint32_t id{};
+		int x{}, y{}, width{}, height{};
+	};
+
+	std::vector<uint8_t> EncodeJob(const DistributedRenderer::Job& job)
+	{
+		MessageWriter message{ MessageType::Job };
+		message.WriteString(job.sceneName);
+		const Scene_Generated::Settings& generator = job.generatorSettings;
+		message.Write(generator.seed);
+		message.Write(generator.amountOfSpheres);
+		message.Write(generator.amountOfMeshInstances);
+		message.Write(generator.trianglesPerMesh);
+		message.Write(generator.amountOfLights);
+		message.Write(static_cast<uint32_t>(generator.distribution));
+		message.Write(job.width);
+		message.Write(job.height);
+		message.Write(job.samplesPerFrame);
+		message.Write(job.time);
+		message.Write(job.hasCameraOrigin);
+		message.Write(job.cameraOrigin);
+		message.Write(job.hasCameraAngles);
+		message.Write(job.cameraYaw);
+		message.Write(job.cameraPitch);
+		message.Write(job.cameraFov);
+		message.Write(job.isHdr);
+		return message.Finish();
+	}
+
+	bool DecodeJob(MessageReader& message, DistributedRenderer::Job& job)
+	{
+		Scene_Generated::Settings& generator = job.generatorSettings;
+		uint32_t distribution{};
+		const bool isRead = message.ReadString(job.sceneName)
+			&& message.Read(generator.seed)
+			&& message.Read(generator.amountOfSpheres)
+			&& message.Read(generator.amountOfMeshInstances)
+			&& message.Read(generator.trianglesPerMesh)
+			&& message.Read(generator.amountOfLights)
+			&& message.Read(distribution)
+			&& message.Read(job.width)
+			&& message.Read(job.height)
+			&& message.Read(job.samplesPerFrame)
+			&& message.Read(job.time)
+			&& message.Read(job.hasCameraOrigin)
+			&& message.Read(job.cameraOrigin)
+			&& message.Read(job.hasCameraAngles)
+			&& message.Read(job.cameraYaw)
+			&& message.Read(job.cameraPitch)
+			&& message.Read(job.cameraFov)
+			&& message.Read(job.isHdr);
+		generator.distribution = static_cast<Scene_Generated::Distribution>(distribution);
+		return isRead && job.width > 0 && job.height > 0;
+	}
+
+	//Bytes of pixels in a tile result
+	size_t GetTileResultSize(const TileAssignment& tile, bool isHdr)
+	{
+		const size_t amountOfPixels = static_cast<size_t>(tile.width) * tile.height;
+		return isHdr ? amountOfPixels * 3 * sizeof(float) : amountOfPixels * sizeof(uint32_t);
+	}
+
+#if !defined(_WIN32)
+	bool SendAll(int socket, const std::vector<uint8_t>& bytes)
+	{
+#if defined(MSG_NOSIGNAL)
+		constexpr int flags{ MSG_NOSIGNAL }; //a worker that went away is an error, not a SIGPIPE
+#else
+		constexpr int flags{ 0 };
+#endif
+		size_t sent{ 0 };
+		while (sent < bytes.size())
+		{
+			const ssize_t result = send(socket, bytes.data() + sent, bytes.size() - sent, flags);
+			if (result < 0 && errno == EINTR) continue;
+			if (result <= 0) return false;
+			sent += static_cast<size_t>(result);
+		}
+		return true;
+	}
+
+	bool ReceiveAll(int socket, void* pData, size_t size)
+	{
+		uint8_t* pBytes = static_cast<uint8_t*>(pData);
+		size_t received{ 0 };
+		while (received < size)
+		{
+			const ssize_t result = recv(socket, pBytes + received, size - received, 0);
+			if (result < 0 && errno == EINTR) continue;
+			if (result <= 0) return false;
+			received += static_cast<size_t>(result);
+		}
+		return true;
+	}
+
+	//Blocks until a whole message arrived, false when the other side hung up
+	bool ReceiveMessage(int socket, MessageType& type, std::vector<uint8_t>& payload)
+	{
+		MessageHeader header{};
+		if (!ReceiveAll(socket, &header, sizeof(header)))
+			return false;
+		type = static_cast<MessageType>(header.type);
+		payload.resize(header.size);
+		return ReceiveAll(socket, payload.data(), payload.size());
+	}
+
+	void DisableNagle(int socket)
+	{
+		//Tile assignments are tiny and latency bound
+		const int isEnabled{ 1 };
+		setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &isEnabled, sizeof(isEnabled));
+	}
+
+	int Listen(uint16_t port, uint16_t& boundPort)
+	{
+		const int listener = socket(AF_INET, SOCK_STREAM, 0);
+		if (listener < 0)
+			return -1;
+
+		const int isEnabled{ 1 };
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &isEnabled, sizeof(isEnabled));
+
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_ANY);
+		address.sin_port = htons(port);
+		socklen_t addressSize = sizeof(address);
+		if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, 64) < 0
+			|| getsockname(listener, reinterpret_cast<sockaddr*>(&address), &addressSize) < 0)
+		{
+			close(listener);
+			return -1;
+		}
+		boundPort = ntohs(address.sin_port);
+		return listener;
+	}
+
+	int Connect(const std::string& host, uint16_t port)
+	{
+		addrinfo hints{};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo* pAddresses{};
+		if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &pAddresses) != 0)
+			return -1;
+
+		int connection{ -1 };
+		for (const addrinfo* pAddress = pAddresses; pAddress && connection < 0; pAddress = pAddress->ai_next)
+		{
+			connection = socket(pAddress->ai_family, pAddress->ai_socktype, pAddress->ai_protocol);
+			if (connection >= 0 && connect(connection, pAddress->ai_addr, pAddress->ai_addrlen) < 0)
+			{
+				close(connection);
+				connection = -1;
+			}
+		}
+		freeaddrinfo(pAddresses);
+		return connection;
+	}
+#endif
+}
+
+DistributedRenderer::DistributedRenderer(SceneFactory createScene, const Settings& settings) :
+	m_CreateScene{ std::move(createScene) },
+	m_Settings{ settings }
+{
+}
+
+Scene* DistributedRenderer::CreateJobScene(const SceneFactory& createScene, const Job& job)
+{
+	Scene* pScene = createScene(job.sceneName, job.generatorSettings);
+	if (!pScene)
+		return nullptr;
+
+	pScene->Activate();
+	pScene->WaitForContent();
+
+	Camera& camera = pScene->GetCamera();
+	camera.isInputEnabled = false;
+	if (job.hasCameraOrigin) camera.origin = job.cameraOrigin;
+	if (job.hasCameraAngles)
+	{
+		camera.totalYaw = job.cameraYaw * TO_RADIANS;
+		camera.totalPitch = job.cameraPitch * TO_RADIANS;
+	}
+	if (job.cameraFov > 0.f) camera.fovAngle = job.cameraFov;
+
+	Timer timer{};
+	timer.SetFixedTime(job.time, 0.f);
+	pScene->Update(&timer);
+	return pScene;
+}
+
+#if defined(_WIN32)
+bool DistributedRenderer::RunWorker(const SceneFactory&, const std::string&, uint16_t)
+{
+	std::cout << "Distributed rendering needs POSIX sockets" << std::endl;
+	return false;
+}
+
+bool DistributedRenderer::Run()
+{
+	std::cout << "Distributed rendering needs POSIX sockets" << std::endl;
+	return false;
+}
+#else
+bool DistributedRenderer::RunWorker(const SceneFactory& createScene, const std::string& host, uint16_t port)
+{
+	//Workers may be started before the coordinator
+	int connection{ -1 };
+	const auto connectStart = std::chrono::steady_clock::now();
+	while ((connection = Connect(host, port)) < 0 && std::chrono::steady_clock::now() - connectStart < std::chrono::seconds{ 30 })
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 250 });
+	if (connection < 0)
+	{
+		std::cout << "Could not connect to " << host << ":" << port << std::endl;
+		return false;
+	}
+	DisableNagle(connection);
+
+	Job job{};
+	std::unique_ptr<Scene> pScene{};
+	std::map<std::pair<int, int>, std::unique_ptr<Renderer>> renderers{}; //one per tile size, edge tiles are smaller
+	uint32_t amountOfTiles{ 0 };
+
+	MessageType type{};
+	std::vector<uint8_t> payload{};
+	bool isFailed{ false };
+	while (!isFailed && ReceiveMessage(connection, type, payload))
+	{
+		MessageReader message{ payload.data(), payload.size() };
+		if (type == MessageType::Job)
+		{
+			renderers.clear();
+			pScene.reset(DecodeJob(message, job) ? CreateJobScene(createScene, job) : nullptr);
+			isFailed = !pScene;
+			continue;
+		}
+
+		TileAssignment tile{};
+		isFailed = type != MessageType::Tile || !pScene || !message.Read(tile)
+			|| tile.x < 0 || tile.y < 0 || tile.width <= 0 || tile.height <= 0 || tile.x + tile.width > job.width || tile.y + tile.height > job.height;
+		if (isFailed)
+			break;
+
+		std::unique_ptr<Renderer>& pRenderer = renderers[{ tile.width, tile.height }];
+		if (!pRenderer)
+			pRenderer = std::make_unique<Renderer>(tile.width, tile.height);
+		pRenderer->SetCropWindow(job.width, job.height, tile.x, tile.y);
+
+		//Same samples in the same order as a render of the whole frame
+		pRenderer->ResetAccumulation();
+		for (int sample{ 0 }; sample < std::max(1, job.samplesPerFrame); ++sample)
+			pRenderer->Render(pScene.get());
+
+		MessageWriter result{ MessageType::TileResult };
+		result.Write(tile.id);
+		const size_t amountOfPixels = static_cast<size_t>(tile.width) * tile.height;
+		if (job.isHdr)
+		{
+			result.WriteBytes(pRenderer->GetHdrRed().data(), amountOfPixels * sizeof(float));
+			result.WriteBytes(pRenderer->GetHdrGreen().data(), amountOfPixels * sizeof(float));
+			result.WriteBytes(pRenderer->GetHdrBlue().data(), amountOfPixels * sizeof(float));
+		}
+		else
+			result.WriteBytes(pRenderer->GetPixels(), amountOfPixels * sizeof(uint32_t));
+		//The coordinator hangs up once it has every tile, this one was a copy it no longer needs
+		if (!SendAll(connection, result.Finish()))
+			break;
+		++amountOfTiles;
+	}
+
+	close(connection);
+	if (isFailed)
+		std::cout << "Worker stopped after " << amountOfTiles << " tiles, the job or a tile could not be rendered" << std::endl;
+	return !isFailed;
+}
+
+bool DistributedRenderer::Run()
+{
+	using Clock = std::chrono::steady_clock;
+	const Job& job = m_Settings.job;
+
+	uint16_t port{};
+	const int listener = Listen(m_Settings.port, port);
+	if (listener < 0)
+	{
+		std::cout << "Could not listen on port " << m_Settings.port << std::endl;
+		return false;
+	}
+
+	//Forked before this process starts any threads, a child only inherits the thread that forked
+	std::vector<pid_t> localWorkers{};
+	for (int worker{ 0 }; worker < m_Settings.localWorkers; ++worker)
+	{
+		const pid_t pid = fork();
+		if (pid == 0)
+		{
+			close(listener);
+			_exit(RunWorker(m_CreateScene, "127.0.0.1", port) ? 0 : 1);
+		}
+		if (pid > 0)
+			localWorkers.emplace_back(pid);
+	}
+
+	//Row by row, every tile is handed out once before any gets a copy
+	struct TileState
+	{
+		TileAssignment assignment{};
+		int copiesOut{ 0 };
+		bool isIssued{ false };
+		bool isDone{ false };
+		Clock::time_point issueTime{};
+	};
+	std::vector<TileState> tiles{};
+	std::deque<uint32_t> pendingTiles{};
+	const int tileSize = std::max(8, m_Settings.tileSize);
+	for (int y{ 0 }; y < job.height; y += tileSize)
+	{
+		for (int x{ 0 }; x < job.width; x += tileSize)
+		{
+			const TileAssignment assignment{ static_cast<uint32_t>(tiles.size()), x, y, std::min(tileSize, job.width - x), std::min(tileSize, job.height - y) };
+			pendingTiles.emplace_back(assignment.id);
+			tiles.emplace_back(TileState{ assignment });
+		}
+	}
+
+	const size_t amountOfPixels = static_cast<size_t>(job.width) * job.height;
+	std::vector<uint32_t> pixels(job.isHdr ? 0 : amountOfPixels);
+	std::vector<float> red(job.isHdr ? amountOfPixels : 0), green(red.size()), blue(red.size());
+
+	struct Connection
+	{
+		int socket{ -1 };
+		std::string name{};
+		std::vector<uint8_t> received{};
+		std::vector<uint32_t> tilesInFlight{};
+		int amountOfTiles{ 0 }; //results that were used
+		int amountOfCopies{ 0 }; //results another worker had already sent
+	};
+	std::vector<Connection> connections{};
+	std::vector<Connection> finishedConnections{}; //for the report
+
+	std::cout << "Coordinator listening on port " << port << ", " << tiles.size() << " tiles of " << tileSize << "x" << tileSize
+		<< " for a " << job.width << "x" << job.height << " frame" << std::endl;
+
+	const auto assignTiles = [&](Connection& connection)
+		{
+			while (connection.tilesInFlight.size() < static_cast<size_t>(std::max(1, m_Settings.tilesInFlight)))
+			{
+				uint32_t id{};
+				if (!pendingTiles.empty())
+				{
+					id = pendingTiles.front();
+					pendingTiles.pop_front();
+				}
+				else
+				{
+					//Nothing new left: a copy of the tile that's been out the longest, the first result wins
+					const TileState* pOldest{};
+					for (const TileState& tile : tiles)
+					{
+						if (tile.isDone || tile.copiesOut >= m_Settings.maxCopiesPerTile) continue;
+						if (std::find(connection.tilesInFlight.begin(), connection.tilesInFlight.end(), tile.assignment.id) != connection.tilesInFlight.end()) continue;
+						if (!pOldest || tile.issueTime < pOldest->issueTime) pOldest = &tile;
+					}
+					if (!pOldest) return;
+					id = pOldest->assignment.id;
+				}
+
+				TileState& tile = tiles[id];
+				MessageWriter message{ MessageType::Tile };
+				message.Write(tile.assignment);
+				if (!SendAll(connection.socket, message.Finish()))
+				{
+					if (!tile.isDone && tile.copiesOut == 0) pendingTiles.push_front(id);
+					return; //the read side notices the connection is gone
+				}
+				if (!tile.isIssued) tile.issueTime = Clock::now();
+				tile.isIssued = true;
+				++tile.copiesOut;
+				connection.tilesInFlight.emplace_back(id);
+			}
+		};
+
+	//False when the worker sent something that isn't a result for one of its tiles
+	const auto receiveResult = [&](Connection& connection, MessageType type, MessageReader& message, size_t size)
+		{
+			uint32_t id{};
+			if (type != MessageType::TileResult || !message.Read(id)) return false;
+
+			const auto inFlight = std::find(connection.tilesInFlight.begin(), connection.tilesInFlight.end(), id);
+			if (inFlight == connection.tilesInFlight.end()) return false;
+			TileState& tile = tiles[id];
+			if (size != sizeof(id) + GetTileResultSize(tile.assignment, job.isHdr)) return false;
+			connection.tilesInFlight.erase(inFlight);
+			--tile.copiesOut;
+
+			if (tile.isDone)
+			{
+				++connection.amountOfCopies;
+				return true;
+			}
+			tile.isDone = true;
+			++connection.amountOfTiles;
+
+			//HDR planes come one after the other: all of red, then green, then blue
+			const TileAssignment& assignment = tile.assignment;
+			const uint8_t* pTilePixels = message.GetPosition();
+			const size_t tilePixels = static_cast<size_t>(assignment.width) * assignment.height;
+			std::vector<float>* planes[3]{ &red, &green, &blue };
+			for (int row{ 0 }; row < assignment.height; ++row)
+			{
+				const size_t rowStart = assignment.x + static_cast<size_t>(assignment.y + row) * job.width;
+				const size_t tileRowStart = static_cast<size_t>(row) * assignment.width;
+				if (!job.isHdr)
+				{
+					std::memcpy(pixels.data() + rowStart, pTilePixels + tileRowStart * sizeof(uint32_t), assignment.width * sizeof(uint32_t));
+					continue;
+				}
+				for (size_t plane{ 0 }; plane < 3; ++plane)
+					std::memcpy(planes[plane]->data() + rowStart, pTilePixels + (plane * tilePixels + tileRowStart) * sizeof(float), assignment.width * sizeof(float));
+			}
+			return true;
+		};
+
+	const std::vector<uint8_t> jobMessage = EncodeJob(job);
+	const auto start = Clock::now();
+	auto lastConnected = start;
+	size_t amountOfDoneTiles{ 0 };
+	bool isFailed{ false };
+	while (amountOfDoneTiles < tiles.size())
+	{
+		std::vector<pollfd> pollFds{ pollfd{ listener, POLLIN, 0 } };
+		for (const Connection& connection : connections)
+			pollFds.emplace_back(pollfd{ connection.socket, POLLIN, 0 });
+		if (poll(pollFds.data(), pollFds.size(), 100) < 0 && errno != EINTR)
+		{
+			isFailed = true;
+			break;
+		}
+
+		if (pollFds[0].revents & POLLIN)
+		{
+			sockaddr_storage address{};
+			socklen_t addressSize = sizeof(address);
+			const int socket = accept(listener, reinterpret_cast<sockaddr*>(&address), &addressSize);
+			if (socket >= 0)
+			{
+				DisableNagle(socket);
+				char host[NI_MAXHOST]{}, service[NI_MAXSERV]{};
+				getnameinfo(reinterpret_cast<sockaddr*>(&address), addressSize, host, sizeof(host), service, sizeof(service), NI_NUMERICHOST | NI_NUMERICSERV);
+
+				Connection connection{ socket, std::string(host) + ":" + service };
+				if (SendAll(socket, jobMessage))
+				{
+					assignTiles(connection);
+					connections.emplace_back(std::move(connection));
+				}
+				else
+					close(socket);
+			}
+		}
+
+		for (size_t index{ 0 }; index < connections.size(); ++index)
+		{
+			Connection& connection = connections[index];
+			if (!(pollFds[index + 1].revents & (POLLIN | POLLHUP | POLLERR)))
+				continue;
+
+			//Take whatever arrived, a result is only used once all of it is there
+			bool isOpen{ true };
+			uint8_t buffer[1 << 16];
+			for (;;)
+			{
+				const ssize_t result = recv(connection.socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+				if (result > 0)
+				{
+					connection.received.insert(connection.received.end(), buffer, buffer + result);
+					continue;
+				}
+				isOpen = result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+				break;
+			}
+
+			size_t offset{ 0 };
+			while (isOpen && connection.received.size() - offset >= sizeof(MessageHeader))
+			{
+				MessageHeader header{};
+				std::memcpy(&header, connection.received.data() + offset, sizeof(header));
+				if (connection.received.size() - offset - sizeof(header) < header.size)
+					break;
+
+				MessageReader message{ connection.received.data() + offset + sizeof(header), header.size };
+				isOpen = receiveResult(connection, static_cast<MessageType>(header.type), message, header.size);
+				offset += sizeof(header) + header.size;
+			}
+			connection.received.erase(connection.received.begin(), connection.received.begin() + offset);
+
+			if (isOpen)
+			{
+				assignTiles(connection);
+				continue;
+			}
+
+			//Gone or misbehaving: its tiles go back to the front of the queue unless another worker has a copy
+			std::cout << "Worker " << connection.name << " disconnected with " << connection.tilesInFlight.size() << " tiles in flight" << std::endl;
+			for (const uint32_t id : connection.tilesInFlight)
+			{
+				TileState& tile = tiles[id];
+				if (--tile.copiesOut == 0 && !tile.isDone)
+					pendingTiles.push_front(id);
+			}
+			connection.tilesInFlight.clear();
+			close(connection.socket);
+			connection.socket = -1;
+		}
+
+		for (Connection& connection : connections)
+		{
+			if (connection.socket < 0)
+				finishedConnections.emplace_back(std::move(connection));
+		}
+		std::erase_if(connections, [](const Connection& connection) { return connection.socket < 0; });
+
+		amountOfDoneTiles = static_cast<size_t>(std::count_if(tiles.begin(), tiles.end(), [](const TileState& tile) { return tile.isDone; }));
+
+		//A returned tile goes to whoever has room first
+		for (Connection& connection : connections)
+			assignTiles(connection);
+
+		if (!connections.empty())
+			lastConnected = Clock::now();
+		else if (Clock::now() - lastConnected > std::chrono::duration<float>(m_Settings.connectTimeout))
+		{
+			std::cout << "No workers for " << m_Settings.connectTimeout << " s, " << amountOfDoneTiles << "/" << tiles.size() << " tiles rendered" << std::endl;
+			isFailed = true;
+			break;
+		}
+	}
+	const float seconds = std::chrono::duration<float>(Clock::now() - start).count();
+
+	//Workers quit when the coordinator hangs up
+	for (Connection& connection : connections)
+	{
+		close(connection.socket);
+		finishedConnections.emplace_back(std::move(connection));
+	}
+	close(listener);
+	for (const pid_t pid : localWorkers)
+		waitpid(pid, nullptr, 0);
+
+	if (isFailed)
+		return false;
+
+	std::cout << "Rendered " << tiles.size() << " tiles in " << seconds << " s on " << finishedConnections.size() << " workers" << std::endl;
+	for (const Connection& connection : finishedConnections)
+		std::cout << "  " << connection.name << ": " << connection.amountOfTiles << " tiles, " << connection.amountOfCopies << " late copies" << std::endl;
+
+	FrameWriter frameWriter{ 1 };
+	FrameWriter::Frame* pFrame = frameWriter.Acquire();
+	pFrame->width = job.width;
+	pFrame->height = job.height;
+	pFrame->format = m_Settings.format;
+	pFrame->prefix = m_Settings.prefix;
+	pFrame->number = 0;
+	pFrame->pixels = pixels;
+	pFrame->red = red;
+	pFrame->green = green;
+	pFrame->blue = blue;
+	frameWriter.Submit(pFrame);
+	frameWriter.Flush();
+	std::cout << "Written to " << frameWriter.GetLastFilename() << std::endl;
+
+	if (!m_Settings.isVerifying)
+		return true;
+
+	//The same frame in one piece on this machine, every pixel has to match
+	const std::unique_ptr<Scene> pScene{ CreateJobScene(m_CreateScene, job) };
+	if (!pScene)
+		return false;
+	Renderer renderer{ job.width, job.height };
+	for (int sample{ 0 }; sample < std::max(1, job.samplesPerFrame); ++sample)
+		renderer.Render(pScene.get());
+
+	size_t amountOfDifferentPixels{ 0 };
+	for (size_t pixel{ 0 }; pixel < amountOfPixels; ++pixel)
+	{
+		const bool isDifferent = job.isHdr
+			? red[pixel] != renderer.GetHdrRed()[pixel] || green[pixel] != renderer.GetHdrGreen()[pixel] || blue[pixel] != renderer.GetHdrBlue()[pixel]
+			: pixels[pixel] != renderer.GetPixels()[pixel];
+		if (isDifferent) ++amountOfDifferentPixels;
+	}
+	std::cout << "Verified against a local render: " << amountOfDifferentPixels << " different pixels" << std::endl;
+	return amountOfDifferentPixels == 0;
+}
+#endif
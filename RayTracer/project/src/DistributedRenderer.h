@@ -0,0 +1,80 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+#include <functional>
+#include <string>
+
+//Project includes
+#include "FrameWriter.h"
+#include "Scene.h"
+
+namespace dae
+{
+	/**
+	 * \brief Renders one still across worker processes on this and other machines. The coordinator listens on a TCP
+	 * port, every worker that connects gets the job (scene, time, camera, size) and then tiles, a few at a time so it's
+	 * never waiting on the network. Workers that finish sooner get more tiles. Once no tiles are left, idle workers get
+	 * copies of the ones that have been out the longest, the first result wins, so a slow or lost worker only costs
+	 * the time of one tile. Workers crop their renderer to the tile, the stitched frame equals a render on one machine.
+	 * POSIX sockets only, the coordinator and the workers have to agree on endianness.
+	 */
+	class DistributedRenderer final
+	{
+	public:
+		//Everything a worker needs to render any tile of the frame
+		struct Job
+		{
+			std::string sceneName{ "reference" }; //a built in scene or a scene file every worker can open
+			Scene_Generated::Settings generatorSettings{};
+			int width{ 640 };
+			int height{ 480 };
+			int samplesPerFrame{ 1 };
+			float time{ 0.f }; //seconds of animation
+			bool hasCameraOrigin{ false };
+			Vector3 cameraOrigin{};
+			bool hasCameraAngles{ false };
+			float cameraYaw{}, cameraPitch{}; //degrees
+			float cameraFov{ 0.f }; //0 keeps the scene's
+			bool isHdr{ false }; //workers send linear radiance instead of 8 bit pixels
+		};
+
+		struct Settings
+		{
+			Job job{};
+			uint16_t port{ 0 }; //0 picks a free one, workers on other machines need to be told which
+			int localWorkers{ 0 }; //forked on this machine
+			int tileSize{ 128 }; //a worker splits its tile over its own cores, tiles shouldn't be too small
+			int tilesInFlight{ 2 }; //per worker, hides the round trip
+			int maxCopiesPerTile{ 3 }; //the original and the copies given to idle workers at the end
+			float connectTimeout{ 30.f }; //seconds to wait while no worker is connected
+			std::string prefix{ "Frame" };
+			FrameWriter::Format format{ FrameWriter::Format::PNG };
+			bool isVerifying{ false }; //also render the frame here and compare every pixel
+		};
+
+		//Workers build the scene from the job's name, the generator settings are for the generated scene
+		using SceneFactory = std::function<Scene*(const std::string& sceneName, const Scene_Generated::Settings& generatorSettings)>;
+
+		DistributedRenderer(SceneFactory createScene, const Settings& settings);
+		~DistributedRenderer() = default;
+
+		DistributedRenderer(const DistributedRenderer&) = delete;
+		DistributedRenderer(DistributedRenderer&&) noexcept = delete;
+		DistributedRenderer& operator=(const DistributedRenderer&) = delete;
+		DistributedRenderer& operator=(DistributedRenderer&&) noexcept = delete;
+
+		//Coordinator: blocks until the frame is written, false when it couldn't be rendered (or didn't verify)
+		bool Run();
+
+		//Worker: connects to the coordinator, retrying for a while, and renders tiles until the coordinator hangs up
+		static bool RunWorker(const SceneFactory& createScene, const std::string& host, uint16_t port);
+
+	private:
+		SceneFactory m_CreateScene{};
+		Settings m_Settings{};
+
+		//The scene at the job's time with the job's camera, ready to render
+		static Scene* CreateJobScene(const SceneFactory& createScene, const Job& job);
+	};
+}
@@ -0,0 +1,125 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace dae;
+
+FileWatcher::FileWatcher()
+{
+#if defined(__linux__)
+	m_InotifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#if defined(__linux__)
+	if (m_InotifyHandle >= 0)
+		close(m_InotifyHandle);
+#endif
+}
+
+void FileWatcher::Watch(const std::string& filename)
+{
+	const std::string key = GetKey(filename);
+	if (!m_Files.emplace(key, filename).second)
+		return;
+
+#if defined(__linux__)
+	if (m_InotifyHandle >= 0)
+	{
+		const std::filesystem::path directory = std::filesystem::path(key).parent_path();
+		const int watchHandle = inotify_add_watch(m_InotifyHandle, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (watchHandle >= 0)
+		{
+			m_Directories[watchHandle] = directory;
+			return;
+		}
+	}
+#endif
+
+	m_WriteTimes[key] = GetWriteTime(key);
+}
+
+void FileWatcher::Clear()
+{
+#if defined(__linux__)
+	for (const auto& directory : m_Directories)
+		inotify_rm_watch(m_InotifyHandle, directory.first);
+#endif
+
+	m_Files.clear();
+	m_Directories.clear();
+	m_WriteTimes.clear();
+}
+
+std::vector<std::string> FileWatcher::Poll()
+{
+	std::vector<std::string> changedFiles{};
+	const auto addChange = [&](const std::string& key)
+		{
+			const auto it = m_Files.find(key);
+			if (it != m_Files.end() && std::find(changedFiles.begin(), changedFiles.end(), it->second) == changedFiles.end())
+				changedFiles.emplace_back(it->second);
+		};
+
+#if defined(__linux__)
+	if (m_InotifyHandle >= 0)
+	{
+		alignas(inotify_event) char buffer[4096];
+		ssize_t length{};
+		while ((length = read(m_InotifyHandle, buffer, sizeof(buffer))) > 0)
+		{
+			for (ssize_t offset{ 0 }; offset < length;)
+			{
+				const inotify_event* pEvent = reinterpret_cast<const inotify_event*>(buffer + offset);
+				offset += sizeof(inotify_event) + pEvent->len;
+
+				const auto it = m_Directories.find(pEvent->wd);
+				if (it != m_Directories.end() && pEvent->len > 0)
+					addChange((it->second / pEvent->name).string());
+			}
+		}
+	}
+#endif
+
+	if (m_WriteTimes.empty())
+		return changedFiles;
+
+	//Touching the file system for every file each frame adds up, two checks per second is plenty
+	const auto now = std::chrono::steady_clock::now();
+	if (now - m_LastPoll < std::chrono::milliseconds(500))
+		return changedFiles;
+	m_LastPoll = now;
+
+	for (auto& [key, writeTime] : m_WriteTimes)
+	{
+		const std::filesystem::file_time_type currentWriteTime = GetWriteTime(key);
+		if (currentWriteTime != writeTime)
+		{
+			writeTime = currentWriteTime;
+			addChange(key);
+		}
+	}
+
+	return changedFiles;
+}
+
+std::string FileWatcher::GetKey(const std::string& filename)
+{
+	std::error_code error{};
+	const std::filesystem::path path = std::filesystem::absolute(filename, error);
+	return (error ? std::filesystem::path(filename) : path).lexically_normal().string();
+}
+
+std::filesystem::file_time_type FileWatcher::GetWriteTime(const std::string& filename)
+{
+	std::error_code error{};
+	const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(filename, error);
+	return error ? std::filesystem::file_time_type{} : writeTime;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+//Standard includes
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace dae
+{
+	//Reports files that were written since the last poll. Uses inotify on Linux, elsewhere (or when inotify
+	//isn't available) it compares modification times a couple of times per second.
+	class FileWatcher final
+	{
+	public:
+		FileWatcher();
+		~FileWatcher();
+
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher(FileWatcher&&) noexcept = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+		FileWatcher& operator=(FileWatcher&&) noexcept = delete;
+
+		void Watch(const std::string& filename);
+		void Clear();
+
+		//Never blocks, every changed file is reported once (with the path it was watched with)
+		std::vector<std::string> Poll();
+
+	private:
+		//Absolute path -> path as passed to Watch
+		std::unordered_map<std::string, std::string> m_Files{};
+
+		//Directories are watched rather than files, editors often replace a file instead of writing to it
+		int m_InotifyHandle{ -1 };
+		std::unordered_map<int, std::filesystem::path> m_Directories{};
+
+		//Polling fallback
+		std::unordered_map<std::string, std::filesystem::file_time_type> m_WriteTimes{};
+		std::chrono::steady_clock::time_point m_LastPoll{};
+
+		static std::string GetKey(const std::string& filename);
+		static std::filesystem::file_time_type GetWriteTime(const std::string& filename);
+	};
+}
@@ -0,0 +1,144 @@
+#include "FrameTimeHistogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+using namespace dae;
+
+//Values below 2 * m_SubBuckets get a bucket each, above that every power of two is split in m_SubBuckets
+uint32_t FrameTimeHistogram::GetBucketIndex(uint64_t microseconds)
+{
+	microseconds = std::min(microseconds, (uint64_t{ 1 } << m_MaxMicrosecondBits) - 1);
+	if (microseconds < 2 * m_SubBuckets)
+		return static_cast<uint32_t>(microseconds);
+
+	const uint32_t highestBit = static_cast<uint32_t>(std::bit_width(microseconds)) - 1;
+	const uint32_t shift = highestBit - m_SubBucketBits;
+	const uint32_t subBucket = static_cast<uint32_t>(microseconds >> shift) - m_SubBuckets;
+	return 2 * m_SubBuckets + (shift - 1) * m_SubBuckets + subBucket;
+}
+
+uint64_t FrameTimeHistogram::GetBucketLowerBound(uint32_t index)
+{
+	if (index < 2 * m_SubBuckets)
+		return index;
+
+	const uint32_t shift = (index - 2 * m_SubBuckets) / m_SubBuckets + 1;
+	const uint64_t subBucket = (index - 2 * m_SubBuckets) % m_SubBuckets + m_SubBuckets;
+	return subBucket << shift;
+}
+
+uint64_t FrameTimeHistogram::GetBucketWidth(uint32_t index)
+{
+	return index < 2 * m_SubBuckets ? 1 : uint64_t{ 1 } << ((index - 2 * m_SubBuckets) / m_SubBuckets + 1);
+}
+
+void FrameTimeHistogram::Record(float seconds)
+{
+	const uint64_t microseconds = static_cast<uint64_t>(std::llround(std::max(seconds, 0.f) * 1e6f));
+
+	m_Buckets[GetBucketIndex(microseconds)].fetch_add(1, std::memory_order_relaxed);
+	m_SumMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+	m_SumSquaredMicroseconds.fetch_add(microseconds * microseconds, std::memory_order_relaxed);
+
+	uint64_t worst = m_WorstMicroseconds.load(std::memory_order_relaxed);
+	while (microseconds > worst && !m_WorstMicroseconds.compare_exchange_weak(worst, microseconds, std::memory_order_relaxed))
+	{
+	}
+
+	//Counted last, a reader never sees more frames than bucket entries
+	m_AmountOfFrames.fetch_add(1, std::memory_order_release);
+}
+
+void FrameTimeHistogram::Reset()
+{
+	m_AmountOfFrames.store(0, std::memory_order_relaxed);
+	for (std::atomic<uint64_t>& bucket : m_Buckets)
+		bucket.store(0, std::memory_order_relaxed);
+	m_SumMicroseconds.store(0, std::memory_order_relaxed);
+	m_SumSquaredMicroseconds.store(0, std::memory_order_relaxed);
+	m_WorstMicroseconds.store(0, std::memory_order_relaxed);
+}
+
+float FrameTimeHistogram::GetPercentileMs(float percentile) const
+{
+	const uint64_t amountOfFrames = m_AmountOfFrames.load(std::memory_order_acquire);
+	if (amountOfFrames == 0)
+		return 0.f;
+
+	//Nearest rank, the middle of the bucket it falls in, never more than the worst frame
+	const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0.f, 100.f) / 100.0 * amountOfFrames)));
+	uint64_t amountBelow{ 0 };
+	for (uint32_t index{ 0 }; index < m_AmountOfBuckets; ++index)
+	{
+		amountBelow += m_Buckets[index].load(std::memory_order_relaxed);
+		if (amountBelow >= rank)
+		{
+			const double middle = GetBucketLowerBound(index) + (GetBucketWidth(index) - 1) / 2.0;
+			return static_cast<float>(std::min(middle, static_cast<double>(m_WorstMicroseconds.load(std::memory_order_relaxed))) / 1000.0);
+		}
+	}
+	return m_WorstMicroseconds.load(std::memory_order_relaxed) / 1000.f;
+}
+
+FrameTimeHistogram::Summary FrameTimeHistogram::GetSummary() const
+{
+	Summary summary{};
+	summary.amountOfFrames = m_AmountOfFrames.load(std::memory_order_acquire);
+	if (summary.amountOfFrames == 0)
+		return summary;
+
+	const double frames = static_cast<double>(summary.amountOfFrames);
+	const double average = m_SumMicroseconds.load(std::memory_order_relaxed) / frames;
+	const double variance = m_SumSquaredMicroseconds.load(std::memory_order_relaxed) / frames - average * average;
+
+	summary.averageMs = static_cast<float>(average / 1000.0);
+	summary.standardDeviationMs = static_cast<float>(std::sqrt(std::max(variance, 0.0)) / 1000.0);
+	summary.p50Ms = GetPercentileMs(50.f);
+	summary.p90Ms = GetPercentileMs(90.f);
+	summary.p99Ms = GetPercentileMs(99.f);
+	summary.p999Ms = GetPercentileMs(99.9f);
+	summary.worstMs = m_WorstMicroseconds.load(std::memory_order_relaxed) / 1000.f;
+	return summary;
+}
+
+void FrameTimeHistogram::WriteCsvHeader(std::ostream& output)
+{
+	output << "frames,average ms,standard deviation ms,p50 ms,p90 ms,p99 ms,p99.9 ms,worst ms\n";
+}
+
+void FrameTimeHistogram::WriteCsv(std::ostream& output) const
+{
+	const Summary summary = GetSummary();
+	output << summary.amountOfFrames << "," << summary.averageMs << "," << summary.standardDeviationMs << "," << summary.p50Ms
+		<< "," << summary.p90Ms << "," << summary.p99Ms << "," << summary.p999Ms << "," << summary.worstMs << "\n";
+}
+
+void FrameTimeHistogram::WriteJson(std::ostream& output) const
+{
+	const Summary summary = GetSummary();
+	output << "{\n"
+		<< "\t\"frames\": " << summary.amountOfFrames << ",\n"
+		<< "\t\"averageMs\": " << summary.averageMs << ",\n"
+		<< "\t\"standardDeviationMs\": " << summary.standardDeviationMs << ",\n"
+		<< "\t\"p50Ms\": " << summary.p50Ms << ",\n"
+		<< "\t\"p90Ms\": " << summary.p90Ms << ",\n"
+		<< "\t\"p99Ms\": " << summary.p99Ms << ",\n"
+		<< "\t\"p999Ms\": " << summary.p999Ms << ",\n"
+		<< "\t\"worstMs\": " << summary.worstMs << ",\n"
+		<< "\t\"buckets\": [";
+
+	bool isFirst{ true };
+	for (uint32_t index{ 0 }; index < m_AmountOfBuckets; ++index)
+	{
+		const uint64_t amount = m_Buckets[index].load(std::memory_order_relaxed);
+		if (amount == 0)
+			continue;
+
+		output << (isFirst ? "\n" : ",\n") << "\t\t{ \"fromMs\": " << GetBucketLowerBound(index) / 1000.0
+			<< ", \"toMs\": " << (GetBucketLowerBound(index) + GetBucketWidth(index)) / 1000.0 << ", \"frames\": " << amount << " }";
+		isFirst = false;
+	}
+	output << "\n\t]\n}\n";
+}
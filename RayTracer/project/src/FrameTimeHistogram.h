@@ -0,0 +1,70 @@
+#pragma once
+
+//Standard includes
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace dae
+{
+	/**
+	 * \brief Every frame time in microsecond buckets that are at most ~3% wide (32 per power of two), so percentiles
+	 * of millions of frames cost a few KB. Record only does relaxed atomic adds, any thread can record or read
+	 * while others record.
+	 */
+	class FrameTimeHistogram final
+	{
+	public:
+		struct Summary
+		{
+			uint64_t amountOfFrames{};
+			float averageMs{};
+			float standardDeviationMs{};
+			float p50Ms{};
+			float p90Ms{};
+			float p99Ms{};
+			float p999Ms{};
+			float worstMs{};
+		};
+
+		FrameTimeHistogram() = default;
+		~FrameTimeHistogram() = default;
+
+		FrameTimeHistogram(const FrameTimeHistogram&) = delete;
+		FrameTimeHistogram(FrameTimeHistogram&&) noexcept = delete;
+		FrameTimeHistogram& operator=(const FrameTimeHistogram&) = delete;
+		FrameTimeHistogram& operator=(FrameTimeHistogram&&) noexcept = delete;
+
+		void Record(float seconds);
+		//Not safe against concurrent Record calls, frames recorded during a reset may partially survive it
+		void Reset();
+
+		uint64_t GetAmountOfFrames() const { return m_AmountOfFrames.load(std::memory_order_relaxed); }
+		//Frame time in ms that percentile (0-100) of the frames didn't exceed
+		float GetPercentileMs(float percentile) const;
+		Summary GetSummary() const;
+
+		//One row per run, so runs can be appended to the same file
+		static void WriteCsvHeader(std::ostream& output);
+		void WriteCsv(std::ostream& output) const;
+		//The summary and every non-empty bucket
+		void WriteJson(std::ostream& output) const;
+
+	private:
+		static constexpr uint32_t m_SubBucketBits{ 5 };
+		static constexpr uint32_t m_SubBuckets{ 1u << m_SubBucketBits };
+		static constexpr uint32_t m_MaxMicrosecondBits{ 36 }; //longer than 19 hours lands in the last bucket
+		static constexpr uint32_t m_AmountOfBuckets{ 2 * m_SubBuckets + (m_MaxMicrosecondBits - m_SubBucketBits - 1) * m_SubBuckets };
+
+		static uint32_t GetBucketIndex(uint64_t microseconds);
+		static uint64_t GetBucketLowerBound(uint32_t index);
+		static uint64_t GetBucketWidth(uint32_t index);
+
+		std::array<std::atomic<uint64_t>, m_AmountOfBuckets> m_Buckets{};
+		std::atomic<uint64_t> m_AmountOfFrames{ 0 };
+		std::atomic<uint64_t> m_SumMicroseconds{ 0 };
+		std::atomic<uint64_t> m_SumSquaredMicroseconds{ 0 };
+		std::atomic<uint64_t> m_WorstMicroseconds{ 0 };
+	};
+}
@@ -0,0 +1,351 @@
+#include "FrameWriter.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+using namespace dae;
+
+namespace
+{
+	//Big endian, as PNG wants it
+	void AppendUint32(std::vector<uint8_t>& bytes, uint32_t value)
+	{
+		bytes.push_back(static_cast<uint8_t>(value >> 24));
+		bytes.push_back(static_cast<uint8_t>(value >> 16));
+		bytes.push_back(static_cast<uint8_t>(value >> 8));
+		bytes.push_back(static_cast<uint8_t>(value));
+	}
+
+	//Little endian, as EXR wants it
+	template<typename T>
+	void AppendRaw(std::vector<uint8_t>& bytes, const T& value)
+	{
+		const uint8_t* pValue = reinterpret_cast<const uint8_t*>(&value);
+		bytes.insert(bytes.end(), pValue, pValue + sizeof(T));
+	}
+
+	void AppendString(std::vector<uint8_t>& bytes, const char* pString)
+	{
+		do bytes.push_back(static_cast<uint8_t>(*pString)); while (*pString++);
+	}
+
+	uint32_t Crc32(const uint8_t* pData, size_t size, uint32_t crc = 0)
+	{
+		static const std::array<uint32_t, 256> table = []
+			{
+				std::array<uint32_t, 256> values{};
+				for (uint32_t i{ 0 }; i < 256; ++i)
+				{
+					uint32_t value = i;
+					for (int bit{ 0 }; bit < 8; ++bit)
+						value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+					values[i] = value;
+				}
+				return values;
+			}();
+
+		crc = ~crc;
+		for (size_t i{ 0 }; i < size; ++i)
+			crc = table[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	void WritePngChunk(std::ofstream& file, const char* pType, const std::vector<uint8_t>& data)
+	{
+		std::vector<uint8_t> chunk{};
+		chunk.reserve(data.size() + 12);
+		AppendUint32(chunk, static_cast<uint32_t>(data.size()));
+		chunk.insert(chunk.end(), pType, pType + 4);
+		chunk.insert(chunk.end(), data.begin(), data.end());
+		AppendUint32(chunk, Crc32(chunk.data() + 4, chunk.size() - 4));
+		file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+	}
+
+	std::vector<uint8_t> GetRGB(const FrameWriter::Frame& frame, bool addFilterBytes)
+	{
+		std::vector<uint8_t> rgb{};
+		rgb.reserve(frame.pixels.size() * 3 + (addFilterBytes ? frame.height : 0));
+		for (int y{ 0 }; y < frame.height; ++y)
+		{
+			if (addFilterBytes)
+				rgb.push_back(0);
+
+			for (int x{ 0 }; x < frame.width; ++x)
+			{
+				const uint32_t pixel = frame.pixels[x + y * frame.width];
+				rgb.push_back(static_cast<uint8_t>(pixel >> frame.redShift));
+				rgb.push_back(static_cast<uint8_t>(pixel >> frame.greenShift));
+				rgb.push_back(static_cast<uint8_t>(pixel >> frame.blueShift));
+			}
+		}
+		return rgb;
+	}
+
+	bool WritePPM(std::ofstream& file, const FrameWriter::Frame& frame)
+	{
+		file << "P6\n" << frame.width << " " << frame.height << "\n255\n";
+		const std::vector<uint8_t> rgb = GetRGB(frame, false);
+		file.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+		return static_cast<bool>(file);
+	}
+
+	//Stored (uncompressed) deflate blocks, compressing would cost more time than the disk space is worth
+	bool WritePNG(std::ofstream& file, const FrameWriter::Frame& frame)
+	{
+		constexpr uint8_t signature[]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+		std::vector<uint8_t> header{};
+		AppendUint32(header, static_cast<uint32_t>(frame.width));
+		AppendUint32(header, static_cast<uint32_t>(frame.height));
+		header.insert(header.end(), { 8, 2, 0, 0, 0 }); //8 bit RGB, no interlacing
+		WritePngChunk(file, "IHDR", header);
+
+		const std::vector<uint8_t> scanlines = GetRGB(frame, true);
+
+		std::vector<uint8_t> zlib{ 0x78, 0x01 };
+		zlib.reserve(scanlines.size() + scanlines.size() / 65535 * 5 + 16);
+		uint32_t adlerA{ 1 }, adlerB{ 0 };
+		for (size_t offset{ 0 }; offset < scanlines.size() || offset == 0;)
+		{
+			const size_t blockSize = std::min<size_t>(65535, scanlines.size() - offset);
+			const bool isLast = offset + blockSize == scanlines.size();
+			zlib.push_back(isLast ? 1 : 0);
+			zlib.push_back(static_cast<uint8_t>(blockSize));
+			zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+			zlib.push_back(static_cast<uint8_t>(~blockSize));
+			zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+			zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + blockSize);
+
+			for (size_t i{ offset }; i < offset + blockSize; ++i)
+			{
+				adlerA = (adlerA + scanlines[i]) % 65521;
+				adlerB = (adlerB + adlerA) % 65521;
+			}
+
+			offset += blockSize;
+			if (isLast) break;
+		}
+		AppendUint32(zlib, (adlerB << 16) | adlerA);
+		WritePngChunk(file, "IDAT", zlib);
+		WritePngChunk(file, "IEND", {});
+
+		return static_cast<bool>(file);
+	}
+
+	//Scanline OpenEXR without compression, channels have to be listed alphabetically
+	bool WriteEXR(std::ofstream& file, const FrameWriter::Frame& frame)
+	{
+		std::vector<uint8_t> header{ 0x76, 0x2F, 0x31, 0x01, 2, 0, 0, 0 };
+
+		const auto addAttribute = [&header](const char* pName, const char* pType, int32_t size)
+			{
+				AppendString(header, pName);
+				AppendString(header, pType);
+				AppendRaw(header, size);
+			};
+
+		addAttribute("channels", "chlist", 3 * 18 + 1);
+		for (const char* pChannel : { "B", "G", "R" })
+		{
+			AppendString(header, pChannel);
+			AppendRaw(header, int32_t{ 2 }); //FLOAT
+			AppendRaw(header, int32_t{ 0 }); //pLinear + reserved
+			AppendRaw(header, int32_t{ 1 }); //x sampling
+			AppendRaw(header, int32_t{ 1 }); //y sampling
+		}
+		header.push_back(0);
+
+		addAttribute("compression", "compression", 1);
+		header.push_back(0);
+
+		const int32_t window[]{ 0, 0, frame.width - 1, frame.height - 1 };
+		addAttribute("dataWindow", "box2i", sizeof(window));
+		AppendRaw(header, window);
+		addAttribute("displayWindow", "box2i", sizeof(window));
+		AppendRaw(header, window);
+
+		addAttribute("lineOrder", "lineOrder", 1);
+		header.push_back(0); //increasing y
+
+		addAttribute("pixelAspectRatio", "float", 4);
+		AppendRaw(header, 1.f);
+		addAttribute("screenWindowCenter", "v2f", 8);
+		AppendRaw(header, 0.f);
+		AppendRaw(header, 0.f);
+		addAttribute("screenWindowWidth", "float", 4);
+		AppendRaw(header, 1.f);
+		header.push_back(0);
+
+		//One scanline per block: y, size, then every channel's row
+		const int32_t rowBytes = frame.width * static_cast<int32_t>(sizeof(float));
+		const uint64_t blockBytes = 8 + 3 * static_cast<uint64_t>(rowBytes);
+		const uint64_t firstBlock = header.size() + 8 * static_cast<uint64_t>(frame.height);
+		for (int y{ 0 }; y < frame.height; ++y)
+			AppendRaw(header, firstBlock + y * blockBytes);
+		file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+		for (int32_t y{ 0 }; y < frame.height; ++y)
+		{
+			const int32_t dataBytes = 3 * rowBytes;
+			file.write(reinterpret_cast<const char*>(&y), sizeof(y));
+			file.write(reinterpret_cast<const char*>(&dataBytes), sizeof(dataBytes));
+			for (const std::vector<float>* pChannel : { &frame.blue, &frame.green, &frame.red })
+				file.write(reinterpret_cast<const char*>(pChannel->data() + y * frame.width), rowBytes);
+		}
+
+		return static_cast<bool>(file);
+	}
+}
+
+FrameWriter::FrameWriter(size_t amountOfFrames)
+{
+	for (size_t i{ 0 }; i < std::max<size_t>(1, amountOfFrames); ++i)
+	{
+		m_Frames.emplace_back(std::make_unique<Frame>());
+		m_FreeFrames.emplace_back(m_Frames.back().get());
+	}
+
+	m_Thread = std::thread(&FrameWriter::Run, this);
+}
+
+FrameWriter::~FrameWriter()
+{
+	//Whatever is queued still gets written
+	{
+		const std::lock_guard lock{ m_Mutex };
+		m_IsStopping = true;
+	}
+	m_FrameQueued.notify_one();
+	m_Thread.join();
+}
+
+FrameWriter::Frame* FrameWriter::Acquire()
+{
+	std::unique_lock lock{ m_Mutex };
+	m_FrameFreed.wait(lock, [this] { return !m_FreeFrames.empty(); });
+
+	Frame* pFrame = m_FreeFrames.back();
+	m_FreeFrames.pop_back();
+	return pFrame;
+}
+
+void FrameWriter::Submit(Frame* pFrame)
+{
+	{
+		const std::lock_guard lock{ m_Mutex };
+		m_Queue.emplace_back(pFrame);
+	}
+	m_FrameQueued.notify_one();
+}
+
+void FrameWriter::Flush()
+{
+	std::unique_lock lock{ m_Mutex };
+	m_FrameFreed.wait(lock, [this] { return m_FreeFrames.size() == m_Frames.size(); });
+}
+
+uint32_t FrameWriter::GetAmountOfWrittenFrames() const
+{
+	const std::lock_guard lock{ m_Mutex };
+	return m_AmountOfWrittenFrames;
+}
+
+std::string FrameWriter::GetLastFilename() const
+{
+	const std::lock_guard lock{ m_Mutex };
+	return m_LastFilename;
+}
+
+bool FrameWriter::Write(const Frame& frame, const std::string& filename)
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+		return false;
+
+	switch (frame.format)
+	{
+	case Format::PPM:
+		return WritePPM(file, frame);
+	case Format::PNG:
+		return WritePNG(file, frame);
+	case Format::EXR:
+		return WriteEXR(file, frame);
+	}
+	return false;
+}
+
+const char* FrameWriter::GetExtension(Format format)
+{
+	switch (format)
+	{
+	case Format::PPM:
+		return ".ppm";
+	case Format::PNG:
+		return ".png";
+	case Format::EXR:
+		return ".exr";
+	}
+	return "";
+}
+
+void FrameWriter::Run()
+{
+	std::unique_lock lock{ m_Mutex };
+	while (true)
+	{
+		m_FrameQueued.wait(lock, [this] { return m_IsStopping || !m_Queue.empty(); });
+		if (m_Queue.empty())
+			return;
+
+		Frame* pFrame = m_Queue.front();
+		m_Queue.pop_front();
+
+		//Encoding and disk access happen without the lock, the render thread can keep acquiring frames
+		lock.unlock();
+		const std::string filename = CreateFilename(*pFrame);
+		bool isWritten{};
+		{
+			if (Trace::IsRecording()) Trace::SetThreadName("Frame writer");
+			TRACE_SCOPE("FrameWriter::Write");
+			isWritten = Write(*pFrame, filename);
+		}
+		if (!isWritten)
+			std::cout << "Could not write " << filename << std::endl;
+		lock.lock();
+
+		if (isWritten)
+		{
+			++m_AmountOfWrittenFrames;
+			m_LastFilename = filename;
+		}
+		m_FreeFrames.emplace_back(pFrame);
+		m_FrameFreed.notify_all();
+	}
+}
+
+std::string FrameWriter::CreateFilename(const Frame& frame)
+{
+	const std::string extension = GetExtension(frame.format);
+	char suffix[16]{};
+	if (frame.number >= 0)
+	{
+		std::snprintf(suffix, sizeof(suffix), "_%05d", frame.number);
+		return frame.prefix + suffix + extension;
+	}
+
+	uint32_t& number = m_NextNumbers[frame.prefix + extension];
+	std::string filename{};
+	do
+	{
+		std::snprintf(suffix, sizeof(suffix), "_%05u", number++);
+		filename = frame.prefix + suffix + extension;
+	} while (std::filesystem::exists(filename));
+
+	return filename;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+//Standard includes
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace dae
+{
+	/**
+	 * \brief Encodes and writes frames on a background thread. The render thread only copies its buffers into
+	 * one of a fixed pool of frames, when every frame of the pool is still queued Acquire blocks until the
+	 * writer catches up, so capturing a sequence can never queue up unbounded memory.
+	 * Files are numbered, <prefix>_00000.<extension>, existing files are only overwritten when a frame asks for a number.
+	 */
+	class FrameWriter final
+	{
+	public:
+		enum class Format
+		{
+			PPM,
+			PNG,
+			EXR //linear HDR, 32 bit float channels
+		};
+
+		struct Frame
+		{
+			int width{};
+			int height{};
+			Format format{ Format::PNG };
+			std::string prefix{};
+			int number{ -1 }; //-1 picks the next free number, otherwise an existing file is replaced
+
+			//8 bit pixels as packed by the surface, used by PPM and PNG
+			std::vector<uint32_t> pixels{};
+			int redShift{ 16 }, greenShift{ 8 }, blueShift{ 0 };
+
+			//Linear radiance, one plane per channel, used by EXR
+			std::vector<float> red{};
+			std::vector<float> green{};
+			std::vector<float> blue{};
+		};
+
+		explicit FrameWriter(size_t amountOfFrames = 4);
+		~FrameWriter();
+
+		FrameWriter(const FrameWriter&) = delete;
+		FrameWriter(FrameWriter&&) noexcept = delete;
+		FrameWriter& operator=(const FrameWriter&) = delete;
+		FrameWriter& operator=(FrameWriter&&) noexcept = delete;
+
+		//A free frame to fill in, blocks while all of them are waiting to be written
+		Frame* Acquire();
+		//Hands a frame acquired with Acquire to the writer thread
+		void Submit(Frame* pFrame);
+		//Blocks until everything submitted so far is on disk
+		void Flush();
+
+		uint32_t GetAmountOfWrittenFrames() const;
+		//Filename of the last frame written, empty if none
+		std::string GetLastFilename() const;
+
+		static bool Write(const Frame& frame, const std::string& filename);
+		static const char* GetExtension(Format format);
+
+	private:
+		std::vector<std::unique_ptr<Frame>> m_Frames{};
+		std::vector<Frame*> m_FreeFrames{};
+		std::deque<Frame*> m_Queue{};
+
+		mutable std::mutex m_Mutex{};
+		std::condition_variable m_FrameQueued{};
+		std::condition_variable m_FrameFreed{};
+		bool m_IsStopping{ false };
+
+		uint32_t m_AmountOfWrittenFrames{ 0 };
+		std::string m_LastFilename{};
+		std::unordered_map<std::string, uint32_t> m_NextNumbers{}; //per prefix + extension, writer thread only
+
+		std::thread m_Thread{};
+
+		void Run();
+		std::string CreateFilename(const Frame& frame);
+	};
+}
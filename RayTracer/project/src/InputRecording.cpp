@@ -0,0 +1,156 @@
+#include "InputRecording.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+using namespace dae;
+
+namespace
+{
+	//Bits of the keys column
+	constexpr int g_Forward{ 1 }, g_Back{ 2 }, g_Right{ 4 }, g_Left{ 8 }, g_Boost{ 16 };
+	//Bits of the buttons column
+	constexpr int g_LeftButton{ 1 }, g_RightButton{ 2 };
+}
+
+bool InputRecording::StartRecording(const std::string& filename)
+{
+	m_File.open(filename);
+	if (!m_File)
+		return false;
+
+	WriteHeader(m_File);
+	return true;
+}
+
+void InputRecording::Record(const Frame& frame)
+{
+	if (!m_File.is_open())
+		return;
+
+	WriteFrame(m_File, frame);
+	m_File.flush();
+}
+
+bool InputRecording::Load(const std::string& filename)
+{
+	std::ifstream file{ filename };
+	return file && Load(file);
+}
+
+bool InputRecording::Load(std::istream& input)
+{
+	m_Frames.clear();
+	std::string line{};
+	while (std::getline(input, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		Frame frame{};
+		if (!ReadFrame(line, frame))
+			return false;
+		m_Frames.emplace_back(std::move(frame));
+	}
+	return true;
+}
+
+InputRecording::Frame InputRecording::Capture(int sceneIndex, const Timer& timer, const Camera& camera)
+{
+	Frame frame{};
+	frame.sceneIndex = sceneIndex;
+	frame.totalTime = timer.GetTotal();
+	frame.elapsedTime = timer.GetElapsed();
+	frame.input = camera.input;
+	frame.origin = camera.origin;
+	frame.yaw = camera.totalYaw;
+	frame.pitch = camera.totalPitch;
+	frame.fov = camera.fovAngle;
+	return frame;
+}
+
+bool InputRecording::ApplyPose(const Frame& frame, Camera& camera)
+{
+	//A few ulps of drift are rounding, more means the input was applied differently
+	constexpr float tolerance{ 1e-4f };
+	const bool isMatching = (camera.origin - frame.origin).Magnitude() <= tolerance * std::max(1.f, frame.origin.Magnitude())
+		&& std::abs(camera.totalYaw - frame.yaw) <= tolerance && std::abs(camera.totalPitch - frame.pitch) <= tolerance
+		&& camera.fovAngle == frame.fov;
+
+	camera.origin = frame.origin;
+	camera.totalYaw = frame.yaw;
+	camera.totalPitch = frame.pitch;
+	camera.fovAngle = frame.fov;
+	return isMatching;
+}
+
+void InputRecording::WriteHeader(std::ostream& output)
+{
+	output << "# RayTracer input recording, one line per frame\n"
+		<< "# scene total elapsed keys mouseX mouseY buttons x y z yaw pitch fov functionKeys\n";
+}
+
+void InputRecording::WriteFrame(std::ostream& output, const Frame& frame)
+{
+	const CameraInput& input = frame.input;
+	const int keys = (input.isMovingForward ? g_Forward : 0) | (input.isMovingBack ? g_Back : 0) | (input.isMovingRight ? g_Right : 0)
+		| (input.isMovingLeft ? g_Left : 0) | (input.isBoosting ? g_Boost : 0);
+	const int buttons = (input.isLeftButtonDown ? g_LeftButton : 0) | (input.isRightButtonDown ? g_RightButton : 0);
+
+	std::ostringstream line{};
+	line << std::setprecision(std::numeric_limits<float>::max_digits10)
+		<< frame.sceneIndex << " " << frame.totalTime << " " << frame.elapsedTime << " "
+		<< keys << " " << input.mouseX << " " << input.mouseY << " " << buttons << " "
+		<< frame.origin.x << " " << frame.origin.y << " " << frame.origin.z << " "
+		<< frame.yaw << " " << frame.pitch << " " << frame.fov << " ";
+
+	if (frame.functionKeys.empty())
+		line << "-";
+	for (size_t i{ 0 }; i < frame.functionKeys.size(); ++i)
+		line << (i ? "," : "") << frame.functionKeys[i];
+	output << line.str() << "\n";
+}
+
+bool InputRecording::ReadFrame(const std::string& line, Frame& frame)
+{
+	std::istringstream input{ line };
+	int keys{}, buttons{};
+	std::string functionKeys{};
+	input >> frame.sceneIndex >> frame.totalTime >> frame.elapsedTime
+		>> keys >> frame.input.mouseX >> frame.input.mouseY >> buttons
+		>> frame.origin.x >> frame.origin.y >> frame.origin.z
+		>> frame.yaw >> frame.pitch >> frame.fov >> functionKeys;
+	if (!input || frame.sceneIndex < 0)
+		return false;
+
+	frame.input.isMovingForward = keys & g_Forward;
+	frame.input.isMovingBack = keys & g_Back;
+	frame.input.isMovingRight = keys & g_Right;
+	frame.input.isMovingLeft = keys & g_Left;
+	frame.input.isBoosting = keys & g_Boost;
+	frame.input.isLeftButtonDown = buttons & g_LeftButton;
+	frame.input.isRightButtonDown = buttons & g_RightButton;
+
+	frame.functionKeys.clear();
+	if (functionKeys == "-")
+		return true;
+
+	std::istringstream keyList{ functionKeys };
+	std::string key{};
+	while (std::getline(keyList, key, ','))
+	{
+		try
+		{
+			frame.functionKeys.emplace_back(std::stoi(key));
+		}
+		catch (const std::exception&)
+		{
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+//Standard includes
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "Camera.h"
+
+namespace dae
+{
+	class Timer;
+
+	/**
+	 * \brief Everything that decides what a windowed frame renders: the scene, the simulated time, the input, the
+	 * camera pose it led to and the render mode keys pressed. A recording replayed with --replay renders the same
+	 * frames in the same order on every run and every build, so frame times of two builds can be compared.
+	 * The file is text, one frame per line, floats with enough digits to read back bit for bit.
+	 */
+	class InputRecording final
+	{
+	public:
+		struct Frame
+		{
+			int sceneIndex{};
+			float totalTime{};
+			float elapsedTime{};
+			CameraInput input{};
+			Vector3 origin{};
+			float yaw{}; //radians
+			float pitch{};
+			float fov{}; //degrees
+			std::vector<int> functionKeys{}; //F2, F3, F5..F8 toggle render modes, 2 for F2
+		};
+
+		InputRecording() = default;
+		~InputRecording() = default;
+
+		InputRecording(const InputRecording&) = delete;
+		InputRecording(InputRecording&&) noexcept = delete;
+		InputRecording& operator=(const InputRecording&) = delete;
+		InputRecording& operator=(InputRecording&&) noexcept = delete;
+
+		//Recording: every frame is written as soon as it's recorded, a crash keeps what came before it
+		bool StartRecording(const std::string& filename);
+		bool IsRecording() const { return m_File.is_open(); }
+		void Record(const Frame& frame);
+
+		//Replay: false when the file is missing or a line can't be read
+		bool Load(const std::string& filename);
+		bool Load(std::istream& input);
+		const std::vector<Frame>& GetFrames() const { return m_Frames; }
+
+		//The frame as the scene update left it, call after Scene::Update
+		static Frame Capture(int sceneIndex, const Timer& timer, const Camera& camera);
+		//Puts the camera where the recording had it, false when the replayed input led somewhere else
+		//(another build may round differently, the pose is corrected so the workload stays the same)
+		static bool ApplyPose(const Frame& frame, Camera& camera);
+
+		static void WriteHeader(std::ostream& output);
+		static void WriteFrame(std::ostream& output, const Frame& frame);
+		static bool ReadFrame(const std::string& line, Frame& frame);
+
+	private:
+		std::ofstream m_File{};
+		std::vector<Frame> m_Frames{};
+	};
+}
@@ -0,0 +1,107 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace dae;
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+#if defined(_WIN32)
+	m_FileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_FileHandle == INVALID_HANDLE_VALUE)
+	{
+		m_FileHandle = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(m_FileHandle, &size))
+	{
+		Close();
+		return false;
+	}
+	m_Size = static_cast<size_t>(size.QuadPart);
+	m_IsOpen = true;
+
+	//Empty files can't be mapped, but are valid
+	if (m_Size == 0) return true;
+
+	m_MappingHandle = CreateFileMappingA(m_FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_MappingHandle)
+	{
+		Close();
+		return false;
+	}
+
+	m_pData = static_cast<const char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (!m_pData)
+	{
+		Close();
+		return false;
+	}
+#else
+	const int fileDescriptor = open(filename.c_str(), O_RDONLY);
+	if (fileDescriptor < 0) return false;
+
+	struct stat fileStat {};
+	if (fstat(fileDescriptor, &fileStat) != 0)
+	{
+		close(fileDescriptor);
+		return false;
+	}
+	m_Size = static_cast<size_t>(fileStat.st_size);
+	m_IsOpen = true;
+
+	if (m_Size > 0)
+	{
+		void* pMapping = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (pMapping == MAP_FAILED)
+		{
+			close(fileDescriptor);
+			m_Size = 0;
+			m_IsOpen = false;
+			return false;
+		}
+		madvise(pMapping, m_Size, MADV_WILLNEED);
+		m_pData = static_cast<const char*>(pMapping);
+	}
+
+	//The mapping stays valid after the descriptor is closed
+	close(fileDescriptor);
+#endif
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#if defined(_WIN32)
+	if (m_pData) UnmapViewOfFile(m_pData);
+	if (m_MappingHandle) CloseHandle(m_MappingHandle);
+	if (m_FileHandle) CloseHandle(m_FileHandle);
+	m_MappingHandle = nullptr;
+	m_FileHandle = nullptr;
+#else
+	if (m_pData) munmap(const_cast<char*>(m_pData), m_Size);
+#endif
+
+	m_pData = nullptr;
+	m_Size = 0;
+	m_IsOpen = false;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+//Standard includes
+#include <cstddef>
+#include <string>
+
+namespace dae
+{
+	//Read-only memory mapping of a whole file, the OS pages it in on demand
+	class MappedFile final
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) noexcept = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&&) noexcept = delete;
+
+		bool Open(const std::string& filename);
+		void Close();
+
+		const char* GetData() const { return m_pData; }
+		size_t GetSize() const { return m_Size; }
+		bool IsOpen() const { return m_IsOpen; }
+
+	private:
+		const char* m_pData{ nullptr };
+		size_t m_Size{ 0 };
+		bool m_IsOpen{ false };
+
+#if defined(_WIN32)
+		void* m_FileHandle{ nullptr };
+		void* m_MappingHandle{ nullptr };
+#endif
+	};
+}
@@ -0,0 +1,105 @@
+#include "OfflineRenderer.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Timer.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace dae;
+
+OfflineRenderer::OfflineRenderer(SceneFactory createScene, const Settings& settings) :
+	m_CreateScene{ std::move(createScene) },
+	m_Settings{ settings }
+{
+}
+
+int OfflineRenderer::GetConcurrentFrames() const
+{
+	const int amountOfThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+	if (m_Settings.concurrentFrames > 0)
+		return std::min(m_Settings.concurrentFrames, m_Settings.amountOfFrames);
+
+	//A frame keeps every core busy when it has a few 32x32 tiles per thread. Beyond that a second frame
+	//still helps, it fills the gaps while the first one sorts, resolves and hands off its image.
+	const int amountOfTiles = ((m_Settings.width + 31) / 32) * ((m_Settings.height + 31) / 32);
+	const int framesToFillCores = 1 + (4 * amountOfThreads + amountOfTiles - 1) / amountOfTiles;
+	return std::clamp(framesToFillCores, 1, std::max(1, std::min(amountOfThreads, m_Settings.amountOfFrames)));
+}
+
+bool OfflineRenderer::Run()
+{
+	const int amountOfJobs = GetConcurrentFrames();
+	const float frameTime = 1.f / m_Settings.framesPerSecond;
+
+	std::cout << "Rendering " << m_Settings.amountOfFrames << " frames at " << m_Settings.width << "x" << m_Settings.height
+		<< ", " << amountOfJobs << " at a time" << std::endl;
+
+	const auto start = std::chrono::steady_clock::now();
+	std::atomic<int> nextFrame{ 0 };
+	std::atomic<int> amountOfFinishedFrames{ 0 };
+	std::atomic<bool> hasFailed{ false };
+
+	const auto renderFrames = [&]()
+		{
+			if (Trace::IsRecording()) Trace::SetThreadName("Frame job");
+			const std::unique_ptr<Scene> pScene{ m_CreateScene() };
+			if (!pScene)
+			{
+				hasFailed = true;
+				return;
+			}
+			pScene->Activate();
+			pScene->WaitForContent();
+			pScene->GetCamera().isInputEnabled = false;
+
+			Renderer renderer{ m_Settings.width, m_Settings.height };
+			Timer timer{};
+
+			for (int index = nextFrame.fetch_add(1); index < m_Settings.amountOfFrames; index = nextFrame.fetch_add(1))
+			{
+				//Animations only depend on the total time, frames can be rendered in any order
+				const int frame = m_Settings.firstFrame + index;
+				timer.SetFixedTime(frame * frameTime, frameTime);
+				{
+					TRACE_SCOPE("Scene::Update");
+					pScene->Update(&timer);
+				}
+
+				renderer.ResetAccumulation();
+				for (int sample{ 0 }; sample < std::max(1, m_Settings.samplesPerFrame); ++sample)
+					renderer.Render(pScene.get());
+				renderer.SaveBufferToImage(m_Settings.format, m_Settings.prefix, frame);
+
+				const int amountFinished = ++amountOfFinishedFrames;
+				if (amountFinished % 10 == 0 || amountFinished == m_Settings.amountOfFrames)
+					std::cout << amountFinished << "/" << m_Settings.amountOfFrames << " frames" << std::endl;
+			}
+
+			renderer.FlushImages();
+		};
+
+	std::vector<std::thread> jobs{};
+	for (int job{ 1 }; job < amountOfJobs; ++job)
+		jobs.emplace_back(renderFrames);
+	renderFrames();
+	for (std::thread& job : jobs)
+		job.join();
+
+	if (hasFailed)
+	{
+		std::cout << "Scene could not be created" << std::endl;
+		return false;
+	}
+
+	const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Rendered " << m_Settings.amountOfFrames << " frames in " << seconds << " s ("
+		<< m_Settings.amountOfFrames * 3600.f / seconds << " frames/hour)" << std::endl;
+	return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+//Standard includes
+#include <functional>
+#include <string>
+
+//Project includes
+#include "FrameWriter.h"
+
+namespace dae
+{
+	class Scene;
+
+	/**
+	 * \brief Renders an animation to an image sequence. Frame N is rendered at a simulated time of N / framesPerSecond,
+	 * independent of how long rendering takes, so the output is the same on every machine.
+	 * Several frames are rendered at once, each with its own scene and renderer, so the serial parts of one frame
+	 * (and small frames that can't keep every core busy) overlap with the work of the others.
+	 */
+	class OfflineRenderer final
+	{
+	public:
+		struct Settings
+		{
+			int width{ 640 };
+			int height{ 480 };
+			int firstFrame{ 0 };
+			int amountOfFrames{ 120 };
+			float framesPerSecond{ 30.f };
+			int samplesPerFrame{ 1 }; //renders of the same frame accumulated, area lights need more than 1
+			int concurrentFrames{ 0 }; //0 picks a number based on how well one frame fills the cores
+			std::string prefix{ "Frame" };
+			FrameWriter::Format format{ FrameWriter::Format::PNG };
+		};
+
+		//Called once for every concurrent frame, every renderer needs a scene of its own to animate
+		using SceneFactory = std::function<Scene*()>;
+
+		OfflineRenderer(SceneFactory createScene, const Settings& settings);
+		~OfflineRenderer() = default;
+
+		OfflineRenderer(const OfflineRenderer&) = delete;
+		OfflineRenderer(OfflineRenderer&&) noexcept = delete;
+		OfflineRenderer& operator=(const OfflineRenderer&) = delete;
+		OfflineRenderer& operator=(OfflineRenderer&&) noexcept = delete;
+
+		//Blocks until every frame is written, returns false if no scene could be created
+		bool Run();
+
+		int GetConcurrentFrames() const;
+
+	private:
+		SceneFactory m_CreateScene{};
+		Settings m_Settings{};
+	};
+}
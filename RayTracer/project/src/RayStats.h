@@ -0,0 +1,62 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+#include <ostream>
+
+namespace dae
+{
+	/**
+	 * \brief Counts where tracing spends its work. Every thread counts into its own copy (GetThreadStats), the renderer
+	 * resets it before a worker starts and adds it to the frame's total when the worker is done, so counting
+	 * never touches shared memory.
+	 */
+	struct RayStats
+	{
+		uint64_t primaryRays{};
+		uint64_t shadowRays{};
+		uint64_t sphereTests{};
+		uint64_t planeTests{};
+		uint64_t triangleTests{};
+		uint64_t slabTestsPassed{};
+		uint64_t slabTestsFailed{};
+		uint64_t shadowRaysOccluded{}; //stopped at the first blocker instead of testing everything
+		uint64_t pixelsWithoutHit{};
+
+		RayStats& operator+=(const RayStats& other)
+		{
+			primaryRays += other.primaryRays;
+			shadowRays += other.shadowRays;
+			sphereTests += other.sphereTests;
+			planeTests += other.planeTests;
+			triangleTests += other.triangleTests;
+			slabTestsPassed += other.slabTestsPassed;
+			slabTestsFailed += other.slabTestsFailed;
+			shadowRaysOccluded += other.shadowRaysOccluded;
+			pixelsWithoutHit += other.pixelsWithoutHit;
+			return *this;
+		}
+
+		uint64_t GetAmountOfRays() const { return primaryRays + shadowRays; }
+		float GetTrianglesPerRay() const { return GetAmountOfRays() ? static_cast<float>(triangleTests) / GetAmountOfRays() : 0.f; }
+
+		static RayStats& GetThreadStats()
+		{
+			thread_local RayStats stats{};
+			return stats;
+		}
+
+		static void WriteCsvHeader(std::ostream& output)
+		{
+			output << "primary rays,shadow rays,sphere tests,plane tests,triangle tests,slab tests passed,slab tests failed,"
+				"triangles per ray,shadow rays occluded,pixels without hit";
+		}
+
+		void WriteCsv(std::ostream& output) const
+		{
+			output << primaryRays << "," << shadowRays << "," << sphereTests << "," << planeTests << "," << triangleTests
+				<< "," << slabTestsPassed << "," << slabTestsFailed << "," << GetTrianglesPerRay() << "," << shadowRaysOccluded
+				<< "," << pixelsWithoutHit;
+		}
+	};
+}
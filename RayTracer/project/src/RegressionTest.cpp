@@ -0,0 +1,327 @@
+#include "RegressionTest.h"
+#include "MathHelpers.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "SceneFile.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <sstream>
+
+using namespace dae;
+
+namespace
+{
+	struct RegressionCase
+	{
+		const char* name{};
+		std::function<Scene*()> createScene{};
+	};
+
+	//Offsets from the scene's own camera, the second one shows geometry near the edges of the default view
+	struct CameraPose
+	{
+		const char* name{};
+		float yaw{}; //degrees
+		float pitch{};
+	};
+
+	std::vector<RegressionCase> GetCases()
+	{
+		return
+		{
+			{ "W1", [] { return new Scene_W1(); } },
+			{ "W2", [] { return new Scene_W2(); } },
+			{ "W3", [] { return new Scene_W3(); } },
+			{ "W3_TestScene1", [] { return new Scene_W3_TestScene1(); } },
+			{ "W3_TestScene2", [] { return new Scene_W3_TestScene2(); } },
+			{ "W4_TestScene1", [] { return new Scene_W4_TestScene1(); } },
+			{ "W4_TestScene2", [] { return new Scene_W4_TestScene2(); } },
+			{ "W4_TestScene3", [] { return new Scene_W4_TestScene3(); } },
+			{ "W4_Reference", [] { return new Scene_W4_RefrenceScene(); } },
+			{ "W4_Bunny", [] { return new Scene_W4_BunnyScene(); } },
+			{ "W5_AreaLight", [] { return new Scene_W5_AreaLightScene(); } },
+			{ "Generated", [] { return new Scene_Generated(Scene_Generated::Settings{}); } },
+			{ "File_Bunny", []
+				{
+					const auto pScene = new Scene_File("resources/bunny.scene");
+					pScene->SetHotReload(false);
+					return pScene;
+				} },
+		};
+	}
+
+	bool ReadPPM(const std::string& filename, int& width, int& height, std::vector<uint8_t>& rgb)
+	{
+		std::ifstream file{ filename, std::ios::binary };
+		std::string magic{};
+		int maxValue{};
+		file >> magic >> width >> height >> maxValue;
+		if (!file || magic != "P6" || maxValue != 255 || width <= 0 || height <= 0)
+			return false;
+
+		file.get(); //the single whitespace before the pixels
+		rgb.resize(static_cast<size_t>(width) * height * 3);
+		file.read(reinterpret_cast<char*>(rgb.data()), rgb.size());
+		return static_cast<bool>(file);
+	}
+
+	bool WritePPM(const std::string& filename, int width, int height, const std::vector<uint8_t>& rgb)
+	{
+		std::ofstream file{ filename, std::ios::binary };
+		file << "P6\n" << width << " " << height << "\n255\n";
+		file.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+		return static_cast<bool>(file);
+	}
+
+	//8 bit sRGB -> CIELAB (D65)
+	void ToLab(const uint8_t* pRgb, float lab[3])
+	{
+		float linear[3]{};
+		for (int channel{ 0 }; channel < 3; ++channel)
+		{
+			const float value = pRgb[channel] / 255.f;
+			linear[channel] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+		}
+
+		const float xyz[3]
+		{
+			(0.4124f * linear[0] + 0.3576f * linear[1] + 0.1805f * linear[2]) / 0.95047f,
+			0.2126f * linear[0] + 0.7152f * linear[1] + 0.0722f * linear[2],
+			(0.0193f * linear[0] + 0.1192f * linear[1] + 0.9505f * linear[2]) / 1.08883f
+		};
+		float f[3]{};
+		for (int axis{ 0 }; axis < 3; ++axis)
+			f[axis] = xyz[axis] > 0.008856f ? std::cbrt(xyz[axis]) : 7.787f * xyz[axis] + 16.f / 116.f;
+
+		lab[0] = 116.f * f[1] - 16.f;
+		lab[1] = 500.f * (f[0] - f[1]);
+		lab[2] = 200.f * (f[1] - f[2]);
+	}
+
+	//case name -> milliseconds
+	std::map<std::string, float> ReadBaseline(const std::string& filename)
+	{
+		std::map<std::string, float> baseline{};
+		std::ifstream file{ filename };
+		std::string line{};
+		std::getline(file, line); //header
+		while (std::getline(file, line))
+		{
+			const size_t comma = line.find(',');
+			if (comma == std::string::npos) continue;
+			try
+			{
+				baseline[line.substr(0, comma)] = std::stof(line.substr(comma + 1));
+			}
+			catch (const std::exception&)
+			{
+			}
+		}
+		return baseline;
+	}
+}
+
+RegressionTest::RegressionTest(const Settings& settings) :
+	m_Settings{ settings }
+{
+}
+
+RegressionTest::ImageDifference RegressionTest::CompareImages(const std::vector<uint8_t>& image, const std::vector<uint8_t>& reference, float maxDeltaE)
+{
+	ImageDifference difference{};
+	const size_t amountOfPixels = std::min(image.size(), reference.size()) / 3;
+	if (amountOfPixels == 0 || image.size() != reference.size())
+	{
+		difference.differentPixels = 1.f;
+		return difference;
+	}
+
+	double sumDeltaE{ 0.0 };
+	size_t amountDifferent{ 0 };
+	for (size_t pixel{ 0 }; pixel < amountOfPixels; ++pixel)
+	{
+		const uint8_t* pPixel = &image[pixel * 3];
+		const uint8_t* pReference = &reference[pixel * 3];
+		if (pPixel[0] == pReference[0] && pPixel[1] == pReference[1] && pPixel[2] == pReference[2])
+			continue;
+
+		float lab[3]{}, referenceLab[3]{};
+		ToLab(pPixel, lab);
+		ToLab(pReference, referenceLab);
+		const float deltaE = std::sqrt((lab[0] - referenceLab[0]) * (lab[0] - referenceLab[0])
+			+ (lab[1] - referenceLab[1]) * (lab[1] - referenceLab[1]) + (lab[2] - referenceLab[2]) * (lab[2] - referenceLab[2]));
+
+		sumDeltaE += deltaE;
+		difference.maxDeltaE = std::max(difference.maxDeltaE, deltaE);
+		if (deltaE > maxDeltaE) ++amountDifferent;
+	}
+
+	difference.averageDeltaE = static_cast<float>(sumDeltaE / amountOfPixels);
+	difference.differentPixels = static_cast<float>(amountDifferent) / amountOfPixels;
+	return difference;
+}
+
+RegressionTest::Result RegressionTest::Run(std::ostream& output)
+{
+	const CameraPose poses[]{ { "front", 0.f, 0.f }, { "turned", 15.f, -5.f } };
+	const std::string& outputDirectory = m_Settings.outputDirectory;
+	std::filesystem::create_directories(outputDirectory);
+	if (m_Settings.isUpdatingReferences)
+		std::filesystem::create_directories(m_Settings.referenceDirectory);
+
+	const std::map<std::string, float> baseline = ReadBaseline(m_Settings.baselineFilename);
+	const bool isWritingBaseline = m_Settings.isCheckingTimings && (m_Settings.isUpdatingBaseline || baseline.empty());
+	const bool isBaselineMissing = isWritingBaseline && !m_Settings.isUpdatingBaseline;
+	std::map<std::string, float> timings{};
+
+	bool isPassing{ true };
+	float totalMs{ 0.f }, totalBaselineMs{ 0.f };
+	output << std::fixed << std::setprecision(2);
+	for (const RegressionCase& regressionCase : GetCases())
+	{
+		const std::unique_ptr<Scene> pScene{ regressionCase.createScene() };
+		pScene->Activate();
+		pScene->WaitForContent();
+
+		Camera& camera = pScene->GetCamera();
+		camera.isInputEnabled = false;
+		Timer timer{};
+		timer.SetFixedTime(0.f, 0.f);
+		pScene->Update(&timer);
+		const float yaw = camera.totalYaw, pitch = camera.totalPitch;
+
+		for (const CameraPose& pose : poses)
+		{
+			const std::string name = std::string(regressionCase.name) + "_" + pose.name;
+			camera.totalYaw = yaw + pose.yaw * TO_RADIANS;
+			camera.totalPitch = pitch + pose.pitch * TO_RADIANS;
+
+			//The fastest frame, the others only add noise from the rest of the machine
+			Renderer renderer{ m_Settings.width, m_Settings.height };
+			float frameMs{ FLT_MAX };
+			for (int sample{ 0 }; sample < std::max(1, m_Settings.samples); ++sample)
+			{
+				renderer.Render(pScene.get());
+				frameMs = std::min(frameMs, renderer.GetFrameStats().totalMs);
+			}
+			renderer.SaveBufferToImage(FrameWriter::Format::PPM, outputDirectory + "/" + name, 0);
+			renderer.FlushImages();
+
+			for (int sample{ m_Settings.samples }; m_Settings.isCheckingTimings && sample < m_Settings.timingSamples; ++sample)
+			{
+				renderer.Render(pScene.get());
+				frameMs = std::min(frameMs, renderer.GetFrameStats().totalMs);
+			}
+
+			std::ostringstream line{};
+			line << std::fixed << std::setprecision(2) << std::left << std::setw(24) << name << std::right;
+			bool isCaseFailing{ false };
+
+			if (m_Settings.isCheckingImages || m_Settings.isUpdatingReferences)
+			{
+				int width{}, height{};
+				std::vector<uint8_t> image{}, reference{};
+				const std::string referenceFilename = m_Settings.referenceDirectory + "/" + name + ".ppm";
+				if (!ReadPPM(outputDirectory + "/" + name + "_00000.ppm", width, height, image))
+				{
+					line << " could not read the rendered image";
+					isCaseFailing = true;
+				}
+				else if (m_Settings.isUpdatingReferences)
+				{
+					line << (WritePPM(referenceFilename, width, height, image) ? " reference updated" : " could not write the reference");
+				}
+				else if (int referenceWidth{}, referenceHeight{}; !ReadPPM(referenceFilename, referenceWidth, referenceHeight, reference)
+					|| referenceWidth != width || referenceHeight != height)
+				{
+					line << " no " << width << "x" << height << " reference " << referenceFilename;
+					isCaseFailing = true;
+				}
+				else
+				{
+					const ImageDifference difference = CompareImages(image, reference, m_Settings.maxDeltaE);
+					const bool isDifferent = difference.differentPixels > m_Settings.maxDifferentPixels;
+					line << " image " << (isDifferent ? "CHANGED" : "ok") << " (mean dE " << difference.averageDeltaE
+						<< ", max dE " << difference.maxDeltaE << ", " << difference.differentPixels * 100.f << "% visibly different)";
+
+					//Where it changed, 4x amplified so small differences show up
+					if (isDifferent)
+					{
+						std::vector<uint8_t> differenceImage(image.size());
+						for (size_t index{ 0 }; index < image.size(); ++index)
+							differenceImage[index] = static_cast<uint8_t>(std::min(255, 4 * std::abs(image[index] - reference[index])));
+						WritePPM(outputDirectory + "/" + name + "_difference.ppm", width, height, differenceImage);
+						isCaseFailing = true;
+					}
+				}
+			}
+
+			if (m_Settings.isCheckingTimings)
+			{
+				timings[name] = frameMs;
+				totalMs += frameMs;
+				line << " " << frameMs << " ms";
+
+				const auto baselineIt = baseline.find(name);
+				if (!isWritingBaseline && baselineIt != baseline.end())
+				{
+					totalBaselineMs += baselineIt->second;
+					const float change = frameMs / baselineIt->second - 1.f;
+					const bool isSlower = change > m_Settings.maxSlowdown;
+					line << " (" << std::showpos << change * 100.f << std::noshowpos << "% vs " << baselineIt->second << " ms"
+						<< (isSlower ? ", SLOWER" : "") << ")";
+					isCaseFailing = isCaseFailing || isSlower;
+				}
+			}
+
+			output << line.str() << std::endl;
+			isPassing = isPassing && !isCaseFailing;
+		}
+	}
+
+	if (m_Settings.isCheckingTimings)
+	{
+		const auto writeTimings = [&timings](const std::string& filename)
+			{
+				std::ofstream file{ filename };
+				file << "case,ms\n";
+				for (const auto& [name, milliseconds] : timings)
+					file << name << "," << milliseconds << "\n";
+			};
+		writeTimings(outputDirectory + "/timings.csv");
+
+		if (isWritingBaseline)
+		{
+			writeTimings(m_Settings.baselineFilename);
+			output << "baseline " << (isBaselineMissing ? "created" : "written") << " at " << m_Settings.baselineFilename
+				<< ", " << totalMs << " ms in total" << (isBaselineMissing ? ", no timings compared" : "") << std::endl;
+		}
+		else if (totalBaselineMs > 0.f)
+		{
+			output << "total " << totalMs << " ms, " << std::showpos << (totalMs / totalBaselineMs - 1.f) * 100.f << std::noshowpos
+				<< "% vs the baseline (" << totalBaselineMs << " ms)" << std::endl;
+		}
+	}
+
+	if (!isPassing)
+	{
+		output << "REGRESSED" << std::endl;
+		return Result::Regressed;
+	}
+	if (isBaselineMissing)
+	{
+		output << "nothing to compare the timings with, run again to check them" << std::endl;
+		return Result::BaselineCreated;
+	}
+	output << "no regressions" << std::endl;
+	return Result::Passed;
+}
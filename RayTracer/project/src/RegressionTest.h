@@ -0,0 +1,70 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	/**
+	 * \brief Renders every scene headless at fixed camera poses and compares the images with stored references,
+	 * allowing differences nobody can see (CIE76 colour difference per pixel), and the frame times with a baseline
+	 * file, allowing a configurable slowdown. Optimizations ship with proof that the output stayed the same and
+	 * the frames got faster.
+	 */
+	class RegressionTest final
+	{
+	public:
+		struct Settings
+		{
+			std::string referenceDirectory{ "references" };
+			std::string outputDirectory{ "regression" }; //rendered images, difference images and timings.csv
+			std::string baselineFilename{ "regression_baseline.csv" };
+			int width{ 128 };
+			int height{ 96 };
+			int samples{ 4 }; //frames per pose in the image, area lights accumulate over them
+			int timingSamples{ 8 }; //frames per pose the fastest one is picked from, when checking timings
+			float maxDeltaE{ 2.3f }; //about one just noticeable difference
+			float maxDifferentPixels{ 0.002f }; //fraction of the pixels that may differ more than maxDeltaE
+			float maxSlowdown{ 0.2f }; //fraction a case may get slower than its baseline
+			bool isCheckingImages{ true };
+			bool isCheckingTimings{ true };
+			bool isUpdatingReferences{ false };
+			bool isUpdatingBaseline{ false }; //a missing baseline is always written, but then nothing is compared
+		};
+
+		explicit RegressionTest(const Settings& settings);
+		~RegressionTest() = default;
+
+		RegressionTest(const RegressionTest&) = delete;
+		RegressionTest(RegressionTest&&) noexcept = delete;
+		RegressionTest& operator=(const RegressionTest&) = delete;
+		RegressionTest& operator=(RegressionTest&&) noexcept = delete;
+
+		enum class Result
+		{
+			Passed,
+			Regressed, //an image changed or a case got too slow
+			BaselineCreated //there was no baseline to compare the timings with, the images (if checked) are fine
+		};
+		//Exit code of --regression for BaselineCreated, ctest reports the test as skipped
+		static constexpr int s_SkipExitCode{ 77 };
+
+		//Prints a line per case
+		Result Run(std::ostream& output);
+
+		struct ImageDifference
+		{
+			float averageDeltaE{};
+			float maxDeltaE{};
+			float differentPixels{}; //fraction above Settings::maxDeltaE
+		};
+		//Both images 8 bit RGB of the same size
+		static ImageDifference CompareImages(const std::vector<uint8_t>& image, const std::vector<uint8_t>& reference, float maxDeltaE);
+
+	private:
+		Settings m_Settings{};
+	};
+}
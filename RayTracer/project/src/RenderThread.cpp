@@ -0,0 +1,125 @@
+#include "RenderThread.h"
+
+//Project includes
+#include "Trace.h"
+
+using namespace dae;
+
+namespace
+{
+	enum InputBit : uint32_t
+	{
+		Forward = 1 << 0,
+		Back = 1 << 1,
+		Right = 1 << 2,
+		Left = 1 << 3,
+		Boost = 1 << 4,
+		LeftButton = 1 << 5,
+		RightButton = 1 << 6
+	};
+}
+
+RenderThread::RenderThread(int width, int height, FrameFunction renderFrame) :
+	m_RenderFrame(std::move(renderFrame))
+{
+	for (std::vector<uint32_t>& buffer : m_Buffers)
+		buffer.resize(static_cast<size_t>(width) * height);
+}
+
+RenderThread::~RenderThread()
+{
+	Stop();
+}
+
+void RenderThread::Start()
+{
+	if (m_Thread.joinable())
+		return;
+	m_IsStopping = false;
+	m_IsRunning = true;
+	m_Thread = std::thread(&RenderThread::Run, this);
+}
+
+void RenderThread::Stop()
+{
+	m_IsStopping = true;
+	if (m_Thread.joinable())
+		m_Thread.join();
+	m_IsRunning = false;
+
+	const std::lock_guard lock{ m_CommandMutex };
+	m_Commands.clear();
+}
+
+void RenderThread::Post(std::function<void()> command)
+{
+	const std::lock_guard lock{ m_CommandMutex };
+	m_Commands.emplace_back(std::move(command));
+}
+
+const uint32_t* RenderThread::AcquireFrame()
+{
+	if ((m_ReadyBuffer.load(std::memory_order_acquire) & m_NewFrameBit) == 0)
+		return nullptr;
+
+	m_FrontBuffer = m_ReadyBuffer.exchange(m_FrontBuffer, std::memory_order_acq_rel) & m_IndexMask;
+	return m_Buffers[m_FrontBuffer].data();
+}
+
+void RenderThread::PublishInput(const CameraInput& input)
+{
+	uint32_t state{ 0 };
+	if (input.isMovingForward) state |= Forward;
+	if (input.isMovingBack) state |= Back;
+	if (input.isMovingRight) state |= Right;
+	if (input.isMovingLeft) state |= Left;
+	if (input.isBoosting) state |= Boost;
+	if (input.isLeftButtonDown) state |= LeftButton;
+	if (input.isRightButtonDown) state |= RightButton;
+	m_InputState.store(state, std::memory_order_relaxed);
+
+	m_MouseX.fetch_add(input.mouseX, std::memory_order_relaxed);
+	m_MouseY.fetch_add(input.mouseY, std::memory_order_relaxed);
+}
+
+CameraInput RenderThread::TakeInput()
+{
+	const uint32_t state = m_InputState.load(std::memory_order_relaxed);
+
+	CameraInput input{};
+	input.isMovingForward = state & Forward;
+	input.isMovingBack = state & Back;
+	input.isMovingRight = state & Right;
+	input.isMovingLeft = state & Left;
+	input.isBoosting = state & Boost;
+	input.isLeftButtonDown = state & LeftButton;
+	input.isRightButtonDown = state & RightButton;
+	input.mouseX = m_MouseX.exchange(0, std::memory_order_relaxed);
+	input.mouseY = m_MouseY.exchange(0, std::memory_order_relaxed);
+	return input;
+}
+
+void RenderThread::Run()
+{
+	Trace::SetThreadName("Render thread");
+
+	std::vector<std::function<void()>> commands{};
+	while (!m_IsStopping.load(std::memory_order_acquire))
+	{
+		{
+			const std::lock_guard lock{ m_CommandMutex };
+			commands.swap(m_Commands);
+		}
+		for (const std::function<void()>& command : commands)
+			command();
+		commands.clear();
+
+		const bool isLastFrame = !m_RenderFrame(m_Buffers[m_BackBuffer].data(), TakeInput());
+
+		//The finished frame becomes the ready one, whatever was ready (and never presented) is the next back buffer
+		m_BackBuffer = m_ReadyBuffer.exchange(m_BackBuffer | m_NewFrameBit, std::memory_order_acq_rel) & m_IndexMask;
+		if (isLastFrame)
+			break;
+	}
+	m_IsRunning.store(false, std::memory_order_release);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+//Standard includes
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Project includes
+#include "Camera.h"
+
+namespace dae
+{
+	/**
+	 * \brief Renders frames on its own thread while the main thread polls input and presents, so frame N+1 is traced
+	 * while frame N is on screen and a key press never waits for a frame to finish.
+	 * Finished frames go through a lock free triple buffer: the render thread always has a back buffer to write, the
+	 * main thread always has the last frame it presented, the third is the newest finished frame and is swapped with
+	 * one of the other two by a single atomic exchange. Neither thread ever waits on the other.
+	 * Camera input is a lock free snapshot too: the key and button state is one atomic word, mouse motion adds up in
+	 * two atomic counters until the render thread takes it at the start of a frame.
+	 * Everything else the main thread wants changed (render modes, scene switches, screenshots) is posted as a command,
+	 * commands run on the render thread between frames.
+	 */
+	class RenderThread final
+	{
+	public:
+		//Renders one frame into pPixels (width * height) with the camera input since the last frame,
+		//false when it was the last one
+		using FrameFunction = std::function<bool(uint32_t* pPixels, const CameraInput& input)>;
+
+		RenderThread(int width, int height, FrameFunction renderFrame);
+		~RenderThread();
+
+		RenderThread(const RenderThread&) = delete;
+		RenderThread(RenderThread&&) noexcept = delete;
+		RenderThread& operator=(const RenderThread&) = delete;
+		RenderThread& operator=(RenderThread&&) noexcept = delete;
+
+		void Start();
+		//Waits for the frame that's being rendered, commands that didn't run yet are dropped
+		void Stop();
+		//False once the frame function rendered its last frame
+		bool IsRunning() const { return m_IsRunning.load(std::memory_order_acquire); }
+
+		//Main thread
+		void Post(std::function<void()> command);
+		//The newest frame that finished since the last call, nullptr when there's none. Stays valid until the next call
+		const uint32_t* AcquireFrame();
+		//The keys and buttons as they are now, mouse motion adds up until the next frame starts
+		void PublishInput(const CameraInput& input);
+
+	private:
+		static constexpr uint32_t m_IndexMask{ 0x3 };
+		static constexpr uint32_t m_NewFrameBit{ 0x4 };
+
+		FrameFunction m_RenderFrame{};
+		std::vector<uint32_t> m_Buffers[3]{};
+		uint32_t m_BackBuffer{ 0 }; //render thread
+		uint32_t m_FrontBuffer{ 1 }; //main thread
+		std::atomic<uint32_t> m_ReadyBuffer{ 2 }; //index, m_NewFrameBit when the render thread swapped it in
+
+		std::mutex m_CommandMutex{};
+		std::vector<std::function<void()>> m_Commands{};
+
+		std::atomic<uint32_t> m_InputState{ 0 }; //CameraInput's bools, one bit each
+		std::atomic<int> m_MouseX{ 0 }, m_MouseY{ 0 };
+
+		std::atomic<bool> m_IsStopping{ false };
+		std::atomic<bool> m_IsRunning{ false };
+		std::thread m_Thread{};
+
+		void Run();
+		CameraInput TakeInput();
+	};
+}
@@ -1,73 +1,339 @@
 //External includes
+#if !defined(RT_NO_SDL)
 #include "SDL.h"
 #include "SDL_surface.h"
+#endif
 
 //Project includes
 #include "Renderer.h"
 #include "Maths.h"
 #include "Matrix.h"
 #include "Material.h"
+#include "PerfCounters.h"
 #include "Scene.h"
+#include "Trace.h"
 #include "Utils.h"
+#include <algorithm>
 #include <iostream>
 #include <execution>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 
 
 #define PARALLEL_EXECUTION
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RESOLVE_SSE
+#endif
+
 using namespace dae;
 
+namespace
+{
+	float MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	template<typename Container, typename Function>
+	void ForEachParallel(Container& container, const Function& function)
+	{
+#if defined(PARALLEL_EXECUTION)
+		std::for_each(std::execution::par, container.begin(), container.end(), function);
+#else
+		std::for_each(container.begin(), container.end(), function);
+#endif
+	}
+}
+
+#if !defined(RT_NO_SDL)
 Renderer::Renderer(SDL_Window* pWindow) :
 	m_pWindow(pWindow),
 	m_pBuffer(SDL_GetWindowSurface(pWindow))
 {
 	//Initialize
 	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
-	m_pBufferPixels = static_cast<uint32_t*>(m_pBuffer->pixels);
+	m_pSurfacePixels = static_cast<uint32_t*>(m_pBuffer->pixels);
+	m_pBufferPixels = m_pSurfacePixels;
+
+	m_AlphaMask = m_pBuffer->format->Amask;
+	m_RedShift = m_pBuffer->format->Rshift;
+	m_GreenShift = m_pBuffer->format->Gshift;
+	m_BlueShift = m_pBuffer->format->Bshift;
+
+	Initialize();
+}
+#endif
+
+Renderer::Renderer(int width, int height) :
+	m_Width(width),
+	m_Height(height)
+{
+	//Offscreen, pixels are packed as ARGB8888
+	m_OffscreenPixels.resize(m_Width * m_Height);
+	m_pBufferPixels = m_OffscreenPixels.data();
+
+	Initialize();
+}
+
+void Renderer::Initialize()
+{
+	m_FullWidth = m_Width;
+	m_FullHeight = m_Height;
+
+	m_HdrRed.resize(m_Width * m_Height);
+	m_HdrGreen.resize(m_Width * m_Height);
+	m_HdrBlue.resize(m_Width * m_Height);
+
+	m_History.resize(m_Width * m_Height);
+	m_PreviousHistory.resize(m_Width * m_Height);
+
+	//Tiles, centre distance is normalized so 1 is a screen corner
+	const float halfWidth = m_Width * 0.5f, halfHeight = m_Height * 0.5f;
+	const float maxDistance = std::sqrt(halfWidth * halfWidth + halfHeight * halfHeight);
+	for (int y{ 0 }; y < m_Height; y += m_TileSize)
+	{
+		for (int x{ 0 }; x < m_Width; x += m_TileSize)
+		{
+			Tile tile{};
+			tile.x = x;
+			tile.y = y;
+			tile.width = std::min(m_TileSize, m_Width - x);
+			tile.height = std::min(m_TileSize, m_Height - y);
+
+			const float dx = x + tile.width * 0.5f - halfWidth;
+			const float dy = y + tile.height * 0.5f - halfHeight;
+			tile.centreDistance = std::sqrt(dx * dx + dy * dy) / maxDistance;
+
+			m_Tiles.emplace_back(tile);
+		}
+	}
+	m_TileOrder.resize(m_Tiles.size());
+	std::iota(m_TileOrder.begin(), m_TileOrder.end(), 0);
+
+#if defined(PARALLEL_EXECUTION)
+	m_WorkerIndices.resize(std::max(1u, std::thread::hardware_concurrency()));
+#else
+	m_WorkerIndices.resize(1);
+#endif
+	std::iota(m_WorkerIndices.begin(), m_WorkerIndices.end(), 0);
+	m_DeferredPixels.resize(m_WorkerIndices.size());
 }
-void Renderer::Render(Scene* pScene) const
+void Renderer::Render(Scene* pScene)
 {
+    TRACE_SCOPE("Renderer::Render");
+    const auto frameStart = std::chrono::steady_clock::now();
+    const auto deadline = frameStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float, std::milli>(m_FrameBudgetMs));
+
     Camera& camera = pScene->GetCamera();
 
     // Cache necessary values outside the loop
     const Matrix cameraToWorld = camera.CalculateCameraToWorld();
-    const float aspectRatio = static_cast<float>(m_Width) / static_cast<float>(m_Height);
+    const float aspectRatio = static_cast<float>(m_FullWidth) / static_cast<float>(m_FullHeight);
     const float fov = tan(camera.fovAngle / 2);
     const auto& materials = pScene->GetMaterials();
     const auto& lights = pScene->GetLights();
 
-    const uint32_t amountOfPixels = m_Width * m_Height;
+    m_HasAreaLights = std::any_of(lights.begin(), lights.end(), [](const Light& light)
+        {
+            return light.type == LightType::SphereArea || light.type == LightType::RectArea;
+        });
 
-#if defined(PARALLEL_EXECUTION)
+    // History of another scene, or of geometry that was swapped out since, can never be reused
+    if (pScene != m_pPreviousScene || pScene->GetGeometryVersion() != m_PreviousGeometryVersion)
+    {
+        InvalidateHistory();
+        for (Tile& tile : m_Tiles) tile.staleFrames = 0;
+    }
+
+    SortTilesByPriority();
+
+    m_FrameStats = {};
 
+    // Every worker counts on its own thread and adds its counts to the frame's when it's done
+    std::mutex statsMutex{};
+    const auto addWorkerStats = [&]()
+        {
+            RayStats& workerStats = RayStats::GetThreadStats();
+            const std::lock_guard lock{ statsMutex };
+            m_FrameStats.rays += workerStats;
+            workerStats = {};
+        };
 
-    std::vector<uint32_t> pixelIndeces(amountOfPixels);
-    std::iota(pixelIndeces.begin(), pixelIndeces.end(), 0); // Fill with indices 0, 1, ..., amountOfPixels-1
-    
-    std::for_each(std::execution::par, pixelIndeces.begin(), pixelIndeces.end(),
-        [&](const uint32_t& pixelIndex)
+    // Workers pull tiles in priority order until they run out of tiles or (with a budget) time
+    auto stageStart = std::chrono::steady_clock::now();
+    std::atomic<uint32_t> nextTile{ 0 };
+    const bool isStreaming = pScene->HasClusteredMeshes();
+    ForEachParallel(m_WorkerIndices, [&](const uint32_t& workerIndex)
         {
-            RenderPixel(pScene, pixelIndex, fov, aspectRatio, cameraToWorld, camera.origin, materials, lights);
+            RayStats::GetThreadStats() = {};
+            if (Trace::IsRecording()) Trace::SetThreadName("Render worker");
+            while (!m_FrameBudgetEnabled || std::chrono::steady_clock::now() < deadline)
+            {
+                const uint32_t orderIndex = nextTile.fetch_add(1);
+                if (orderIndex >= m_TileOrder.size()) break;
+
+                TRACE_SCOPE("Tile");
+                // Counters switch stage per ray in a sample of the tiles only
+                const PerfBatchScope tileScope{ PerfStage::Shading };
+                Tile& tile = m_Tiles[m_TileOrder[orderIndex]];
+                for (int py{ tile.y }; py < tile.y + tile.height; ++py)
+                {
+                    for (int px{ tile.x }; px < tile.x + tile.width; ++px)
+                    {
+                        const uint32_t pixelIndex = px + py * m_Width;
+                        if (!IsTracedThisFrame(pixelIndex)) continue;
+
+                        if (isStreaming) Scene::ResetMissingGeometry();
+                        RenderPixel(pScene, pixelIndex, fov, aspectRatio, cameraToWorld, camera.origin, materials, lights);
+                        if (isStreaming && Scene::HadMissingGeometry())
+                            m_DeferredPixels[workerIndex].emplace_back(pixelIndex);
+                    }
+                }
+                tile.isFinished = true;
+            }
+            addWorkerStats();
         });
-#else
-    for (uint32_t pixelIndex = 0; pixelIndex < amountOfPixels; ++pixelIndex)
+    m_FrameStats.traceMs = MillisecondsSince(stageStart);
+
+    // Pixels that needed geometry which wasn't resident get traced again once it is paged in
+    stageStart = std::chrono::steady_clock::now();
+    if (isStreaming)
     {
-        RenderPixel(pScene, pixelIndex, fov, aspectRatio, cameraToWorld, camera.origin, materials, lights);
+        TRACE_SCOPE("Streaming");
+        for (int round{ 0 }; round < m_MaxStreamingRounds; ++round)
+        {
+            std::vector<uint32_t> deferredPixels{};
+            for (std::vector<uint32_t>& workerPixels : m_DeferredPixels)
+            {
+                deferredPixels.insert(deferredPixels.end(), workerPixels.begin(), workerPixels.end());
+                workerPixels.clear();
+            }
+
+            if (!pScene->StreamGeometry() || deferredPixels.empty()) break;
+
+            std::atomic<size_t> nextPixel{ 0 };
+            ForEachParallel(m_WorkerIndices, [&](const uint32_t& workerIndex)
+                {
+                    RayStats::GetThreadStats() = {};
+                    constexpr size_t chunkSize{ 256 };
+                    for (size_t first = nextPixel.fetch_add(chunkSize); first < deferredPixels.size(); first = nextPixel.fetch_add(chunkSize))
+                    {
+                        const size_t last = std::min(first + chunkSize, deferredPixels.size());
+                        const PerfBatchScope chunkScope{ PerfStage::Shading };
+                        for (size_t index{ first }; index < last; ++index)
+                        {
+                            Scene::ResetMissingGeometry();
+                            RenderPixel(pScene, deferredPixels[index], fov, aspectRatio, cameraToWorld, camera.origin, materials, lights);
+                            if (Scene::HadMissingGeometry())
+                                m_DeferredPixels[workerIndex].emplace_back(deferredPixels[index]);
+                        }
+                    }
+                    addWorkerStats();
+                });
+        }
+
+        // Out of rounds, these show what was resident and are traced again next frame
+        for (std::vector<uint32_t>& workerPixels : m_DeferredPixels) workerPixels.clear();
+    }
+    m_FrameStats.streamingMs = MillisecondsSince(stageStart);
+
+    // Tiles the budget did not reach keep showing last frame, so they keep last frame's history too
+    for (Tile& tile : m_Tiles)
+    {
+        if (!tile.isFinished)
+        {
+            ++tile.staleFrames;
+            for (int py{ tile.y }; py < tile.y + tile.height; ++py)
+            {
+                std::copy_n(m_PreviousHistory.begin() + (tile.x + py * m_Width), tile.width, m_History.begin() + (tile.x + py * m_Width));
+            }
+        }
+    }
+
+    // Fill in the pixels the checkerboard skipped, all their neighbours are traced by now
+    stageStart = std::chrono::steady_clock::now();
+    if (m_CheckerboardEnabled)
+    {
+        TRACE_SCOPE("Reconstruct");
+        ForEachParallel(m_Tiles, [&](const Tile& tile)
+            {
+                if (!tile.isFinished) return;
+
+                for (int py{ tile.y }; py < tile.y + tile.height; ++py)
+                {
+                    for (int px{ tile.x }; px < tile.x + tile.width; ++px)
+                    {
+                        const uint32_t pixelIndex = px + py * m_Width;
+                        if (!IsTracedThisFrame(pixelIndex))
+                            ReconstructPixel(pixelIndex, camera.origin);
+                    }
+                }
+            });
+    }
+
+    m_FrameStats.reconstructMs = MillisecondsSince(stageStart);
+
+    // HDR -> surface format, stale tiles included so tone mapping changes show up everywhere
+    stageStart = std::chrono::steady_clock::now();
+    {
+        TRACE_SCOPE("Resolve");
+        ForEachParallel(m_Tiles, [this](Tile& tile)
+            {
+                ResolveTile(tile);
+            });
+    }
+    m_FrameStats.resolveMs = MillisecondsSince(stageStart);
+
+    // ResolveTile noted which tiles changed, the finished ones start the next frame fresh
+    for (Tile& tile : m_Tiles)
+    {
+        if (!tile.isFinished) continue;
+
+        tile.staleFrames = 0;
+        tile.isFinished = false;
+    }
+
+    // This frame becomes the history of the next one
+    std::swap(m_History, m_PreviousHistory);
+    m_pPreviousScene = pScene;
+    m_PreviousGeometryVersion = pScene->GetGeometryVersion();
+    m_PreviousCameraToWorld = cameraToWorld;
+    m_PreviousCameraOrigin = camera.origin;
+    m_PreviousFov = fov;
+    m_HasPreviousFrame = true;
+    ++m_FrameIndex;
+
+    if (m_IsCapturing)
+        QueueImage(m_CaptureFormat, "Capture");
+
+#if !defined(RT_NO_SDL)
+    if (m_pWindow && m_pBufferPixels == m_pSurfacePixels)
+    {
+        TRACE_SCOPE("Present");
+        SDL_UpdateWindowSurface(m_pWindow);
     }
 #endif
 
-    SDL_UpdateWindowSurface(m_pWindow);
+    m_FrameStats.totalMs = MillisecondsSince(frameStart);
 }
 
 
 
-void Renderer::RenderPixel(const Scene* pScene, const uint32_t pixelIndex, const float fov, const float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin, const std::vector<dae::Material*>& materials, const std::vector<dae::Light>& lights) const
+void Renderer::RenderPixel(const Scene* pScene, const uint32_t pixelIndex, const float fov, const float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin, const std::vector<dae::Material*>& materials, const std::vector<dae::Light>& lights)
 {
-    const uint32_t px{ pixelIndex % m_Width }, py{ pixelIndex / m_Width };
+    const PerfStageScope shadingScope{ PerfStage::Shading };
+    RayStats& stats = RayStats::GetThreadStats();
+    ++stats.primaryRays;
+    // Position in the full image, a crop window only renders part of it
+    const uint32_t px{ pixelIndex % m_Width + m_CropX }, py{ pixelIndex / m_Width + m_CropY };
 
     // Calculate ray direction with FOV and aspect ratio adjustments
-    const float Cx = ((2 * ((px + 0.5f) / float(m_Width))) - 1) * aspectRatio * fov;
-    const float Cy = (1 - 2 * ((py + 0.5f) / float(m_Height))) * fov;
+    const float Cx = ((2 * ((px + 0.5f) / float(m_FullWidth))) - 1) * aspectRatio * fov;
+    const float Cy = (1 - 2 * ((py + 0.5f) / float(m_FullHeight))) * fov;
 
     Vector3 rayDirection{ Cx, Cy, 1 };
     rayDirection = cameraToWorld.TransformVector(rayDirection).Normalized();
@@ -77,65 +343,474 @@ void Renderer::RenderPixel(const Scene* pScene, const uint32_t pixelIndex, const
     HitRecord closestHit{};
 
     // Find the closest hit for the view ray
-    pScene->GetClosestHit(viewRay, closestHit);
+    {
+        const PerfStageScope intersectionScope{ PerfStage::Intersection };
+        pScene->GetClosestHit(viewRay, closestHit);
+    }
+
+    PixelHistory& history = m_History[pixelIndex];
+    history.isValid = closestHit.didHit;
 
     // If there's a hit, calculate lighting
     if (closestHit.didHit)
     {
-        const Vector3& normalizedHitNormal = closestHit.normal.Normalized();
-        Vector3 closestHitLocation = closestHit.origin + 0.001f * normalizedHitNormal;
-    
-        for (const auto& light : lights)
+        history.position = closestHit.origin;
+        history.normal = closestHit.normal.Normalized();
+        history.depth = (closestHit.origin - cameraOrigin).Magnitude();
+        history.primitiveId = closestHit.primitiveId;
+
+        // Spread the forced refreshes over the screen so no pixel keeps stale shading forever
+        const bool forceRefresh = (px + 3 * py + m_FrameIndex) % m_TemporalRefreshPeriod == 0;
+
+        // Only looked up when it's used: reused shading, or area light samples to average with
+        const bool isReusingShading = m_TemporalReprojectionEnabled && !forceRefresh;
+        const PixelHistory* pPrevious = isReusingShading || m_HasAreaLights ? ReprojectHistory(history) : nullptr;
+
+        if (isReusingShading && pPrevious)
+        {
+            finalColor = pPrevious->color;
+            history.sampleCount = pPrevious->sampleCount;
+        }
+        else
         {
-            if (light.type != LightType::Point) continue;
-    
-            Vector3 closestHitDirectionToLight = light.origin - closestHitLocation;
-            float maxDistance = closestHitDirectionToLight.Magnitude();
-            Vector3 normalizedDirectionToLight = closestHitDirectionToLight.Normalized();
-    
-            float NdotL = Vector3::Dot(normalizedDirectionToLight, normalizedHitNormal);
-            if (NdotL <= 0) continue;
-    
-            Ray hitTowardsLightRay(closestHitLocation, normalizedDirectionToLight, 0.0001f, maxDistance);
-            bool isInShadow = m_ShadowsEnabled && pScene->DoesHit(hitTowardsLightRay);
-    
-            if (!isInShadow)
+            finalColor = ShadePixel(pScene, closestHit, rayDirection, materials, lights, px, py);
+            history.sampleCount = 1;
+
+            // Soft shadows converge by averaging this frame's light samples with the reprojected ones
+            if (m_HasAreaLights && pPrevious)
             {
-                switch (m_CurrentLightingMode) {
-                case LightingMode::Combined:
-                    finalColor += LightUtils::GetRadiance(light, closestHitLocation)
-                        * materials[closestHit.materialIndex]->Shade(closestHit, normalizedDirectionToLight, -rayDirection)
-                        * NdotL;
-                    break;
-                case LightingMode::ObservedArea:
-                    finalColor += ColorRGB{ 1, 1, 1 } *NdotL;
-                    break;
-                case LightingMode::Radiance:
-                    finalColor += LightUtils::GetRadiance(light, closestHitLocation);
-                    break;
-                case LightingMode::BRDF:
-                    finalColor += materials[closestHit.materialIndex]->Shade(closestHit, normalizedDirectionToLight, -rayDirection);
-                    break;
-                }
+                history.sampleCount = std::min(pPrevious->sampleCount + 1, m_MaxAccumulatedFrames);
+                finalColor = ColorRGB::Lerp(pPrevious->color, finalColor, 1.f / history.sampleCount);
             }
         }
+
+        history.color = finalColor;
+    }
+    else
+    {
+        ++stats.pixelsWithoutHit;
     }
 
-    finalColor.MaxToOne();
+    WritePixel(pixelIndex, finalColor);
+}
+
+ColorRGB Renderer::ShadePixel(const Scene* pScene, const HitRecord& closestHit, const Vector3& rayDirection, const std::vector<dae::Material*>& materials, const std::vector<dae::Light>& lights, uint32_t px, uint32_t py) const
+{
+    ColorRGB finalColor{};
+
+    const Vector3& normalizedHitNormal = closestHit.normal.Normalized();
+    Vector3 closestHitLocation = closestHit.origin + 0.001f * normalizedHitNormal;
+
+    // Low discrepancy sample for this frame (R2 sequence), rotated per pixel by interleaved gradient noise
+    const float frameU1 = static_cast<float>(std::fmod(0.7548776662 * m_FrameIndex, 1.0));
+    const float frameU2 = static_cast<float>(std::fmod(0.5698402910 * m_FrameIndex, 1.0));
+    const float gradient = 0.06711056f * px + 0.00583715f * py;
+    const float pixelRotation = 52.9829189f * (gradient - std::floor(gradient));
+
+    for (size_t lightIndex{ 0 }; lightIndex < lights.size(); ++lightIndex)
+    {
+        const Light& light = lights[lightIndex];
+        if (light.type == LightType::Directional) continue;
+
+        // Offset every light by the golden ratio so their samples are not correlated
+        const float rotation = pixelRotation + 0.618034f * lightIndex;
+        const float u1 = frameU1 + rotation - std::floor(frameU1 + rotation);
+        const float u2 = frameU2 + 1.7f * rotation - std::floor(frameU2 + 1.7f * rotation);
+        const Vector3 lightPoint = LightUtils::SampleLightPoint(light, closestHitLocation, u1, u2);
+
+        Vector3 closestHitDirectionToLight = lightPoint - closestHitLocation;
+        float maxDistance = closestHitDirectionToLight.Magnitude();
+        Vector3 normalizedDirectionToLight = closestHitDirectionToLight.Normalized();
 
-    // Update Color in Buffer
-    m_pBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBuffer->format,
-        static_cast<uint8_t>(finalColor.r * 255.f),
-        static_cast<uint8_t>(finalColor.g * 255.f),
-        static_cast<uint8_t>(finalColor.b * 255.f));
+        float NdotL = Vector3::Dot(normalizedDirectionToLight, normalizedHitNormal);
+        if (NdotL <= 0) continue;
+
+        Ray hitTowardsLightRay(closestHitLocation, normalizedDirectionToLight, 0.0001f, maxDistance);
+        bool isInShadow{ false };
+        if (m_ShadowsEnabled)
+        {
+            const PerfStageScope shadowScope{ PerfStage::ShadowRays };
+            isInShadow = pScene->DoesHit(hitTowardsLightRay);
+            RayStats& stats = RayStats::GetThreadStats();
+            ++stats.shadowRays;
+            if (isInShadow) ++stats.shadowRaysOccluded;
+        }
+
+        if (!isInShadow)
+        {
+            switch (m_CurrentLightingMode) {
+            case LightingMode::Combined:
+                finalColor += LightUtils::GetRadiance(light, lightPoint, closestHitLocation)
+                    * materials[closestHit.materialIndex]->Shade(closestHit, normalizedDirectionToLight, -rayDirection)
+                    * NdotL;
+                break;
+            case LightingMode::ObservedArea:
+                finalColor += ColorRGB{ 1, 1, 1 } *NdotL;
+                break;
+            case LightingMode::Radiance:
+                finalColor += LightUtils::GetRadiance(light, lightPoint, closestHitLocation);
+                break;
+            case LightingMode::BRDF:
+                finalColor += materials[closestHit.materialIndex]->Shade(closestHit, normalizedDirectionToLight, -rayDirection);
+                break;
+            }
+        }
+    }
+
+    return finalColor;
 }
-bool Renderer::SaveBufferToImage() const
+
+const Renderer::PixelHistory* Renderer::ReprojectHistory(const PixelHistory& current) const
 {
-	return SDL_SaveBMP(m_pBuffer, "RayTracing_Buffer.bmp");
+    if (!m_HasPreviousFrame) return nullptr;
+
+    // World -> previous camera space (cameraToWorld is orthonormal, so the inverse is a transpose)
+    const Vector3 toHit = current.position - m_PreviousCameraOrigin;
+    const float viewX = Vector3::Dot(toHit, m_PreviousCameraToWorld.GetAxisX());
+    const float viewY = Vector3::Dot(toHit, m_PreviousCameraToWorld.GetAxisY());
+    const float viewZ = Vector3::Dot(toHit, m_PreviousCameraToWorld.GetAxisZ());
+    if (viewZ <= 0.f) return nullptr;
+
+    // Previous camera space -> previous raster space (inverse of the ray generation in RenderPixel)
+    const float aspectRatio = static_cast<float>(m_FullWidth) / static_cast<float>(m_FullHeight);
+    const float Cx = viewX / viewZ;
+    const float Cy = viewY / viewZ;
+    const int prevPx = static_cast<int>(std::floor((Cx / (aspectRatio * m_PreviousFov) + 1.f) * 0.5f * m_FullWidth)) - m_CropX;
+    const int prevPy = static_cast<int>(std::floor((1.f - Cy / m_PreviousFov) * 0.5f * m_FullHeight)) - m_CropY;
+    if (prevPx < 0 || prevPx >= m_Width || prevPy < 0 || prevPy >= m_Height) return nullptr;
+
+    const PixelHistory& previous = m_PreviousHistory[prevPx + prevPy * m_Width];
+    if (!previous.isValid || previous.primitiveId != current.primitiveId) return nullptr;
+
+    // Disocclusion: the previous frame saw something else at that pixel
+    const float depth = toHit.Magnitude();
+    if (std::abs(previous.depth - depth) > 0.01f * depth) return nullptr;
+    if (Vector3::Dot(previous.normal, current.normal) < 0.95f) return nullptr;
+
+    return &previous;
+}
+
+void Renderer::InvalidateHistory()
+{
+    m_HasPreviousFrame = false;
+}
+
+void Renderer::SortTilesByPriority()
+{
+    // Carried over tiles first (oldest first), then rings around the screen centre,
+    // within a ring the tiles that changed most recently
+    std::sort(m_TileOrder.begin(), m_TileOrder.end(), [this](uint32_t a, uint32_t b)
+        {
+            const Tile& tileA = m_Tiles[a];
+            const Tile& tileB = m_Tiles[b];
+
+            if (tileA.staleFrames != tileB.staleFrames) return tileA.staleFrames > tileB.staleFrames;
+
+            const int ringA = static_cast<int>(tileA.centreDistance * 4.f);
+            const int ringB = static_cast<int>(tileB.centreDistance * 4.f);
+            if (ringA != ringB) return ringA < ringB;
+
+            if (tileA.lastChangedFrame != tileB.lastChangedFrame) return tileA.lastChangedFrame > tileB.lastChangedFrame;
+            return tileA.centreDistance < tileB.centreDistance;
+        });
+}
+
+bool Renderer::IsTracedThisFrame(uint32_t pixelIndex) const
+{
+    if (!m_CheckerboardEnabled) return true;
+
+    const uint32_t px{ pixelIndex % m_Width + m_CropX }, py{ pixelIndex / m_Width + m_CropY };
+    return ((px + py + m_FrameIndex) & 1) == 0;
+}
+
+void Renderer::ReconstructPixel(uint32_t pixelIndex, const Vector3& cameraOrigin)
+{
+    const int px{ static_cast<int>(pixelIndex % m_Width) }, py{ static_cast<int>(pixelIndex / m_Width) };
+
+    // The 4-neighbourhood of a skipped pixel was traced this frame
+    const PixelHistory* neighbours[4]{};
+    int amountOfNeighbours{ 0 };
+    const int offsets[4][2]{ { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    for (const auto& offset : offsets)
+    {
+        const int nx = px + offset[0], ny = py + offset[1];
+        if (nx < 0 || nx >= m_Width || ny < 0 || ny >= m_Height) continue;
+
+        const PixelHistory& neighbour = m_History[nx + ny * m_Width];
+        if (neighbour.isValid) neighbours[amountOfNeighbours++] = &neighbour;
+    }
+
+    PixelHistory& history = m_History[pixelIndex];
+    history.isValid = amountOfNeighbours > 0;
+    if (!history.isValid)
+    {
+        WritePixel(pixelIndex, {});
+        return;
+    }
+
+    // Pick the primitive most neighbours agree on, the closest one wins a tie (foreground edges stay sharp)
+    const PixelHistory* pDominant{ neighbours[0] };
+    int dominantVotes{ 0 };
+    for (int i{ 0 }; i < amountOfNeighbours; ++i)
+    {
+        int votes{ 0 };
+        for (int j{ 0 }; j < amountOfNeighbours; ++j)
+            if (neighbours[j]->primitiveId == neighbours[i]->primitiveId) ++votes;
+
+        if (votes > dominantVotes || (votes == dominantVotes && neighbours[i]->depth < pDominant->depth))
+        {
+            pDominant = neighbours[i];
+            dominantVotes = votes;
+        }
+    }
+
+    // Only blend neighbours on the same primitive so colours never bleed across edges
+    ColorRGB averageColor{};
+    Vector3 averagePosition{};
+    Vector3 averageNormal{};
+    for (int i{ 0 }; i < amountOfNeighbours; ++i)
+    {
+        if (neighbours[i]->primitiveId != pDominant->primitiveId) continue;
+
+        averageColor += neighbours[i]->color;
+        averagePosition += neighbours[i]->position;
+        averageNormal += neighbours[i]->normal;
+    }
+    averageColor /= static_cast<float>(dominantVotes);
+    averagePosition /= static_cast<float>(dominantVotes);
+
+    history.position = averagePosition;
+    history.normal = averageNormal.Normalized();
+    history.depth = (averagePosition - cameraOrigin).Magnitude();
+    history.primitiveId = pDominant->primitiveId;
+
+    // The previous frame traced this pixel (parity flips every frame), prefer it over the spatial guess
+    if (const PixelHistory* pPrevious = ReprojectHistory(history))
+    {
+        history.color = pPrevious->color;
+        history.sampleCount = pPrevious->sampleCount;
+    }
+    else
+    {
+        history.color = averageColor;
+        history.sampleCount = 1;
+    }
+
+    WritePixel(pixelIndex, history.color);
+}
+
+void Renderer::WritePixel(uint32_t pixelIndex, ColorRGB color)
+{
+    // Linear radiance, clamping and packing happen in ResolveTile
+    m_HdrRed[pixelIndex] = color.r;
+    m_HdrGreen[pixelIndex] = color.g;
+    m_HdrBlue[pixelIndex] = color.b;
+}
+
+void Renderer::ResolveTile(Tile& tile)
+{
+    const uint32_t alphaMask = m_AlphaMask;
+    const int redShift = m_RedShift;
+    const int greenShift = m_GreenShift;
+    const int blueShift = m_BlueShift;
+    uint64_t checksum{ 0 };
+
+    // Exposure -> tone mapping -> gamma -> 8 bit, identical math for the SIMD and the scalar tail
+    const auto resolveScalar = [&](uint32_t pixelIndex)
+        {
+            ColorRGB color{ m_HdrRed[pixelIndex] * m_Exposure, m_HdrGreen[pixelIndex] * m_Exposure, m_HdrBlue[pixelIndex] * m_Exposure };
+            switch (m_ToneMapping)
+            {
+            case ToneMapping::MaxToOne:
+                color.MaxToOne();
+                break;
+            case ToneMapping::Reinhard:
+                color = { color.r / (1.f + color.r), color.g / (1.f + color.g), color.b / (1.f + color.b) };
+                break;
+            case ToneMapping::ACES:
+            {
+                const auto aces = [](float x) { return (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f); };
+                color = { aces(color.r), aces(color.g), aces(color.b) };
+                break;
+            }
+            }
+
+            color = { std::clamp(color.r, 0.f, 1.f), std::clamp(color.g, 0.f, 1.f), std::clamp(color.b, 0.f, 1.f) };
+            if (m_ToneMapping != ToneMapping::MaxToOne)
+                color = { std::sqrt(color.r), std::sqrt(color.g), std::sqrt(color.b) };
+
+            m_pBufferPixels[pixelIndex] = alphaMask
+                | (static_cast<uint32_t>(color.r * 255.f) << redShift)
+                | (static_cast<uint32_t>(color.g * 255.f) << greenShift)
+                | (static_cast<uint32_t>(color.b * 255.f) << blueShift);
+        };
+
+    for (int py{ tile.y }; py < tile.y + tile.height; ++py)
+    {
+        const uint32_t rowStart = tile.x + py * m_Width;
+        const uint32_t rowEnd = rowStart + tile.width;
+        uint32_t pixelIndex = rowStart;
+
+#if defined(RESOLVE_SSE)
+        const __m128 exposure = _mm_set1_ps(m_Exposure);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 scale = _mm_set1_ps(255.f);
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(alphaMask));
+        const __m128i redCount = _mm_cvtsi32_si128(redShift);
+        const __m128i greenCount = _mm_cvtsi32_si128(greenShift);
+        const __m128i blueCount = _mm_cvtsi32_si128(blueShift);
+
+        // 4 pixels at a time, the channels are stored as separate planes so no shuffles are needed
+        for (; pixelIndex + 4 <= rowEnd; pixelIndex += 4)
+        {
+            __m128 r = _mm_mul_ps(_mm_loadu_ps(&m_HdrRed[pixelIndex]), exposure);
+            __m128 g = _mm_mul_ps(_mm_loadu_ps(&m_HdrGreen[pixelIndex]), exposure);
+            __m128 b = _mm_mul_ps(_mm_loadu_ps(&m_HdrBlue[pixelIndex]), exposure);
+
+            switch (m_ToneMapping)
+            {
+            case ToneMapping::MaxToOne:
+            {
+                const __m128 maxValue = _mm_max_ps(_mm_max_ps(r, _mm_max_ps(g, b)), one);
+                r = _mm_div_ps(r, maxValue);
+                g = _mm_div_ps(g, maxValue);
+                b = _mm_div_ps(b, maxValue);
+                break;
+            }
+            case ToneMapping::Reinhard:
+                r = _mm_div_ps(r, _mm_add_ps(one, r));
+                g = _mm_div_ps(g, _mm_add_ps(one, g));
+                b = _mm_div_ps(b, _mm_add_ps(one, b));
+                break;
+            case ToneMapping::ACES:
+            {
+                const auto aces = [](__m128 x)
+                    {
+                        const __m128 numerator = _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.51f), x), _mm_set1_ps(0.03f)));
+                        const __m128 denominator = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.43f), x), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f));
+                        return _mm_div_ps(numerator, denominator);
+                    };
+                r = aces(r);
+                g = aces(g);
+                b = aces(b);
+                break;
+            }
+            }
+
+            r = _mm_min_ps(_mm_max_ps(r, zero), one);
+            g = _mm_min_ps(_mm_max_ps(g, zero), one);
+            b = _mm_min_ps(_mm_max_ps(b, zero), one);
+            if (m_ToneMapping != ToneMapping::MaxToOne)
+            {
+                r = _mm_sqrt_ps(r);
+                g = _mm_sqrt_ps(g);
+                b = _mm_sqrt_ps(b);
+            }
+
+            // Truncate like the scalar cast, then pack into the surface's native layout
+            __m128i packed = alpha;
+            packed = _mm_or_si128(packed, _mm_sll_epi32(_mm_cvttps_epi32(_mm_mul_ps(r, scale)), redCount));
+            packed = _mm_or_si128(packed, _mm_sll_epi32(_mm_cvttps_epi32(_mm_mul_ps(g, scale)), greenCount));
+            packed = _mm_or_si128(packed, _mm_sll_epi32(_mm_cvttps_epi32(_mm_mul_ps(b, scale)), blueCount));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&m_pBufferPixels[pixelIndex]), packed);
+        }
+#endif
+
+        for (; pixelIndex < rowEnd; ++pixelIndex)
+        {
+            resolveScalar(pixelIndex);
+        }
+
+        // Hashed while the row is still in cache
+        if (tile.isFinished)
+        {
+            for (pixelIndex = rowStart; pixelIndex < rowEnd; ++pixelIndex)
+            {
+                checksum = checksum * 31 + m_pBufferPixels[pixelIndex];
+            }
+        }
+    }
+
+    // Remember which tiles changed, they are the most likely to change again
+    if (tile.isFinished && checksum != tile.checksum)
+    {
+        tile.checksum = checksum;
+        tile.lastChangedFrame = m_FrameIndex;
+    }
+}
+
+void Renderer::SaveBufferToImage(FrameWriter::Format format)
+{
+	QueueImage(format, "RayTracing_Buffer");
+}
+void Renderer::SaveBufferToImage(FrameWriter::Format format, const std::string& prefix, int number)
+{
+	QueueImage(format, prefix, number);
+}
+void Renderer::ResetAccumulation()
+{
+	InvalidateHistory();
+	m_FrameIndex = 0;
+}
+void Renderer::SetCropWindow(int fullWidth, int fullHeight, int x, int y)
+{
+	m_FullWidth = fullWidth;
+	m_FullHeight = fullHeight;
+	m_CropX = x;
+	m_CropY = y;
+	InvalidateHistory();
+}
+void Renderer::SetOutputBuffer(uint32_t* pPixels)
+{
+	if (pPixels)
+		m_pBufferPixels = pPixels;
+	else
+		m_pBufferPixels = m_pSurfacePixels ? m_pSurfacePixels : m_OffscreenPixels.data();
+}
+#if !defined(RT_NO_SDL)
+void Renderer::Present(const uint32_t* pPixels)
+{
+	TRACE_SCOPE("Present");
+	std::copy_n(pPixels, m_Width * m_Height, m_pSurfacePixels);
+	SDL_UpdateWindowSurface(m_pWindow);
+}
+#endif
+void Renderer::ToggleCapture()
+{
+	m_IsCapturing = !m_IsCapturing;
+	std::cout << (m_IsCapturing ? "Capturing every frame" : "Capture stopped") << std::endl;
+}
+void Renderer::QueueImage(FrameWriter::Format format, const std::string& prefix, int number)
+{
+	// Only a copy into a pooled frame happens here, encoding and writing are up to the writer thread
+	FrameWriter::Frame* pFrame = m_FrameWriter.Acquire();
+	pFrame->width = m_Width;
+	pFrame->height = m_Height;
+	pFrame->format = format;
+	pFrame->prefix = prefix;
+	pFrame->number = number;
+
+	if (format == FrameWriter::Format::EXR)
+	{
+		pFrame->red.assign(m_HdrRed.begin(), m_HdrRed.end());
+		pFrame->green.assign(m_HdrGreen.begin(), m_HdrGreen.end());
+		pFrame->blue.assign(m_HdrBlue.begin(), m_HdrBlue.end());
+	}
+	else
+	{
+		pFrame->pixels.assign(m_pBufferPixels, m_pBufferPixels + m_Width * m_Height);
+		pFrame->redShift = m_RedShift;
+		pFrame->greenShift = m_GreenShift;
+		pFrame->blueShift = m_BlueShift;
+	}
+
+	m_FrameWriter.Submit(pFrame);
 }
 void Renderer::ToggleShadow()
 {
 	m_ShadowsEnabled = !m_ShadowsEnabled;
+	InvalidateHistory();
 }
 void Renderer::CycleLightingMode()
 {
@@ -152,6 +827,33 @@ void Renderer::CycleLightingMode()
 		m_CurrentLightingMode = LightingMode::Combined;
 	}
 	else { m_CurrentLightingMode = LightingMode::ObservedArea; }
+	InvalidateHistory();
+}
+void Renderer::ToggleTemporalReprojection()
+{
+	m_TemporalReprojectionEnabled = !m_TemporalReprojectionEnabled;
+	InvalidateHistory();
+}
+void Renderer::CycleToneMapping()
+{
+	if (m_ToneMapping == ToneMapping::MaxToOne)
+	{
+		m_ToneMapping = ToneMapping::Reinhard;
+	}
+	else if (m_ToneMapping == ToneMapping::Reinhard)
+	{
+		m_ToneMapping = ToneMapping::ACES;
+	}
+	else { m_ToneMapping = ToneMapping::MaxToOne; }
+}
+void Renderer::ToggleFrameBudget()
+{
+	m_FrameBudgetEnabled = !m_FrameBudgetEnabled;
+}
+void Renderer::ToggleCheckerboard()
+{
+	m_CheckerboardEnabled = !m_CheckerboardEnabled;
+	InvalidateHistory();
 }
 
 //First vergion
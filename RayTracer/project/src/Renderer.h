@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cfloat>
 #include <cstdint>
+#include "FrameWriter.h"
 #include "Matrix.h"
 #include "Maths.h"
 #include "Material.h"
+#include "RayStats.h"
 
 
 
@@ -15,10 +18,24 @@ namespace dae
 {
 	class Scene;
 
+	//Where a worker's time goes, for PerfCounters; everything outside a PerfStageScope is Other
+	enum class PerfStage : uint32_t
+	{
+		Other,
+		Intersection, //closest hit of the camera rays
+		Shading, //ray generation, reprojection, lights and materials
+		ShadowRays
+	};
+	inline constexpr const char* g_PerfStageNames[]{ "other", "intersection", "shading", "shadow rays" };
+
 	class Renderer final
 	{
 	public:
+#if !defined(RT_NO_SDL)
 		Renderer(SDL_Window* pWindow);
+#endif
+		//Offscreen, for offline rendering: nothing is presented, images are only saved
+		Renderer(int width, int height);
 		~Renderer() = default;
 
 		Renderer(const Renderer&) = delete;
@@ -26,12 +43,60 @@ namespace dae
 		Renderer& operator=(const Renderer&) = delete;
 		Renderer& operator=(Renderer&&) noexcept = delete;
 
-		void Render(Scene* pScene) const;
-		void RenderPixel(const Scene* pScene, const  uint32_t pixelIndex, const  float fov, const float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin, const std::vector<dae::Material*>&, const std::vector<dae::Light>&) const;
-		bool SaveBufferToImage() const;
+		void Render(Scene* pScene);
+		//The rays traced for the pixel are counted in RayStats::GetThreadStats()
+		void RenderPixel(const Scene* pScene, const  uint32_t pixelIndex, const  float fov, const float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin, const std::vector<dae::Material*>&, const std::vector<dae::Light>&);
+		//Queued, written by a background thread as RayTracing_Buffer_<number>
+		void SaveBufferToImage(FrameWriter::Format format = FrameWriter::Format::PNG);
+		//Written as <prefix>_<number>, replacing an existing file
+		void SaveBufferToImage(FrameWriter::Format format, const std::string& prefix, int number);
+		//Writes every frame as Capture_<number>, rendering waits when the writer falls behind
+		void ToggleCapture();
+		//Blocks until every queued image is written
+		void FlushImages() { m_FrameWriter.Flush(); }
+		//Forgets previous frames, the next Render starts accumulating area light samples from scratch
+		void ResetAccumulation();
+		//Renders the region at x, y of a fullWidth x fullHeight image, the region is as big as this renderer.
+		//Rays, light samples and the checkerboard parity follow the full image, stitched regions equal a render of all of it
+		//as long as checkerboard and temporal reprojection are off: those only look at pixels inside the region, so its
+		//border pixels are reconstructed from fewer neighbours than in a full render.
+		void SetCropWindow(int fullWidth, int fullHeight, int x, int y);
+		//Frames are written to pPixels (width * height, packed like the surface) and not presented, for a render thread.
+		//nullptr goes back to the window surface, or the offscreen buffer
+		void SetOutputBuffer(uint32_t* pPixels);
+#if !defined(RT_NO_SDL)
+		//Copies a frame from SetOutputBuffer to the window, on the thread that created it
+		void Present(const uint32_t* pPixels);
+#endif
 
 		void ToggleShadow();
 		void CycleLightingMode();
+		void ToggleTemporalReprojection();
+		void ToggleCheckerboard();
+		void ToggleFrameBudget();
+		void CycleToneMapping();
+
+		//Timings of the last Render in milliseconds, and the rays it traced
+		struct FrameStats
+		{
+			float traceMs{};
+			float streamingMs{}; //paging in clustered geometry and tracing the pixels that waited for it
+			float reconstructMs{}; //checkerboard
+			float resolveMs{}; //tone mapping
+			float totalMs{};
+			RayStats rays{};
+		};
+		const FrameStats& GetFrameStats() const { return m_FrameStats; }
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+		//The last frame, width * height pixels packed like the surface (ARGB8888 offscreen) and as linear HDR planes
+		const uint32_t* GetPixels() const { return m_pBufferPixels; }
+		int GetRedShift() const { return m_RedShift; }
+		int GetGreenShift() const { return m_GreenShift; }
+		int GetBlueShift() const { return m_BlueShift; }
+		const std::vector<float>& GetHdrRed() const { return m_HdrRed; }
+		const std::vector<float>& GetHdrGreen() const { return m_HdrGreen; }
+		const std::vector<float>& GetHdrBlue() const { return m_HdrBlue; }
 	
 
 	private:
@@ -44,15 +109,121 @@ namespace dae
 			Combined
 		};
 
+		//Filmic modes (Reinhard, ACES) also encode with a 2.0 gamma, MaxToOne outputs linear like before
+		enum class ToneMapping
+		{
+			MaxToOne,
+			Reinhard,
+			ACES
+		};
+
+		//Shading of the primary hit, kept around so the next frame can reuse it
+		struct PixelHistory
+		{
+			ColorRGB color{};
+			Vector3 position{};
+			Vector3 normal{};
+			float depth{ FLT_MAX }; //distance from the camera origin to the primary hit
+			uint32_t primitiveId{ 0 };
+			uint32_t sampleCount{ 0 }; //frames of area light samples accumulated in color
+			bool isValid{ false };
+		};
+
+		ColorRGB ShadePixel(const Scene* pScene, const HitRecord& closestHit, const Vector3& rayDirection, const std::vector<dae::Material*>& materials, const std::vector<dae::Light>& lights, uint32_t px, uint32_t py) const;
+		const PixelHistory* ReprojectHistory(const PixelHistory& current) const;
+		void InvalidateHistory();
+
+		//Screen region rendered as one unit of work
+		struct Tile
+		{
+			int x{}, y{}, width{}, height{};
+			float centreDistance{}; //0 = screen centre, 1 = corner
+			uint32_t lastChangedFrame{ 0 };
+			uint32_t staleFrames{ 0 }; //frames in a row the budget ran out before reaching this tile
+			uint64_t checksum{ 0 };
+			bool isFinished{ false };
+		};
+
+		void SortTilesByPriority();
+		//Also hashes finished tiles to see whether they changed
+		void ResolveTile(Tile& tile);
+		bool IsTracedThisFrame(uint32_t pixelIndex) const;
+		void ReconstructPixel(uint32_t pixelIndex, const Vector3& cameraOrigin);
+		void WritePixel(uint32_t pixelIndex, ColorRGB color);
+		void Initialize();
+		void QueueImage(FrameWriter::Format format, const std::string& prefix, int number = -1);
+
 		LightingMode m_CurrentLightingMode{ LightingMode::Combined };
 		SDL_Window* m_pWindow{};
 
 		SDL_Surface* m_pBuffer{};
 		uint32_t* m_pBufferPixels{};
+		uint32_t* m_pSurfacePixels{}; //Render presents when it wrote here
+		std::vector<uint32_t> m_OffscreenPixels{}; //m_pBufferPixels when there's no window
+
+		//Packing of m_pBufferPixels
+		uint32_t m_AlphaMask{ 0xFF000000 };
+		int m_RedShift{ 16 };
+		int m_GreenShift{ 8 };
+		int m_BlueShift{ 0 };
+
+		//Linear HDR radiance, one plane per channel so the resolve pass can load 4 pixels at once
+		std::vector<float> m_HdrRed{};
+		std::vector<float> m_HdrGreen{};
+		std::vector<float> m_HdrBlue{};
+		float m_Exposure{ 1.f };
+		ToneMapping m_ToneMapping{ ToneMapping::MaxToOne };
 
 		int m_Width{};
 		int m_Height{};
 
+		//Crop window, the full image is the renderer itself unless SetCropWindow says otherwise
+		int m_FullWidth{};
+		int m_FullHeight{};
+		int m_CropX{ 0 };
+		int m_CropY{ 0 };
+
 		bool m_ShadowsEnabled{ true };
+
+		FrameStats m_FrameStats{};
+
+		//Temporal reprojection
+		bool m_TemporalReprojectionEnabled{ false };
+		uint32_t m_TemporalRefreshPeriod{ 8 }; //every pixel gets re-shaded at least once every N frames
+		uint32_t m_FrameIndex{ 0 };
+
+		//Area lights get one shadow sample per light per frame, accumulated over at most this many frames
+		bool m_HasAreaLights{ false };
+		uint32_t m_MaxAccumulatedFrames{ 32 };
+
+		//Checkerboard: trace half the pixels, reconstruct the other half
+		bool m_CheckerboardEnabled{ false };
+
+		//Tile scheduling, with a budget Render presents whatever finished in time
+		bool m_FrameBudgetEnabled{ false };
+		float m_FrameBudgetMs{ 16.f };
+		int m_TileSize{ 32 };
+		std::vector<Tile> m_Tiles{};
+		std::vector<uint32_t> m_TileOrder{};
+		std::vector<uint32_t> m_WorkerIndices{};
+
+		//Out-of-core geometry, per worker list of pixels that hit clusters which weren't resident
+		std::vector<std::vector<uint32_t>> m_DeferredPixels{};
+		int m_MaxStreamingRounds{ 4 };
+
+		std::vector<PixelHistory> m_History{};
+		std::vector<PixelHistory> m_PreviousHistory{};
+
+		//Image output
+		FrameWriter m_FrameWriter{};
+		bool m_IsCapturing{ false };
+		FrameWriter::Format m_CaptureFormat{ FrameWriter::Format::PPM }; //cheapest to encode, keeps up best
+
+		const Scene* m_pPreviousScene{ nullptr };
+		uint32_t m_PreviousGeometryVersion{ 0 };
+		Matrix m_PreviousCameraToWorld{};
+		Vector3 m_PreviousCameraOrigin{};
+		float m_PreviousFov{};
+		bool m_HasPreviousFrame{ false };
 	};
 }
@@ -1,14 +1,21 @@
 #include "Scene.h"
 #include "Utils.h"
 #include "Material.h"
+#include "AssetCache.h"
+#include "RayStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <random>
 
 namespace dae {
 
 #pragma region Base Scene
 	//Initialize Scene with Default Solid Color Material (RED)
-	Scene::Scene() :
-		m_Materials({ new Material_SolidColor({1,0,0}) })
+	Scene::Scene()
 	{
+		AddMaterial(new Material_SolidColor({ 1,0,0 }));
 		m_SphereGeometries.reserve(32);
 		m_PlaneGeometries.reserve(32);
 		m_TriangleMeshGeometries.reserve(32);
@@ -17,13 +24,41 @@ namespace dae {
 
 	Scene::~Scene()
 	{
-		for (auto& pMaterial : m_Materials)
-		{
-			delete pMaterial;
-			pMaterial = nullptr;
-		}
+		//Backstop, derived destructors already waited
+		WaitForPreload();
+	}
+
+	void Scene::Activate()
+	{
+		if (m_Preload.valid())
+			m_Preload.get();
+
+		std::call_once(m_InitializeFlag, [this]
+			{
+				Initialize();
+				m_IsInitialized = true;
+			});
+	}
+
+	void Scene::WaitForPreload()
+	{
+		if (m_Preload.valid())
+			m_Preload.wait();
+	}
 
-		m_Materials.clear();
+	void Scene::PreloadAsync()
+	{
+		if (m_IsInitialized || m_Preload.valid())
+			return;
+
+		m_Preload = std::async(std::launch::async, [this]
+			{
+				std::call_once(m_InitializeFlag, [this]
+					{
+						Initialize();
+						m_IsInitialized = true;
+					});
+			});
 	}
 
 	void dae::Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
@@ -31,21 +66,29 @@ namespace dae {
 		//todo W1
 		HitRecord FinalClosestHit;
 
-		for (size_t sphereIndex{ 0 }; sphereIndex < m_SphereGeometries.size(); sphereIndex++)
+		//Primitive ids: spheres first, then planes, then every mesh triangle (0 is reserved for "no hit")
+		uint32_t primitiveId{ 1 };
+
+		RayStats& stats = RayStats::GetThreadStats();
+		stats.sphereTests += m_SphereGeometries.size();
+		stats.planeTests += m_PlaneGeometries.size();
+
+		for (size_t sphereIndex{ 0 }; sphereIndex < m_SphereGeometries.size(); sphereIndex++, primitiveId++)
 		{
 			GeometryUtils::HitTest_Sphere(m_SphereGeometries[sphereIndex], ray, closestHit);
 			if (closestHit.t < FinalClosestHit.t)
 			{
 				FinalClosestHit = closestHit;
-				
+				FinalClosestHit.primitiveId = primitiveId;
 			}
 		}
-		for (size_t planeIndex{ 0 }; planeIndex < m_PlaneGeometries.size(); planeIndex++)
+		for (size_t planeIndex{ 0 }; planeIndex < m_PlaneGeometries.size(); planeIndex++, primitiveId++)
 		{
 			GeometryUtils::HitTest_Plane(m_PlaneGeometries[planeIndex], ray, closestHit);
 			if (closestHit.t < FinalClosestHit.t)
 			{
 				FinalClosestHit = closestHit;
+				FinalClosestHit.primitiveId = primitiveId;
 			}
 		}
 		//for (size_t TriangleMeshIndex{ 0 }; TriangleMeshIndex < m_TriangleMeshGeometries.size(); TriangleMeshIndex++)
@@ -60,14 +103,20 @@ namespace dae {
 
 		for (size_t TriangleMeshIndex{ 0 }; TriangleMeshIndex < m_TriangleMeshGeometries.size(); TriangleMeshIndex++)
 		{
+			const std::vector<int>& indices = m_TriangleMeshGeometries[TriangleMeshIndex].GetIndices();
+			const uint32_t meshFirstPrimitiveId = primitiveId;
+			primitiveId += static_cast<uint32_t>(indices.size() / 3);
+
 			if (GeometryUtils::SlabTest_TriangleMesh(m_TriangleMeshGeometries[TriangleMeshIndex], ray))
 			{
-				for (int indicesIndex{}; indicesIndex < m_TriangleMeshGeometries[TriangleMeshIndex].indices.size(); indicesIndex += 3)
+				++stats.slabTestsPassed;
+				stats.triangleTests += indices.size() / 3;
+				for (int indicesIndex{}; indicesIndex < indices.size(); indicesIndex += 3)
 				{
 
-					Vector3 pos1 = m_TriangleMeshGeometries[TriangleMeshIndex].transformedPositions[m_TriangleMeshGeometries[TriangleMeshIndex].indices[indicesIndex]];
-					Vector3 pos2 = m_TriangleMeshGeometries[TriangleMeshIndex].transformedPositions[m_TriangleMeshGeometries[TriangleMeshIndex].indices[indicesIndex + 1]];
-					Vector3 pos3 = m_TriangleMeshGeometries[TriangleMeshIndex].transformedPositions[m_TriangleMeshGeometries[TriangleMeshIndex].indices[indicesIndex + 2]];
+					Vector3 pos1 = m_TriangleMeshGeometries[TriangleMeshIndex].transformedPositions[indices[indicesIndex]];
+					Vector3 pos2 = m_TriangleMeshGeometries[TriangleMeshIndex].transformedPositions[indices[indicesIndex + 1]];
+					Vector3 pos3 = m_TriangleMeshGeometries[TriangleMeshIndex].transformedPositions[indices[indicesIndex + 2]];
 
 					//dae::Triangle();
 					dae::Triangle triangle = Triangle{ pos1, pos2, pos3 };
@@ -78,16 +127,24 @@ namespace dae {
 					if (closestHit.t < FinalClosestHit.t)
 					{
 						FinalClosestHit = closestHit;
+						FinalClosestHit.primitiveId = meshFirstPrimitiveId + static_cast<uint32_t>(indicesIndex / 3);
 					}
 				}
 			}
 			else
 			{
+				++stats.slabTestsFailed;
 				//std::cout << "flase";
 			}
 		}
 
 
+		for (const auto& pClusteredMesh : m_ClusteredMeshes)
+		{
+			pClusteredMesh->GetClosestHit(ray, FinalClosestHit, primitiveId, m_GeometryFrame);
+			primitiveId += pClusteredMesh->GetAmountOfTriangles();
+		}
+
 		closestHit = FinalClosestHit;
 		//-------
 		//throw std::runtime_error("Not Implemented Yet");
@@ -95,9 +152,12 @@ namespace dae {
 	
 bool Scene::DoesHit(const Ray& ray) const
 {
+    RayStats& stats = RayStats::GetThreadStats();
+
     // First check for intersections with spheres (early return on hit)
     for (const  dae::Sphere& sphere : m_SphereGeometries)
     {
+        ++stats.sphereTests;
         if (GeometryUtils::HitTest_Sphere(sphere, ray))
         {
             return true; // Ray hits a sphere
@@ -107,6 +167,7 @@ bool Scene::DoesHit(const Ray& ray) const
     // Check for intersection with planes
     for (const dae::Plane& plane : m_PlaneGeometries)
     {
+        ++stats.planeTests;
         if (GeometryUtils::HitTest_Plane(plane, ray))
         {
             return true; // Ray hits a plane
@@ -116,14 +177,22 @@ bool Scene::DoesHit(const Ray& ray) const
     // If no intersection, check for intersections with triangle meshes using BVH or acceleration structures
     for (const dae::TriangleMesh& mesh : m_TriangleMeshGeometries)
     {
-        if (GeometryUtils::SlabTest_TriangleMesh(mesh, ray))
+        if (!GeometryUtils::SlabTest_TriangleMesh(mesh, ray))
         {
+            ++stats.slabTestsFailed;
+        }
+        else
+        {
+            ++stats.slabTestsPassed;
+
             // Check each triangle only if the slab test passed
-            for (size_t i = 0; i < mesh.indices.size(); i += 3)
+            const std::vector<int>& indices = mesh.GetIndices();
+            for (size_t i = 0; i < indices.size(); i += 3)
             {
-                const Vector3& pos1 = mesh.transformedPositions[mesh.indices[i]];
-                const Vector3& pos2 = mesh.transformedPositions[mesh.indices[i + 1]];
-                const Vector3& pos3 = mesh.transformedPositions[mesh.indices[i + 2]];
+                ++stats.triangleTests;
+                const Vector3& pos1 = mesh.transformedPositions[indices[i]];
+                const Vector3& pos2 = mesh.transformedPositions[indices[i + 1]];
+                const Vector3& pos3 = mesh.transformedPositions[indices[i + 2]];
 
                 Triangle triangle{ pos1, pos2, pos3 };
                 triangle.cullMode = mesh.cullMode;
@@ -137,9 +206,99 @@ bool Scene::DoesHit(const Ray& ray) const
         }
     }
 
+    for (const auto& pClusteredMesh : m_ClusteredMeshes)
+    {
+        if (pClusteredMesh->DoesHit(ray, m_GeometryFrame))
+        {
+            return true;
+        }
+    }
+
     return false; // No hit
 }
 
+	bool Scene::StreamGeometry()
+	{
+		struct Request
+		{
+			ClusteredMesh* pMesh{};
+			uint32_t clusterIndex{};
+		};
+
+		std::vector<Request> requests{};
+		for (const auto& pClusteredMesh : m_ClusteredMeshes)
+		{
+			for (const uint32_t clusterIndex : pClusteredMesh->TakeRequests())
+				requests.emplace_back(Request{ pClusteredMesh.get(), clusterIndex });
+		}
+
+		++m_GeometryFrame;
+		if (requests.empty())
+			return false;
+
+		//Whatever doesn't fit in the budget is requested again by the next pass
+		size_t incomingBytes{ 0 };
+		size_t amountOfRequests{ 0 };
+		for (; amountOfRequests < requests.size(); ++amountOfRequests)
+		{
+			const size_t bytes = requests[amountOfRequests].pMesh->GetClusterBytes(requests[amountOfRequests].clusterIndex);
+			if (amountOfRequests > 0 && incomingBytes + bytes > m_GeometryBudget) break;
+			incomingBytes += bytes;
+		}
+		requests.resize(amountOfRequests);
+
+		//Evict least recently used clusters until the new ones fit
+		struct Resident
+		{
+			ClusteredMesh* pMesh{};
+			ClusteredMesh::ClusterUsage usage{};
+		};
+		std::vector<Resident> resident{};
+		size_t residentBytes{ 0 };
+		for (const auto& pClusteredMesh : m_ClusteredMeshes)
+		{
+			for (const ClusteredMesh::ClusterUsage& usage : pClusteredMesh->GetResidentClusters())
+			{
+				resident.emplace_back(Resident{ pClusteredMesh.get(), usage });
+				residentBytes += usage.bytes;
+			}
+		}
+
+		if (residentBytes + incomingBytes > m_GeometryBudget)
+		{
+			std::sort(resident.begin(), resident.end(), [](const Resident& a, const Resident& b)
+				{
+					return a.usage.lastUsedFrame < b.usage.lastUsedFrame;
+				});
+
+			for (const Resident& cluster : resident)
+			{
+				if (residentBytes + incomingBytes <= m_GeometryBudget) break;
+
+				cluster.pMesh->EvictCluster(cluster.usage.clusterIndex);
+				residentBytes -= cluster.usage.bytes;
+			}
+		}
+
+		//Page the batch in concurrently, every cluster is a separate read
+		std::for_each(std::execution::par, requests.begin(), requests.end(), [](const Request& request)
+			{
+				request.pMesh->LoadCluster(request.clusterIndex);
+			});
+
+		return true;
+	}
+
+	void Scene::ResetMissingGeometry()
+	{
+		ClusteredMesh::ResetMissFlag();
+	}
+
+	bool Scene::HadMissingGeometry()
+	{
+		return ClusteredMesh::HadMiss();
+	}
+
 
 	
 
@@ -176,6 +335,19 @@ bool Scene::DoesHit(const Ray& ray) const
 		return &m_TriangleMeshGeometries.back();
 	}
 
+	ClusteredMesh* Scene::AddClusteredMesh(const std::string& clusterFilename, TriangleCullMode cullMode, unsigned char materialIndex)
+	{
+		auto pMesh = std::make_unique<ClusteredMesh>();
+		if (!pMesh->Open(clusterFilename))
+			return nullptr;
+
+		pMesh->cullMode = cullMode;
+		pMesh->materialIndex = materialIndex;
+
+		m_ClusteredMeshes.emplace_back(std::move(pMesh));
+		return m_ClusteredMeshes.back().get();
+	}
+
 	Light* Scene::AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color)
 	{
 		Light l;
@@ -200,9 +372,44 @@ bool Scene::DoesHit(const Ray& ray) const
 		return &m_Lights.back();
 	}
 
+	Light* Scene::AddSphereLight(const Vector3& origin, float radius, float intensity, const ColorRGB& color)
+	{
+		Light l;
+		l.origin = origin;
+		l.radius = radius;
+		l.intensity = intensity;
+		l.color = color;
+		l.type = LightType::SphereArea;
+
+		m_Lights.emplace_back(l);
+		return &m_Lights.back();
+	}
+
+	//Emits to the side Cross(halfExtentU, halfExtentV) points to
+	Light* Scene::AddRectLight(const Vector3& origin, const Vector3& halfExtentU, const Vector3& halfExtentV, float intensity, const ColorRGB& color)
+	{
+		Light l;
+		l.origin = origin;
+		l.halfExtentU = halfExtentU;
+		l.halfExtentV = halfExtentV;
+		l.direction = Vector3::Cross(halfExtentU, halfExtentV).Normalized();
+		l.intensity = intensity;
+		l.color = color;
+		l.type = LightType::RectArea;
+
+		m_Lights.emplace_back(l);
+		return &m_Lights.back();
+	}
+
 	unsigned char Scene::AddMaterial(Material* pMaterial)
 	{
-		m_Materials.push_back(pMaterial);
+		return AddMaterial(std::shared_ptr<Material>(pMaterial));
+	}
+
+	unsigned char Scene::AddMaterial(std::shared_ptr<Material> pMaterial)
+	{
+		m_Materials.push_back(pMaterial.get());
+		m_MaterialHandles.emplace_back(std::move(pMaterial));
 		return static_cast<unsigned char>(m_Materials.size() - 1);
 	}
 #pragma endregion
@@ -270,14 +477,14 @@ bool Scene::DoesHit(const Ray& ray) const
 		m_Camera.origin = { 0.f, 3.f, -9.f };
 		m_Camera.fovAngle = 45.f;
 
-		const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
-		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
-		const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
-		const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, 1.f));
-		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, .6f));
-		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, .1f));
+		const auto matCT_GrayRoughMetal = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .972f, .960f, .915f }, 1.f, 1.f));
+		const auto matCT_GrayMediumMetal = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .972f, .960f, .915f }, 1.f, .6f));
+		const auto matCT_GraySmoothMetal = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .972f, .960f, .915f }, 1.f, .1f));
+		const auto matCT_GrayRoughPlastic = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .75f, .75f, .75f }, 0.f, 1.f));
+		const auto matCT_GrayMediumPlastic = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .75f, .75f, .75f }, 0.f, .6f));
+		const auto matCT_GraySmoothPlastic = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .75f, .75f, .75f }, 0.f, .1f));
 
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ 0.49f, 0.57f, 0.57f }, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(ColorRGB{ 0.49f, 0.57f, 0.57f }, 1.f));
 
 		//Planes
 		AddPlane({ 0.f, 0.f, 10.f }, { 0.f, 0.f,-1.f }, matLambert_GrayBlue);
@@ -304,10 +511,10 @@ bool Scene::DoesHit(const Ray& ray) const
 		m_Camera.origin = { 0.f, 1.f, -5.f };
 		m_Camera.fovAngle = 45.f;
 
-		const auto matLambert_Red = AddMaterial(new Material_Lambert(colors::Red, 1.f));
-		const auto matLambert_Blue = AddMaterial(new Material_Lambert(colors::Blue,1.f));
-		const auto matLambert_Yellow = AddMaterial(new Material_Lambert(colors::Yellow, 1.f));
-		const auto matLambertPhong = AddMaterial(new Material_LambertPhong(colors::Blue, 1.f, 1.f, 60.f));
+		const auto matLambert_Red = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(colors::Red, 1.f));
+		const auto matLambert_Blue = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(colors::Blue,1.f));
+		const auto matLambert_Yellow = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(colors::Yellow, 1.f));
+		const auto matLambertPhong = AddMaterial(AssetCache::GetMaterial<Material_LambertPhong>(colors::Blue, 1.f, 1.f, 60.f));
 
 		AddSphere({ -.75f, 1.f, 0.f }, 1.f, matLambert_Red);
 		AddSphere({ 0.75f, 1.f, 0.f }, 1.f, matLambertPhong);
@@ -324,14 +531,14 @@ bool Scene::DoesHit(const Ray& ray) const
 		m_Camera.origin = { 0.f, 3.f, -9.f };
 		m_Camera.fovAngle = 45.f;
 
-		const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
-		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
-		const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
-		const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, 1.f));
-		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, .6f));
-		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, .1f));
+		const auto matCT_GrayRoughMetal = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .972f, .960f, .915f }, 1.f, 1.f));
+		const auto matCT_GrayMediumMetal = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .972f, .960f, .915f }, 1.f, .6f));
+		const auto matCT_GraySmoothMetal = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .972f, .960f, .915f }, 1.f, .1f));
+		const auto matCT_GrayRoughPlastic = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .75f, .75f, .75f }, 0.f, 1.f));
+		const auto matCT_GrayMediumPlastic = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .75f, .75f, .75f }, 0.f, .6f));
+		const auto matCT_GraySmoothPlastic = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .75f, .75f, .75f }, 0.f, .1f));
 
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ 0.49f, 0.57f, 0.57f }, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(ColorRGB{ 0.49f, 0.57f, 0.57f }, 1.f));
 
 		AddPlane({ 0.f, 0.f, 10.f }, { 0.f, 0.f, -1.f },matLambert_GrayBlue);
 		AddPlane({ 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, matLambert_GrayBlue);
@@ -342,9 +549,9 @@ bool Scene::DoesHit(const Ray& ray) const
 		
 		
 
-		const auto matLambertPhong1 = AddMaterial(new Material_LambertPhong(colors::Blue, 0.5f, 0.5f,3.f));
-		const auto matLambertPhong2 = AddMaterial(new Material_LambertPhong(colors::Blue, 0.5f, 0.5f,15.f));
-		const auto matLambertPhong3 = AddMaterial(new Material_LambertPhong(colors::Blue, 0.5f, 0.5f,50.f));
+		const auto matLambertPhong1 = AddMaterial(AssetCache::GetMaterial<Material_LambertPhong>(colors::Blue, 0.5f, 0.5f,3.f));
+		const auto matLambertPhong2 = AddMaterial(AssetCache::GetMaterial<Material_LambertPhong>(colors::Blue, 0.5f, 0.5f,15.f));
+		const auto matLambertPhong3 = AddMaterial(AssetCache::GetMaterial<Material_LambertPhong>(colors::Blue, 0.5f, 0.5f,50.f));
 
 	
 		AddSphere({ -1.75f, 1.f, 0.f }, 0.75f, matLambertPhong1);
@@ -368,8 +575,8 @@ bool Scene::DoesHit(const Ray& ray) const
 		m_Camera.fovAngle = 45.f;
 
 		// Materials
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, .57f, .57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.0f));
+		const auto matLambert_GrayBlue = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(ColorRGB{ .49f, .57f, .57f }, 1.f));
+		const auto matLambert_White = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(colors::White, 1.0f));
 
 		// Planes
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
@@ -399,8 +606,8 @@ bool Scene::DoesHit(const Ray& ray) const
 		m_Camera.fovAngle = 45.f;
 
 		// Materials
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, .57f, .57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.0f));
+		const auto matLambert_GrayBlue = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(ColorRGB{ .49f, .57f, .57f }, 1.f));
+		const auto matLambert_White = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(colors::White, 1.0f));
 
 		// Planes
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
@@ -447,8 +654,8 @@ bool Scene::DoesHit(const Ray& ray) const
 		m_Camera.fovAngle = 45.f;
 
 		// Materials
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, .57f, .57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.0f));
+		const auto matLambert_GrayBlue = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(ColorRGB{ .49f, .57f, .57f }, 1.f));
+		const auto matLambert_White = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(colors::White, 1.0f));
 
 		// Planes
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
@@ -474,10 +681,7 @@ bool Scene::DoesHit(const Ray& ray) const
 		//pMesh->UpdateTransforms();
 
 		pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		Utils::ParseOBJ("Resources/simple_Cube.obj",
-			pMesh->positions,
-			pMesh->normals,
-			pMesh->indices);
+		pMesh->SetSharedData(AssetCache::GetMesh("resources/simple_cube.obj"));
 
 		pMesh->Scale({ .7f,.7f,.7f });
 		pMesh->Translate({ 0.f,1.f,0.f });
@@ -507,15 +711,15 @@ bool Scene::DoesHit(const Ray& ray) const
 		m_Camera.fovAngle = 45.f;
 
 		// Materials
-		const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
-		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
-		const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
-		const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, 1.f));
-		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, .6f));
-		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, .1f));
+		const auto matCT_GrayRoughMetal = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .972f, .960f, .915f }, 1.f, 1.f));
+		const auto matCT_GrayMediumMetal = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .972f, .960f, .915f }, 1.f, .6f));
+		const auto matCT_GraySmoothMetal = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .972f, .960f, .915f }, 1.f, .1f));
+		const auto matCT_GrayRoughPlastic = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .75f, .75f, .75f }, 0.f, 1.f));
+		const auto matCT_GrayMediumPlastic = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .75f, .75f, .75f }, 0.f, .6f));
+		const auto matCT_GraySmoothPlastic = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .75f, .75f, .75f }, 0.f, .1f));
 
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, .57f, .57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.0f));
+		const auto matLambert_GrayBlue = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(ColorRGB{ .49f, .57f, .57f }, 1.f));
+		const auto matLambert_White = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(colors::White, 1.0f));
 
 		// Planes
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
@@ -578,15 +782,15 @@ bool Scene::DoesHit(const Ray& ray) const
 		m_Camera.fovAngle = 45.f;
 
 		// Materials
-		const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
-		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
-		const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
-		const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, 1.f));
-		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, .6f));
-		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, .1f));
+		const auto matCT_GrayRoughMetal = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .972f, .960f, .915f }, 1.f, 1.f));
+		const auto matCT_GrayMediumMetal = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .972f, .960f, .915f }, 1.f, .6f));
+		const auto matCT_GraySmoothMetal = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .972f, .960f, .915f }, 1.f, .1f));
+		const auto matCT_GrayRoughPlastic = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .75f, .75f, .75f }, 0.f, 1.f));
+		const auto matCT_GrayMediumPlastic = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .75f, .75f, .75f }, 0.f, .6f));
+		const auto matCT_GraySmoothPlastic = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .75f, .75f, .75f }, 0.f, .1f));
 
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, .57f, .57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.0f));
+		const auto matLambert_GrayBlue = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(ColorRGB{ .49f, .57f, .57f }, 1.f));
+		const auto matLambert_White = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(colors::White, 1.0f));
 
 		// Planes
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
@@ -597,10 +801,7 @@ bool Scene::DoesHit(const Ray& ray) const
 
 		//BUNNY MESH
 		pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		Utils::ParseOBJ("Resources/lowpoly_bunny.obj",
-			pMesh->positions,
-			pMesh->normals,
-			pMesh->indices);
+		pMesh->SetSharedData(AssetCache::GetMesh("resources/lowpoly_bunny.obj"));
 		
 		pMesh->Scale({ 2.f,2.f,2.f });
 		pMesh->RotateY(PI);
@@ -618,6 +819,256 @@ bool Scene::DoesHit(const Ray& ray) const
 
 	}
 #pragma endregion
-}
+#pragma region SCENE W5
+	void Scene_W5_AreaLightScene::Initialize()
+	{
+		sceneName = "AreaLightScene";
+		m_Camera.origin = { 0, 3, -9 };
+		m_Camera.fovAngle = 45.f;
+
+		// Materials
+		const auto matCT_GrayMediumMetal = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .972f, .960f, .915f }, 1.f, .6f));
+		const auto matCT_GrayRoughPlastic = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .75f, .75f, .75f }, 0.f, 1.f));
+		const auto matCT_GraySmoothPlastic = AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(ColorRGB{ .75f, .75f, .75f }, 0.f, .1f));
+		const auto matLambert_GrayBlue = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(ColorRGB{ .49f, .57f, .57f }, 1.f));
+
+		// Planes
+		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //BOTTOM
+		AddPlane(Vector3{ 0.f, 10.f, 0.f }, Vector3{ 0.f, -1.f, 0.f }, matLambert_GrayBlue); //TOP
+		AddPlane(Vector3{ 5.f, 0.f, 0.f }, Vector3{ -1.f, 0.f, 0.f }, matLambert_GrayBlue); //RIGHT
+		AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, matLambert_GrayBlue); //LEFT
 
+		//Spheres
+		AddSphere({ -1.75f, 1.f, 0.f }, 0.75f, matCT_GrayRoughPlastic);
+		AddSphere({ 0.f, 1.f, 0.f }, 0.75f, matCT_GrayMediumMetal);
+		AddSphere({ 1.75f, 1.f, 0.f }, 0.75f, matCT_GraySmoothPlastic);
+
+		// Light
+		AddRectLight(Vector3{ 0.f, 9.9f, 0.f }, Vector3{ 1.5f, 0.f, 0.f }, Vector3{ 0.f, 0.f, 1.f }, 60.f, ColorRGB{ 1.f, .9f, .8f }); //Ceiling panel
+		AddSphereLight(Vector3{ -2.5f, 5.f, -5.f }, 0.75f, 50.f, ColorRGB{ 1.f, .8f, .45f }); //Front Light Left
+		AddSphereLight(Vector3{ 2.5f, 2.5f, -5.f }, 0.5f, 30.f, ColorRGB{ .34f, .47f, .68f });
+	}
+#pragma endregion
+#pragma region SCENE GENERATED
+	namespace
+	{
+		//std::mt19937 gives the same sequence everywhere, the standard distributions don't, so map it ourselves
+		class SceneRandom final
+		{
+		public:
+			explicit SceneRandom(uint32_t seed) : m_Engine{ seed } {}
+
+			float Next() { return static_cast<float>(m_Engine() >> 8) * (1.f / 16777216.f); }
+			float Range(float min, float max) { return min + (max - min) * Next(); }
+			//Box-Muller, one of the pair is enough
+			float Gaussian()
+			{
+				const float u1 = std::max(Next(), 1e-7f);
+				return std::sqrt(-2.f * std::log(u1)) * std::cos(2.f * PI * Next());
+			}
 
+		private:
+			std::mt19937 m_Engine;
+		};
+
+		//Subdivided cube pushed onto a bumpy sphere with radius ~1, 12 * n * n triangles
+		std::shared_ptr<const MeshData> GenerateRock(uint32_t amountOfTriangles, SceneRandom& random)
+		{
+			const int n = std::max(1, static_cast<int>(std::lround(std::sqrt(amountOfTriangles / 12.f))));
+			const Vector3 phase{ random.Range(0.f, 2.f * PI), random.Range(0.f, 2.f * PI), random.Range(0.f, 2.f * PI) };
+
+			auto pData = std::make_shared<MeshData>();
+			pData->positions.reserve(6 * (n + 1) * (n + 1));
+			pData->indices.reserve(36 * n * n);
+			pData->normals.reserve(12 * n * n);
+
+			const Vector3 axes[3]{ Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ };
+			for (int face{ 0 }; face < 6; ++face)
+			{
+				const Vector3 normal = axes[face / 2] * (face % 2 ? -1.f : 1.f);
+				const Vector3& u = axes[(face / 2 + 1) % 3];
+				const Vector3& v = axes[(face / 2 + 2) % 3];
+
+				const int firstVertex = static_cast<int>(pData->positions.size());
+				for (int y{ 0 }; y <= n; ++y)
+				{
+					for (int x{ 0 }; x <= n; ++x)
+					{
+						const Vector3 onCube = normal + u * (2.f * x / n - 1.f) + v * (2.f * y / n - 1.f);
+						const Vector3 onSphere = onCube.Normalized();
+						const float bump = std::sin(3.f * onSphere.x + phase.x) * std::sin(4.f * onSphere.y + phase.y) * std::sin(5.f * onSphere.z + phase.z);
+						pData->positions.emplace_back(onSphere * (1.f + .15f * bump));
+					}
+				}
+
+				for (int y{ 0 }; y < n; ++y)
+				{
+					for (int x{ 0 }; x < n; ++x)
+					{
+						const int corner = firstVertex + y * (n + 1) + x;
+						const int quad[2][3]{ { corner, corner + 1, corner + n + 2 }, { corner, corner + n + 2, corner + n + 1 } };
+						for (const auto& triangle : quad)
+						{
+							int i0 = triangle[0], i1 = triangle[1], i2 = triangle[2];
+							const Vector3& p0 = pData->positions[i0];
+							Vector3 triangleNormal = Vector3::Cross(pData->positions[i1] - p0, pData->positions[i2] - p0).Normalized();
+
+							//Faces of the cube run both ways around, make every triangle face outwards
+							if (Vector3::Dot(triangleNormal, p0) < 0.f)
+							{
+								std::swap(i1, i2);
+								triangleNormal = -triangleNormal;
+							}
+							pData->indices.insert(pData->indices.end(), { i0, i1, i2 });
+							pData->normals.emplace_back(triangleNormal);
+						}
+					}
+				}
+			}
+			return pData;
+		}
+	}
+
+	Scene_Generated::Scene_Generated(const Settings& settings) :
+		m_Settings{ settings }
+	{
+	}
+
+	void Scene_Generated::Initialize()
+	{
+		sceneName = "GeneratedScene";
+		SceneRandom random{ m_Settings.seed };
+
+		const uint32_t amountOfObjects = std::max(1u, m_Settings.amountOfSpheres + m_Settings.amountOfMeshInstances);
+		const float objectsPerSide = std::cbrt(static_cast<float>(amountOfObjects));
+
+		//Uniform keeps a constant density, one object per 4x4x4 cell. The teapot packs the same objects
+		//into a cube a tenth of that size and puts the stands of the stadium 50 times further away.
+		const bool isStadium = m_Settings.distribution == Distribution::TeapotInStadium;
+		const float extent = std::max(8.f, 4.f * objectsPerSide) * (isStadium ? .1f : 1.f);
+		const float spacing = extent / objectsPerSide;
+		const Vector3 center{ 0.f, extent * .5f, 0.f };
+
+		std::vector<Vector3> clusterCenters{};
+		if (m_Settings.distribution == Distribution::Clustered)
+		{
+			const uint32_t amountOfClusters = std::max(1u, static_cast<uint32_t>(std::sqrt(static_cast<float>(amountOfObjects)) * .5f));
+			for (uint32_t cluster{ 0 }; cluster < amountOfClusters; ++cluster)
+				clusterCenters.emplace_back(center + Vector3{ random.Range(-.5f, .5f), random.Range(-.5f, .5f), random.Range(-.5f, .5f) } * extent);
+		}
+		const float clusterSize = clusterCenters.empty() ? 0.f : .2f * extent / std::cbrt(static_cast<float>(clusterCenters.size()));
+
+		//Objects are never placed below the ground
+		const auto nextPosition = [&](float radius)
+			{
+				Vector3 position{};
+				if (clusterCenters.empty())
+					position = center + Vector3{ random.Range(-.5f, .5f), random.Range(-.5f, .5f), random.Range(-.5f, .5f) } * extent;
+				else
+				{
+					const Vector3& clusterCenter = clusterCenters[std::min(static_cast<size_t>(random.Next() * clusterCenters.size()), clusterCenters.size() - 1)];
+					position = clusterCenter + Vector3{ random.Gaussian(), random.Gaussian(), random.Gaussian() } * clusterSize;
+				}
+				position.y = std::max(position.y, radius);
+				return position;
+			};
+
+		m_Camera.origin = isStadium ? center + Vector3{ 0.f, 0.f, -2.f * extent } : center + Vector3{ 0.f, 0.f, -1.5f * extent };
+		m_Camera.fovAngle = 45.f;
+
+		// Materials
+		const unsigned char matLambert_Ground = AddMaterial(AssetCache::GetMaterial<Material_Lambert>(ColorRGB{ .49f, .57f, .57f }, 1.f));
+		std::vector<unsigned char> objectMaterials{};
+		for (int material{ 0 }; material < 8; ++material)
+		{
+			const ColorRGB color{ random.Range(.2f, .95f), random.Range(.2f, .95f), random.Range(.2f, .95f) };
+			if (material % 2)
+				objectMaterials.emplace_back(AddMaterial(AssetCache::GetMaterial<Material_CookTorrence>(color, static_cast<float>(material % 4 == 1), random.Range(.1f, 1.f))));
+			else
+				objectMaterials.emplace_back(AddMaterial(AssetCache::GetMaterial<Material_Lambert>(color, 1.f)));
+		}
+		const auto nextMaterial = [&] { return objectMaterials[std::min(static_cast<size_t>(random.Next() * objectMaterials.size()), objectMaterials.size() - 1)]; };
+
+		// Planes
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_Ground); //GROUND
+
+		// Spheres, in the stadium one in a hundred is a stand on a ring far outside the teapot
+		m_SphereGeometries.reserve(m_Settings.amountOfSpheres);
+		const uint32_t amountOfStands = isStadium ? m_Settings.amountOfSpheres / 100 : 0;
+		for (uint32_t stand{ 0 }; stand < amountOfStands; ++stand)
+		{
+			const float angle = 2.f * PI * stand / amountOfStands;
+			const float radius = 2.5f * extent;
+			AddSphere(Vector3{ std::cos(angle), 0.f, std::sin(angle) } * (50.f * extent), radius, nextMaterial());
+		}
+		for (uint32_t sphere{ amountOfStands }; sphere < m_Settings.amountOfSpheres; ++sphere)
+		{
+			const float radius = spacing * random.Range(.08f, .25f);
+			AddSphere(nextPosition(radius), radius, nextMaterial());
+		}
+
+		// Meshes, every instance shares the same triangles and only owns its transformed copy
+		if (m_Settings.amountOfMeshInstances > 0)
+		{
+			const std::shared_ptr<const MeshData> pRock = GenerateRock(m_Settings.trianglesPerMesh, random);
+			m_TriangleMeshGeometries.reserve(m_Settings.amountOfMeshInstances);
+			for (uint32_t instance{ 0 }; instance < m_Settings.amountOfMeshInstances; ++instance)
+			{
+				const float radius = spacing * random.Range(.1f, .3f);
+				const Vector3 position = nextPosition(radius);
+				TriangleMesh* pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, nextMaterial());
+				pMesh->SetSharedData(pRock);
+				pMesh->Scale({ radius, radius, radius });
+				pMesh->RotateY(random.Range(0.f, 2.f * PI));
+				pMesh->Translate(position);
+			}
+			std::for_each(std::execution::par, m_TriangleMeshGeometries.begin(), m_TriangleMeshGeometries.end(),
+				[](TriangleMesh& mesh) { mesh.UpdateTransforms(); });
+		}
+
+		// Light, spread over a plane above the objects, together always about as bright
+		m_Lights.reserve(m_Settings.amountOfLights);
+		const float lightHeight = extent * 1.25f;
+		for (uint32_t light{ 0 }; light < m_Settings.amountOfLights; ++light)
+		{
+			const Vector3 origin{ random.Range(-.5f, .5f) * extent, lightHeight, random.Range(-.75f, .25f) * extent };
+			const ColorRGB color{ 1.f, random.Range(.7f, 1.f), random.Range(.45f, .9f) };
+			AddPointLight(origin, 3.f * lightHeight * lightHeight / m_Settings.amountOfLights, color);
+		}
+	}
+
+	uint64_t Scene_Generated::GetAmountOfTriangles() const
+	{
+		uint64_t amountOfTriangles{ 0 };
+		for (const TriangleMesh& mesh : m_TriangleMeshGeometries)
+			amountOfTriangles += mesh.GetIndices().size() / 3;
+		return amountOfTriangles;
+	}
+
+	size_t Scene_Generated::GetGeometryBytes() const
+	{
+		size_t bytes = m_SphereGeometries.capacity() * sizeof(Sphere) + m_PlaneGeometries.capacity() * sizeof(Plane)
+			+ m_Lights.capacity() * sizeof(Light) + m_TriangleMeshGeometries.capacity() * sizeof(TriangleMesh);
+
+		for (const TriangleMesh& mesh : m_TriangleMeshGeometries)
+			bytes += (mesh.transformedPositions.capacity() + mesh.transformedNormals.capacity()) * sizeof(Vector3);
+
+		if (!m_TriangleMeshGeometries.empty() && m_TriangleMeshGeometries.front().pSharedData)
+		{
+			const MeshData& data = *m_TriangleMeshGeometries.front().pSharedData;
+			bytes += (data.positions.capacity() + data.normals.capacity()) * sizeof(Vector3) + data.indices.capacity() * sizeof(int);
+		}
+		return bytes;
+	}
+
+	bool Scene_Generated::ParseDistribution(const std::string& name, Distribution& distribution)
+	{
+		if (name == "uniform") distribution = Distribution::Uniform;
+		else if (name == "clustered") distribution = Distribution::Clustered;
+		else if (name == "stadium") distribution = Distribution::TeapotInStadium;
+		else return false;
+		return true;
+	}
+#pragma endregion
+}
\ No newline at end of file
@@ -1,10 +1,15 @@
 #pragma once
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "Maths.h"
 #include "DataTypes.h"
 #include "Camera.h"
+#include "ClusteredMesh.h"
 
 namespace dae
 {
@@ -33,6 +38,26 @@ namespace dae
 			m_Camera.Update(pTimer);
 		}
 
+		//Initializes the scene the first time it's used, finishes a running preload instead of initializing twice
+		void Activate();
+		//Starts initializing on a background thread so a later Activate doesn't stall a frame
+		void PreloadAsync();
+		bool IsInitialized() const { return m_IsInitialized; }
+		//Blocks until content that streams in over several frames has arrived, for renders that can't show a partial scene
+		virtual void WaitForContent() {}
+
+		//Out-of-core geometry: pages in the clusters rays asked for since the last call, evicting the least recently
+		//used ones to stay within the budget. Returns false when nothing was requested. Never call it while tracing.
+		bool StreamGeometry();
+		void SetGeometryBudget(size_t bytes) { m_GeometryBudget = bytes; }
+		bool HasClusteredMeshes() const { return !m_ClusteredMeshes.empty(); }
+		//Per thread: did a ray traced since the reset need geometry that wasn't resident
+		static void ResetMissingGeometry();
+		static bool HadMissingGeometry();
+
+		//Advanced whenever geometry is swapped in, history rendered before that can't be reused
+		uint32_t GetGeometryVersion() const { return m_GeometryVersion; }
+
 		Camera& GetCamera() { return m_Camera; }
 		void GetClosestHit(const Ray& ray, HitRecord& closestHit) const;
 		bool DoesHit(const Ray& ray) const;
@@ -51,7 +76,13 @@ namespace dae
 		std::vector<Sphere> m_SphereGeometries{};
 		std::vector<TriangleMesh> m_TriangleMeshGeometries{};
 		std::vector<Light> m_Lights{};
-		std::vector<Material*> m_Materials{};
+		std::vector<Material*> m_Materials{}; //non-owning, indexed by materialIndex
+		std::vector<std::shared_ptr<Material>> m_MaterialHandles{}; //owns m_Materials, possibly shared with other scenes
+
+		std::vector<std::unique_ptr<ClusteredMesh>> m_ClusteredMeshes{};
+		size_t m_GeometryBudget{ 256ull << 20 }; //bytes of cluster geometry kept resident
+		uint32_t m_GeometryFrame{ 1 }; //advanced by every StreamGeometry, clusters remember when they were last hit
+		uint32_t m_GeometryVersion{ 0 };
 
 		//Temp (individual triangle testing)
 		std::vector<Triangle> m_TriangleGeometries{};
@@ -61,10 +92,24 @@ namespace dae
 		Sphere* AddSphere(const Vector3& origin, float radius, unsigned char materialIndex = 0);
 		Plane* AddPlane(const Vector3& origin, const Vector3& normal, unsigned char materialIndex = 0);
 		TriangleMesh* AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex = 0);
+		//nullptr if the cluster file can't be opened, see ClusteredMesh::Build
+		ClusteredMesh* AddClusteredMesh(const std::string& clusterFilename, TriangleCullMode cullMode, unsigned char materialIndex = 0);
 
 		Light* AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
 		Light* AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
+		Light* AddSphereLight(const Vector3& origin, float radius, float intensity, const ColorRGB& color);
+		Light* AddRectLight(const Vector3& origin, const Vector3& halfExtentU, const Vector3& halfExtentV, float intensity, const ColorRGB& color);
 		unsigned char AddMaterial(Material* pMaterial);
+		unsigned char AddMaterial(std::shared_ptr<Material> pMaterial);
+
+		//Every derived scene calls this first thing in its destructor: a preload runs the derived Initialize, which
+		//must not write to destroyed members, or find only the base (pure virtual) left when it starts late
+		void WaitForPreload();
+
+	private:
+		std::once_flag m_InitializeFlag{};
+		std::future<void> m_Preload{};
+		std::atomic<bool> m_IsInitialized{ false };
 	};
 
 	//+++++++++++++++++++++++++++++++++++++++++
@@ -73,7 +118,7 @@ namespace dae
 	{
 	public:
 		Scene_W1() = default;
-		~Scene_W1() override = default;
+		~Scene_W1() override { WaitForPreload(); }
 
 		Scene_W1(const Scene_W1&) = delete;
 		Scene_W1(Scene_W1&&) noexcept = delete;
@@ -87,7 +132,7 @@ namespace dae
 	{
 	public:
 		Scene_W2() = default;
-		~Scene_W2() override = default;
+		~Scene_W2() override { WaitForPreload(); }
 
 		Scene_W2(const Scene_W2&) = delete;
 		Scene_W2(Scene_W2&&) noexcept = delete;
@@ -101,7 +146,7 @@ namespace dae
 	{
 	public:
 		Scene_W3() = default;
-		~Scene_W3() override = default;
+		~Scene_W3() override { WaitForPreload(); }
 
 		Scene_W3(const Scene_W3&) = delete;
 		Scene_W3(Scene_W3&&) noexcept = delete;
@@ -115,7 +160,7 @@ namespace dae
 	{
 	public:
 		Scene_W3_TestScene2() = default;
-		~Scene_W3_TestScene2() override = default;
+		~Scene_W3_TestScene2() override { WaitForPreload(); }
 
 		Scene_W3_TestScene2(const Scene_W3&) = delete;
 		Scene_W3_TestScene2(Scene_W3_TestScene2&&) noexcept = delete;
@@ -129,7 +174,7 @@ namespace dae
 	{
 	public:
 		Scene_W3_TestScene1() = default;
-		~Scene_W3_TestScene1() override = default;
+		~Scene_W3_TestScene1() override { WaitForPreload(); }
 
 		Scene_W3_TestScene1(const Scene_W3_TestScene1&) = delete;
 		Scene_W3_TestScene1(Scene_W3_TestScene1&&) noexcept = delete;
@@ -142,7 +187,7 @@ namespace dae
 	{
 	public:
 		Scene_W4_TestScene1() = default;
-		~Scene_W4_TestScene1() override = default;
+		~Scene_W4_TestScene1() override { WaitForPreload(); }
 
 		Scene_W4_TestScene1(const Scene_W4_TestScene1&) = delete;
 		Scene_W4_TestScene1(Scene_W4_TestScene1&&) noexcept = delete;
@@ -155,7 +200,7 @@ namespace dae
 	{
 	public:
 		Scene_W4_TestScene2() = default;
-		~Scene_W4_TestScene2() override = default;
+		~Scene_W4_TestScene2() override { WaitForPreload(); }
 
 		Scene_W4_TestScene2(const Scene_W4_TestScene2&) = delete;
 		Scene_W4_TestScene2(Scene_W4_TestScene2&&) noexcept = delete;
@@ -168,7 +213,7 @@ namespace dae
 	{
 	public:
 		Scene_W4_TestScene3() = default;
-		~Scene_W4_TestScene3() override = default;
+		~Scene_W4_TestScene3() override { WaitForPreload(); }
 
 		Scene_W4_TestScene3(const Scene_W4_TestScene3&) = delete;
 		Scene_W4_TestScene3(Scene_W4_TestScene3&&) noexcept = delete;
@@ -185,7 +230,7 @@ namespace dae
 	{
 	public:
 		Scene_W4_RefrenceScene() = default;
-		~Scene_W4_RefrenceScene() override = default;
+		~Scene_W4_RefrenceScene() override { WaitForPreload(); }
 
 		Scene_W4_RefrenceScene(const Scene_W4_RefrenceScene&) = delete;
 		Scene_W4_RefrenceScene(Scene_W4_RefrenceScene&&) noexcept = delete;
@@ -202,7 +247,7 @@ namespace dae
 	{
 	public:
 		Scene_W4_BunnyScene() = default;
-		~Scene_W4_BunnyScene() override = default;
+		~Scene_W4_BunnyScene() override { WaitForPreload(); }
 
 		Scene_W4_BunnyScene(const Scene_W4_BunnyScene&) = delete;
 		Scene_W4_BunnyScene(Scene_W4_BunnyScene&&) noexcept = delete;
@@ -215,4 +260,58 @@ namespace dae
 	private:
 		TriangleMesh* pMesh{ nullptr };
 	};
+
+	class Scene_W5_AreaLightScene final : public Scene //soft shadows
+	{
+	public:
+		Scene_W5_AreaLightScene() = default;
+		~Scene_W5_AreaLightScene() override { WaitForPreload(); }
+
+		Scene_W5_AreaLightScene(const Scene_W5_AreaLightScene&) = delete;
+		Scene_W5_AreaLightScene(Scene_W5_AreaLightScene&&) noexcept = delete;
+		Scene_W5_AreaLightScene& operator=(const Scene_W5_AreaLightScene&) = delete;
+		Scene_W5_AreaLightScene& operator=(Scene_W5_AreaLightScene&&) noexcept = delete;
+
+		void Initialize() override;
+	};
+	//Procedural scene for scalability benchmarks, the same seed and settings always build the same scene
+	class Scene_Generated final : public Scene
+	{
+	public:
+		enum class Distribution
+		{
+			Uniform, //evenly spread over a cube that grows with the amount of objects
+			Clustered, //dense gaussian clumps with empty space in between
+			TeapotInStadium //everything packed in a tiny region in the middle of a huge, mostly empty scene
+		};
+
+		struct Settings
+		{
+			uint32_t seed{ 1 };
+			uint32_t amountOfSpheres{ 64 };
+			uint32_t amountOfMeshInstances{ 16 };
+			uint32_t trianglesPerMesh{ 192 }; //rounded to the nearest subdivided cube, at least 12
+			uint32_t amountOfLights{ 2 };
+			Distribution distribution{ Distribution::Uniform };
+		};
+
+		explicit Scene_Generated(const Settings& settings);
+		~Scene_Generated() override { WaitForPreload(); }
+
+		Scene_Generated(const Scene_Generated&) = delete;
+		Scene_Generated(Scene_Generated&&) noexcept = delete;
+		Scene_Generated& operator=(const Scene_Generated&) = delete;
+		Scene_Generated& operator=(Scene_Generated&&) noexcept = delete;
+
+		void Initialize() override;
+
+		uint64_t GetAmountOfTriangles() const;
+		//Bytes held by the geometry containers, including every instance's transformed copy
+		size_t GetGeometryBytes() const;
+
+		static bool ParseDistribution(const std::string& name, Distribution& distribution);
+
+	private:
+		Settings m_Settings{};
+	};
 }
@@ -0,0 +1,491 @@
+#include "SceneFile.h"
+#include "AssetCache.h"
+#include "Material.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace dae;
+
+namespace
+{
+	std::istream& operator>>(std::istream& stream, Vector3& v)
+	{
+		return stream >> v.x >> v.y >> v.z;
+	}
+
+	std::istream& operator>>(std::istream& stream, ColorRGB& c)
+	{
+		return stream >> c.r >> c.g >> c.b;
+	}
+}
+
+Scene_File::Scene_File(const std::string& filename) :
+	m_Filename{ filename }
+{
+}
+
+Scene_File::~Scene_File()
+{
+	WaitForPreload();
+	m_SceneReload = {}; //waits for a reload that's still loading, without swapping it in
+	WaitForMeshes();
+}
+
+void Scene_File::Initialize()
+{
+	sceneName = std::filesystem::path(m_Filename).stem().string();
+	Load();
+	WatchFiles();
+}
+
+void Scene_File::Update(Timer* pTimer)
+{
+	Scene::Update(pTimer);
+
+	//Swap in every mesh that finished loading since last frame
+	for (size_t i{ 0 }; i < m_PendingMeshes.size();)
+	{
+		if (m_PendingMeshes[i].data.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			ApplyMesh(m_PendingMeshes[i]);
+			++m_GeometryVersion;
+			m_PendingMeshes[i] = std::move(m_PendingMeshes.back());
+			m_PendingMeshes.pop_back();
+		}
+		else ++i;
+	}
+
+	if (m_IsHotReloadEnabled)
+		UpdateHotReload();
+}
+
+void Scene_File::Load()
+{
+	std::ifstream file(m_Filename);
+	if (!file)
+	{
+		std::cout << "Scene file " << m_Filename << " could not be opened" << std::endl;
+		return;
+	}
+	m_IsValid = true;
+
+	std::string line{};
+	int lineNumber{ 0 };
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+		if (!ParseLine(line))
+			std::cout << m_Filename << "(" << lineNumber << "): ignored \"" << line << "\"" << std::endl;
+	}
+}
+
+void Scene_File::WatchFiles()
+{
+	m_FileWatcher.Clear();
+
+	//Watched even when it can't be opened, so fixing the path picks it up
+	m_FileWatcher.Watch(m_Filename);
+	for (const auto& [meshFilename, meshIndices] : m_MeshUsers)
+		m_FileWatcher.Watch(meshFilename);
+	for (const std::string& meshFilename : m_ClusteredMeshFiles)
+		m_FileWatcher.Watch(meshFilename);
+}
+
+void Scene_File::Reload()
+{
+	//One at a time, an edit made while it's loading reloads again once it's swapped in
+	if (m_SceneReload.valid())
+	{
+		m_IsReloadQueued = true;
+		return;
+	}
+
+	//Parsed, and clustered meshes built, into a scene of its own on a worker thread; Update swaps it in between frames.
+	//The meshes in use keep their data cached meanwhile, so unchanged OBJs aren't parsed again
+	std::cout << "Reloading " << m_Filename << std::endl;
+	m_SceneReload = std::async(std::launch::async, [filename = m_Filename]
+		{
+			auto pScene = std::make_unique<Scene_File>(filename);
+			pScene->Load();
+			return pScene;
+		});
+}
+
+void Scene_File::ApplyReload(Scene_File& loaded)
+{
+	++m_Generation;
+	++m_GeometryVersion;
+
+	//Loads that are still running can't be cancelled, they finish in the background
+	for (PendingMesh& pendingMesh : m_PendingMeshes)
+		m_DiscardedLoads.emplace_back(std::move(pendingMesh.data));
+
+	m_SphereGeometries = std::move(loaded.m_SphereGeometries);
+	m_PlaneGeometries = std::move(loaded.m_PlaneGeometries);
+	m_TriangleMeshGeometries = std::move(loaded.m_TriangleMeshGeometries);
+	m_ClusteredMeshes = std::move(loaded.m_ClusteredMeshes);
+	m_Lights = std::move(loaded.m_Lights);
+	m_Materials = std::move(loaded.m_Materials);
+	m_MaterialHandles = std::move(loaded.m_MaterialHandles);
+	m_MaterialNames = std::move(loaded.m_MaterialNames);
+	m_PendingMeshes = std::move(loaded.m_PendingMeshes);
+	m_MeshUsers = std::move(loaded.m_MeshUsers);
+	m_ClusteredMeshFiles = std::move(loaded.m_ClusteredMeshFiles);
+	m_GeometryBudget = loaded.m_GeometryBudget;
+	m_IsValid = loaded.m_IsValid;
+
+	//Keep looking from where the user navigated to
+	m_Camera.fovAngle = loaded.m_Camera.fovAngle;
+
+	WatchFiles();
+	std::cout << "Reloaded " << m_Filename << std::endl;
+
+	if (m_IsReloadQueued)
+	{
+		m_IsReloadQueued = false;
+		Reload();
+	}
+
+	//Edited while the scene was loading, the new scene may have picked up their old data
+	for (const std::string& meshFilename : m_MeshesChangedDuringReload)
+		ReloadMesh(meshFilename);
+	m_MeshesChangedDuringReload.clear();
+}
+
+void Scene_File::ReloadMesh(const std::string& meshFilename)
+{
+	const auto it = m_MeshUsers.find(meshFilename);
+	if (it == m_MeshUsers.end())
+		return;
+
+	//Only the placement is copied, the new geometry is transformed on the worker thread
+	std::vector<std::pair<size_t, TriangleMesh>> meshes{};
+	for (const size_t meshIndex : it->second)
+	{
+		const TriangleMesh& current = m_TriangleMeshGeometries[meshIndex];
+
+		TriangleMesh mesh{};
+		mesh.materialIndex = current.materialIndex;
+		mesh.cullMode = current.cullMode;
+		mesh.rotationTransform = current.rotationTransform;
+		mesh.translationTransform = current.translationTransform;
+		mesh.scaleTransform = current.scaleTransform;
+		meshes.emplace_back(meshIndex, std::move(mesh));
+	}
+
+	m_MeshReloads.emplace_back(std::async(std::launch::async,
+		[meshFilename, generation = m_Generation, meshes = std::move(meshes)]() mutable
+		{
+			ReloadedMeshes reloaded{ generation };
+
+			const std::shared_ptr<const MeshData> pData = AssetCache::ReloadMesh(meshFilename);
+			if (!pData)
+			{
+				std::cout << meshFilename << " could not be reloaded" << std::endl;
+				return reloaded;
+			}
+
+			for (auto& [meshIndex, mesh] : meshes)
+			{
+				mesh.SetSharedData(pData);
+				mesh.UpdateTransforms();
+			}
+			reloaded.meshes = std::move(meshes);
+			return reloaded;
+		}));
+}
+
+void Scene_File::UpdateHotReload()
+{
+	const auto isReady = [](const auto& future)
+		{
+			return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		};
+
+	std::erase_if(m_DiscardedLoads, isReady);
+
+	//Rebuilt meshes and scenes replace the old ones between frames, Render only ever sees complete ones
+	for (size_t i{ 0 }; i < m_MeshReloads.size();)
+	{
+		if (!isReady(m_MeshReloads[i]))
+		{
+			++i;
+			continue;
+		}
+
+		ReloadedMeshes reloaded = m_MeshReloads[i].get();
+		if (reloaded.generation == m_Generation)
+		{
+			for (auto& [meshIndex, mesh] : reloaded.meshes)
+				m_TriangleMeshGeometries[meshIndex] = std::move(mesh);
+			++m_GeometryVersion;
+		}
+
+		m_MeshReloads[i] = std::move(m_MeshReloads.back());
+		m_MeshReloads.pop_back();
+	}
+
+	//Polled before a finished scene reload is swapped in, which watches its own files from then on
+	for (const std::string& filename : m_FileWatcher.Poll())
+	{
+		//Clustered meshes are rebuilt by reloading the scene that places them
+		if (filename == m_Filename || m_ClusteredMeshFiles.contains(filename))
+			Reload();
+		else if (m_SceneReload.valid())
+			m_MeshesChangedDuringReload.insert(filename);
+		else
+		{
+			std::cout << "Reloading " << filename << std::endl;
+			ReloadMesh(filename);
+		}
+	}
+
+	if (m_SceneReload.valid() && isReady(m_SceneReload))
+		ApplyReload(*m_SceneReload.get());
+}
+
+void Scene_File::WaitForMeshes()
+{
+	if (m_SceneReload.valid())
+		ApplyReload(*m_SceneReload.get());
+
+	for (PendingMesh& pendingMesh : m_PendingMeshes)
+		ApplyMesh(pendingMesh);
+
+	m_PendingMeshes.clear();
+}
+
+void Scene_File::ApplyMesh(PendingMesh& pendingMesh)
+{
+	std::shared_ptr<const MeshData> pData = pendingMesh.data.get();
+	if (!pData)
+		std::cout << pendingMesh.filename << " could not be loaded" << std::endl;
+
+	TriangleMesh& mesh = m_TriangleMeshGeometries[pendingMesh.meshIndex];
+	mesh.SetSharedData(std::move(pData));
+	mesh.UpdateTransforms();
+}
+
+bool Scene_File::ParseLine(const std::string& line)
+{
+	std::istringstream stream{ line };
+	std::string command{};
+	if (!(stream >> command) || command[0] == '#')
+		return true;
+
+	const auto findMaterial = [this](const std::string& name, unsigned char& materialIndex)
+		{
+			const auto it = m_MaterialNames.find(name);
+			if (it == m_MaterialNames.end())
+				return false;
+
+			materialIndex = it->second;
+			return true;
+		};
+
+	if (command == "camera")
+	{
+		//camera <origin> <fov> [<yaw> <pitch>], angles in degrees
+		Vector3 origin{};
+		float fovAngle{};
+		if (!(stream >> origin >> fovAngle))
+			return false;
+
+		m_Camera.origin = origin;
+		m_Camera.fovAngle = fovAngle;
+
+		float yaw{}, pitch{};
+		if (stream >> yaw >> pitch)
+		{
+			m_Camera.totalYaw = yaw * TO_RADIANS;
+			m_Camera.totalPitch = pitch * TO_RADIANS;
+		}
+		return true;
+	}
+
+	if (command == "material")
+	{
+		//material <name> <type> <parameters>
+		std::string name{}, type{};
+		ColorRGB color{};
+		if (!(stream >> name >> type >> color))
+			return false;
+
+		std::shared_ptr<Material> pMaterial{};
+		float p0{}, p1{}, p2{};
+		if (type == "solid")
+			pMaterial = AssetCache::GetMaterial<Material_SolidColor>(color);
+		else if (type == "lambert" && stream >> p0)
+			pMaterial = AssetCache::GetMaterial<Material_Lambert>(color, p0);
+		else if (type == "lambertphong" && stream >> p0 >> p1 >> p2)
+			pMaterial = AssetCache::GetMaterial<Material_LambertPhong>(color, p0, p1, p2);
+		else if (type == "cooktorrence" && stream >> p0 >> p1)
+			pMaterial = AssetCache::GetMaterial<Material_CookTorrence>(color, p0, p1);
+
+		if (!pMaterial || m_Materials.size() > UINT8_MAX)
+			return false;
+
+		m_MaterialNames[name] = AddMaterial(std::move(pMaterial));
+		return true;
+	}
+
+	if (command == "sphere")
+	{
+		//sphere <origin> <radius> <material>
+		Vector3 origin{};
+		float radius{};
+		std::string material{};
+		unsigned char materialIndex{};
+		if (!(stream >> origin >> radius >> material) || !findMaterial(material, materialIndex))
+			return false;
+
+		AddSphere(origin, radius, materialIndex);
+		return true;
+	}
+
+	if (command == "plane")
+	{
+		//plane <origin> <normal> <material>
+		Vector3 origin{}, normal{};
+		std::string material{};
+		unsigned char materialIndex{};
+		if (!(stream >> origin >> normal >> material) || !findMaterial(material, materialIndex))
+			return false;
+
+		AddPlane(origin, normal.Normalized(), materialIndex);
+		return true;
+	}
+
+	if (command == "mesh" || command == "clusteredmesh")
+	{
+		//mesh <obj file> <material> [cull back|front|none] [translate <v>] [rotate <v>] [scale <v>], rotation in degrees
+		//clusteredmesh takes the same arguments but streams the geometry in from disk as rays need it
+		std::string path{}, material{};
+		unsigned char materialIndex{};
+		if (!(stream >> path >> material) || !findMaterial(material, materialIndex))
+			return false;
+
+		TriangleCullMode cullMode{ TriangleCullMode::BackFaceCulling };
+		Vector3 translation{}, rotation{}, scale{ 1.f, 1.f, 1.f };
+		std::string option{};
+		while (stream >> option)
+		{
+			if (option == "cull")
+			{
+				std::string mode{};
+				stream >> mode;
+				if (mode == "back") cullMode = TriangleCullMode::BackFaceCulling;
+				else if (mode == "front") cullMode = TriangleCullMode::FrontFaceCulling;
+				else if (mode == "none") cullMode = TriangleCullMode::NoCulling;
+				else return false;
+			}
+			else if (option == "translate") stream >> translation;
+			else if (option == "rotate") stream >> rotation;
+			else if (option == "scale") stream >> scale;
+			else return false;
+
+			if (!stream)
+				return false;
+		}
+
+		//Relative to the scene file
+		const std::string meshFilename = (std::filesystem::path(m_Filename).parent_path() / path).string();
+
+		if (command == "clusteredmesh")
+		{
+			//Same transform order as TriangleMesh, baked into the cluster file
+			const Matrix transform = Matrix::CreateScale(scale) * Matrix::CreateRotation(rotation * TO_RADIANS) * Matrix::CreateTranslation(translation);
+			const std::string clusterFilename = meshFilename + ".clusters";
+			m_ClusteredMeshFiles.insert(meshFilename);
+			return ClusteredMesh::Build(meshFilename, clusterFilename, transform)
+				&& AddClusteredMesh(clusterFilename, cullMode, materialIndex) != nullptr;
+		}
+
+		TriangleMesh* pMesh = AddTriangleMesh(cullMode, materialIndex);
+		pMesh->Translate(translation);
+		pMesh->rotationTransform = Matrix::CreateRotation(rotation * TO_RADIANS);
+		pMesh->Scale(scale);
+
+		const size_t meshIndex = m_TriangleMeshGeometries.size() - 1;
+		m_MeshUsers[meshFilename].emplace_back(meshIndex);
+
+		//Already loaded (by another scene, or before a reload), no need to wait for Update
+		if (std::shared_ptr<const MeshData> pData = AssetCache::FindMesh(meshFilename))
+		{
+			pMesh->SetSharedData(std::move(pData));
+			pMesh->UpdateTransforms();
+			return true;
+		}
+
+		//Loaded on a worker thread and swapped in by Update
+		m_PendingMeshes.emplace_back(PendingMesh{ meshIndex, meshFilename,
+			std::async(std::launch::async, AssetCache::GetMesh, meshFilename) });
+		return true;
+	}
+
+	if (command == "geometrybudget")
+	{
+		//geometrybudget <megabytes>, memory clustered meshes may keep resident
+		float megabytes{};
+		if (!(stream >> megabytes) || megabytes <= 0.f)
+			return false;
+
+		SetGeometryBudget(static_cast<size_t>(megabytes * 1024.f * 1024.f));
+		return true;
+	}
+
+	//Lights: <type> <parameters> <intensity> <color>
+	if (command == "pointlight")
+	{
+		Vector3 origin{};
+		float intensity{};
+		ColorRGB color{};
+		if (!(stream >> origin >> intensity >> color))
+			return false;
+
+		AddPointLight(origin, intensity, color);
+		return true;
+	}
+
+	if (command == "directionallight")
+	{
+		Vector3 direction{};
+		float intensity{};
+		ColorRGB color{};
+		if (!(stream >> direction >> intensity >> color))
+			return false;
+
+		AddDirectionalLight(direction.Normalized(), intensity, color);
+		return true;
+	}
+
+	if (command == "spherelight")
+	{
+		Vector3 origin{};
+		float radius{}, intensity{};
+		ColorRGB color{};
+		if (!(stream >> origin >> radius >> intensity >> color))
+			return false;
+
+		AddSphereLight(origin, radius, intensity, color);
+		return true;
+	}
+
+	if (command == "rectlight")
+	{
+		Vector3 origin{}, halfExtentU{}, halfExtentV{};
+		float intensity{};
+		ColorRGB color{};
+		if (!(stream >> origin >> halfExtentU >> halfExtentV >> intensity >> color))
+			return false;
+
+		AddRectLight(origin, halfExtentU, halfExtentV, intensity, color);
+		return true;
+	}
+
+	return false;
+}
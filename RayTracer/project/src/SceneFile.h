@@ -0,0 +1,92 @@
+#pragma once
+
+//Standard includes
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//Project includes
+#include "FileWatcher.h"
+#include "Scene.h"
+
+namespace dae
+{
+	/**
+	 * \brief Scene described by a text file, see resources/bunny.scene for the format.
+	 * Meshes are loaded in parallel on worker threads and streamed in by Update, so the rest of the
+	 * scene renders while they're still arriving.
+	 * The scene file and its meshes are watched: an edited OBJ is parsed again in the background and swapped in
+	 * by Update, an edited scene file is loaded again in the background (clustered meshes rebuilt) and swapped in
+	 * whole by Update, keeping the camera where it is.
+	 */
+	class Scene_File final : public Scene
+	{
+	public:
+		explicit Scene_File(const std::string& filename);
+		~Scene_File() override;
+
+		Scene_File(const Scene_File&) = delete;
+		Scene_File(Scene_File&&) noexcept = delete;
+		Scene_File& operator=(const Scene_File&) = delete;
+		Scene_File& operator=(Scene_File&&) noexcept = delete;
+
+		void Initialize() override;
+		void Update(Timer* pTimer) override;
+
+		//False when the file couldn't be opened, lines that fail to parse are reported and skipped
+		bool IsValid() const { return m_IsValid; }
+		//Meshes still being loaded
+		size_t GetAmountOfPendingMeshes() const { return m_PendingMeshes.size(); }
+		//Blocks until every mesh (and a scene reload that's running) arrived, for offline renders that can't show a partial scene
+		void WaitForMeshes();
+		void WaitForContent() override { WaitForMeshes(); }
+
+		void SetHotReload(bool isEnabled) { m_IsHotReloadEnabled = isEnabled; }
+
+	private:
+		struct PendingMesh
+		{
+			size_t meshIndex{};
+			std::string filename{};
+			std::future<std::shared_ptr<const MeshData>> data{};
+		};
+
+		//Meshes rebuilt from an edited OBJ, ready to replace the ones at their index
+		struct ReloadedMeshes
+		{
+			uint32_t generation{};
+			std::vector<std::pair<size_t, TriangleMesh>> meshes{};
+		};
+
+		std::string m_Filename{};
+		bool m_IsValid{ false };
+
+		std::unordered_map<std::string, unsigned char> m_MaterialNames{};
+		std::vector<PendingMesh> m_PendingMeshes{};
+
+		//Hot reload
+		bool m_IsHotReloadEnabled{ true };
+		FileWatcher m_FileWatcher{};
+		uint32_t m_Generation{ 0 }; //advanced by every scene reload, older mesh reloads are dropped
+		std::unordered_map<std::string, std::vector<size_t>> m_MeshUsers{}; //OBJ -> indices in m_TriangleMeshGeometries
+		std::unordered_set<std::string> m_ClusteredMeshFiles{};
+		std::vector<std::future<ReloadedMeshes>> m_MeshReloads{};
+		std::vector<std::future<std::shared_ptr<const MeshData>>> m_DiscardedLoads{}; //loads of a previous generation
+		std::future<std::unique_ptr<Scene_File>> m_SceneReload{};
+		bool m_IsReloadQueued{ false }; //the scene file changed again while it was reloading
+		std::unordered_set<std::string> m_MeshesChangedDuringReload{};
+
+		void Load();
+		void WatchFiles();
+		void Reload();
+		void ApplyReload(Scene_File& loaded);
+		void ReloadMesh(const std::string& meshFilename);
+		void UpdateHotReload();
+
+		bool ParseLine(const std::string& line);
+		void ApplyMesh(PendingMesh& pendingMesh);
+	};
+}
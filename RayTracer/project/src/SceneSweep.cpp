@@ -0,0 +1,100 @@
+#include "SceneSweep.h"
+#include "Renderer.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <fstream>
+#include <unistd.h>
+#endif
+
+using namespace dae;
+
+SceneSweep::SceneSweep(const Settings& settings) :
+	m_Settings{ settings }
+{
+}
+
+void SceneSweep::Run(std::ostream& output)
+{
+	using Clock = std::chrono::steady_clock;
+	const auto milliseconds = [](Clock::time_point start) { return std::chrono::duration<float, std::milli>(Clock::now() - start).count(); };
+
+	const char* dimensionNames[]{ "spheres", "mesh instances", "triangles per mesh", "lights" };
+	output << dimensionNames[static_cast<int>(m_Settings.dimension)] << ",triangles,geometry MB,resident MB,build ms,trace ms,Mrays/s" << std::endl;
+
+	//Triangles per mesh start at the smallest rock, a plain cube
+	const uint32_t firstCount = m_Settings.dimension == Dimension::Triangles ? 12u : 1u;
+	for (uint64_t count{ firstCount }; count <= m_Settings.maxCount; count *= 4)
+	{
+		Scene_Generated::Settings sceneSettings = m_Settings.scene;
+		switch (m_Settings.dimension)
+		{
+		case Dimension::Spheres: sceneSettings.amountOfSpheres = static_cast<uint32_t>(count); break;
+		case Dimension::MeshInstances: sceneSettings.amountOfMeshInstances = static_cast<uint32_t>(count); break;
+		case Dimension::Triangles: sceneSettings.trianglesPerMesh = static_cast<uint32_t>(count); break;
+		case Dimension::Lights: sceneSettings.amountOfLights = static_cast<uint32_t>(count); break;
+		}
+
+		const auto start = Clock::now();
+		const auto pScene = std::make_unique<Scene_Generated>(sceneSettings);
+		pScene->Activate();
+		pScene->GetCamera().isInputEnabled = false;
+		const float buildMs = milliseconds(start);
+
+		Renderer renderer{ m_Settings.width, m_Settings.height };
+		Timer timer{};
+		timer.SetFixedTime(0.f, 0.f);
+		pScene->Update(&timer);
+		renderer.Render(pScene.get());
+		const Renderer::FrameStats& stats = renderer.GetFrameStats();
+
+		const size_t residentBytes = GetResidentBytes();
+		output << count << "," << pScene->GetAmountOfTriangles()
+			<< "," << pScene->GetGeometryBytes() / float(1 << 20) << "," << residentBytes / float(1 << 20)
+			<< "," << buildMs << "," << stats.traceMs << "," << stats.rays.GetAmountOfRays() / (std::max(stats.traceMs, 1e-3f) * 1000.f) << std::endl;
+
+		//Every step is about 4 times bigger than the last one
+		if (milliseconds(start) * 4.f > m_Settings.timeLimit * 1000.f || residentBytes * 4 > m_Settings.memoryLimit)
+		{
+			output << "stopped, the next step would exceed the " << (residentBytes * 4 > m_Settings.memoryLimit ? "memory" : "time") << " limit" << std::endl;
+			break;
+		}
+	}
+}
+
+bool SceneSweep::ParseDimension(const std::string& name, Dimension& dimension)
+{
+	if (name == "spheres") dimension = Dimension::Spheres;
+	else if (name == "meshes") dimension = Dimension::MeshInstances;
+	else if (name == "triangles") dimension = Dimension::Triangles;
+	else if (name == "lights") dimension = Dimension::Lights;
+	else return false;
+	return true;
+}
+
+size_t SceneSweep::GetResidentBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.WorkingSetSize;
+	return 0;
+#elif defined(__linux__)
+	//Second field of statm is the resident size in pages
+	std::ifstream statm{ "/proc/self/statm" };
+	size_t totalPages{}, residentPages{};
+	if (statm >> totalPages >> residentPages)
+		return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return 0;
+#else
+	return 0;
+#endif
+}
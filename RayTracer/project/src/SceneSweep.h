@@ -0,0 +1,58 @@
+#pragma once
+
+//Standard includes
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+//Project includes
+#include "Scene.h"
+
+namespace dae
+{
+	/**
+	 * \brief Scalability benchmark: renders generated scenes while one dimension (spheres, mesh instances, triangles
+	 * per mesh or lights) grows by 4x per step, and reports rays/sec and memory for each step as CSV.
+	 * Stops at the maximum count, or before a step that would blow the time or memory limit.
+	 */
+	class SceneSweep final
+	{
+	public:
+		enum class Dimension
+		{
+			Spheres,
+			MeshInstances,
+			Triangles,
+			Lights
+		};
+
+		struct Settings
+		{
+			Dimension dimension{ Dimension::Spheres };
+			Scene_Generated::Settings scene{}; //the swept dimension is overwritten every step
+			uint32_t maxCount{ 1u << 20 };
+			float timeLimit{ 60.f }; //seconds one step may take
+			size_t memoryLimit{ 4096ull << 20 }; //bytes
+			int width{ 160 };
+			int height{ 120 };
+		};
+
+		explicit SceneSweep(const Settings& settings);
+		~SceneSweep() = default;
+
+		SceneSweep(const SceneSweep&) = delete;
+		SceneSweep(SceneSweep&&) noexcept = delete;
+		SceneSweep& operator=(const SceneSweep&) = delete;
+		SceneSweep& operator=(SceneSweep&&) noexcept = delete;
+
+		void Run(std::ostream& output);
+
+		static bool ParseDimension(const std::string& name, Dimension& dimension);
+		//Resident set size of this process, 0 where it can't be read
+		static size_t GetResidentBytes();
+
+	private:
+		Settings m_Settings{};
+	};
+}
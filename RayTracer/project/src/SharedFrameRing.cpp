@@ -0,0 +1,193 @@
+#include "SharedFrameRing.h"
+
+#include <chrono>
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace dae;
+
+//Other processes rely on these, the layout may only change with m_Version
+static_assert(sizeof(SharedFrameRing::RingHeader) == 64 && sizeof(SharedFrameRing::SlotHeader) == 64);
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "a lock in shared memory wouldn't be shared");
+
+SharedFrameRing::~SharedFrameRing()
+{
+	Close();
+}
+
+uint64_t SharedFrameRing::GetTimeNs()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+SharedFrameRing::SlotHeader* SharedFrameRing::GetSlot(uint64_t frameNumber) const
+{
+	const RingHeader* pHeader = GetHeader();
+	uint8_t* pSlot = static_cast<uint8_t*>(m_pMemory) + pHeader->headerSize + ((frameNumber - 1) % pHeader->slotCount) * pHeader->slotStride;
+	return reinterpret_cast<SlotHeader*>(pSlot);
+}
+
+uint64_t SharedFrameRing::GetLatestFrame() const
+{
+	return m_pMemory ? GetHeader()->latestFrame.load(std::memory_order_acquire) : 0;
+}
+
+bool SharedFrameRing::Publish(const uint32_t* pPixels, uint32_t width, uint32_t height, int redShift, int greenShift, int blueShift, float renderMs)
+{
+	RingHeader* pHeader = GetHeader();
+	if (!pHeader || !m_IsOwner || width > pHeader->maxWidth || height > pHeader->maxHeight)
+		return false;
+
+	const uint64_t frameNumber = m_NextFrame++;
+	SlotHeader* pSlot = GetSlot(frameNumber);
+
+	//Odd: readers that started on the previous frame in this slot will see the version change and drop their read
+	const uint64_t sequence = pSlot->sequence.load(std::memory_order_relaxed);
+	pSlot->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	pSlot->frameNumber = frameNumber;
+	pSlot->timestampNs = GetTimeNs();
+	pSlot->renderMs = renderMs;
+	pSlot->width = width;
+	pSlot->height = height;
+	pSlot->stride = width * sizeof(uint32_t);
+	pSlot->redShift = static_cast<uint8_t>(redShift);
+	pSlot->greenShift = static_cast<uint8_t>(greenShift);
+	pSlot->blueShift = static_cast<uint8_t>(blueShift);
+	pSlot->alphaShift = static_cast<uint8_t>(48 - redShift - greenShift - blueShift); //the byte that's left
+	std::memcpy(reinterpret_cast<uint8_t*>(pSlot) + sizeof(SlotHeader), pPixels, static_cast<size_t>(width) * height * sizeof(uint32_t));
+
+	pSlot->sequence.store(sequence + 2, std::memory_order_release);
+	pHeader->latestFrame.store(frameNumber, std::memory_order_release);
+	return true;
+}
+
+bool SharedFrameRing::ReadLatest(const std::function<void(const FrameInfo& info, const uint32_t* pPixels)>& read) const
+{
+	const uint64_t frameNumber = GetLatestFrame();
+	if (frameNumber == 0)
+		return false;
+
+	const SlotHeader* pSlot = GetSlot(frameNumber);
+	const uint64_t sequence = pSlot->sequence.load(std::memory_order_acquire);
+	if (sequence & 1)
+		return false;
+
+	FrameInfo info{};
+	info.frameNumber = pSlot->frameNumber;
+	info.timestampNs = pSlot->timestampNs;
+	info.renderMs = pSlot->renderMs;
+	info.width = pSlot->width;
+	info.height = pSlot->height;
+	info.stride = pSlot->stride;
+	info.redShift = pSlot->redShift;
+	info.greenShift = pSlot->greenShift;
+	info.blueShift = pSlot->blueShift;
+	if (info.frameNumber != frameNumber || info.width > GetHeader()->maxWidth || info.height > GetHeader()->maxHeight)
+		return false;
+
+	read(info, reinterpret_cast<const uint32_t*>(pSlot + 1));
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return pSlot->sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+#if defined(_WIN32)
+bool SharedFrameRing::Create(const std::string&, uint32_t, uint32_t, uint32_t)
+{
+	return false;
+}
+
+bool SharedFrameRing::Open(const std::string&)
+{
+	return false;
+}
+
+void SharedFrameRing::Close()
+{
+}
+#else
+bool SharedFrameRing::Create(const std::string& name, uint32_t maxWidth, uint32_t maxHeight, uint32_t slotCount)
+{
+	Close();
+	if (slotCount == 0)
+		return false;
+
+	//Shared memory names start with a slash
+	m_Name = name.empty() || name[0] != '/' ? "/" + name : name;
+	const uint64_t slotStride = sizeof(SlotHeader) + ((static_cast<uint64_t>(maxWidth) * maxHeight * sizeof(uint32_t) + 63) & ~uint64_t{ 63 });
+	m_Size = sizeof(RingHeader) + slotCount * slotStride;
+
+	shm_unlink(m_Name.c_str()); //a ring left behind by a crash may have another size
+	const int file = shm_open(m_Name.c_str(), O_CREAT | O_RDWR | O_EXCL, 0644);
+	if (file < 0)
+		return false;
+	void* pMemory = ftruncate(file, static_cast<off_t>(m_Size)) == 0 ? mmap(nullptr, m_Size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+	close(file);
+	if (pMemory == MAP_FAILED)
+	{
+		shm_unlink(m_Name.c_str());
+		return false;
+	}
+
+	m_pMemory = pMemory;
+	m_IsOwner = true;
+	m_NextFrame = 1;
+
+	//The object starts zeroed, every slot's sequence is 0 and latestFrame says there's nothing yet
+	RingHeader* pHeader = GetHeader();
+	pHeader->slotCount = slotCount;
+	pHeader->headerSize = sizeof(RingHeader);
+	pHeader->slotStride = slotStride;
+	pHeader->maxWidth = maxWidth;
+	pHeader->maxHeight = maxHeight;
+	pHeader->version = m_Version;
+	std::atomic_thread_fence(std::memory_order_release);
+	pHeader->magic = m_Magic; //last, a reader that sees it sees the rest
+	return true;
+}
+
+bool SharedFrameRing::Open(const std::string& name)
+{
+	Close();
+	m_Name = name.empty() || name[0] != '/' ? "/" + name : name;
+	const int file = shm_open(m_Name.c_str(), O_RDONLY, 0);
+	if (file < 0)
+		return false;
+
+	struct stat status{};
+	void* pMemory = fstat(file, &status) == 0 && static_cast<size_t>(status.st_size) >= sizeof(RingHeader)
+		? mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0) : MAP_FAILED;
+	close(file);
+	if (pMemory == MAP_FAILED)
+		return false;
+
+	m_pMemory = pMemory;
+	m_Size = static_cast<size_t>(status.st_size);
+	const RingHeader* pHeader = GetHeader();
+	const bool isValid = pHeader->magic == m_Magic && pHeader->version == m_Version && pHeader->slotCount > 0
+		&& pHeader->headerSize + pHeader->slotCount * pHeader->slotStride <= m_Size;
+	if (!isValid)
+		Close();
+	return isValid;
+}
+
+void SharedFrameRing::Close()
+{
+	if (m_pMemory)
+		munmap(m_pMemory, m_Size);
+	//Readers keep their mapping, the name is gone so the next writer starts clean
+	if (m_IsOwner)
+		shm_unlink(m_Name.c_str());
+	m_pMemory = nullptr;
+	m_Size = 0;
+	m_IsOwner = false;
+}
+#endif
@@ -0,0 +1,101 @@
+#pragma once
+
+//Standard includes
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace dae
+{
+	/**
+	 * \brief Finished frames in a POSIX shared memory ring, for viewers, dashboards and encoders in other processes.
+	 * The renderer copies every frame into the next slot and never waits for a reader. A slot is guarded by a seqlock:
+	 * its version is odd while it's written, a reader looks at the pixels where they are and checks afterwards that the
+	 * version didn't change. With the default 3 slots a reader has two frame times to finish before its slot is reused.
+	 *
+	 * Layout, host byte order, for readers in any language:
+	 *   RingHeader at offset 0, then slotCount slots of slotStride bytes, each a SlotHeader followed by the pixels.
+	 *   Frame N (counting from 1) is in slot (N - 1) % slotCount; latestFrame is 0 until the first frame is published.
+	 *   Pixels are rows of width 32 bit values, stride bytes apart, channels at the red/green/blue shifts.
+	 */
+	class SharedFrameRing final
+	{
+	public:
+		static constexpr uint32_t m_Magic{ 0x52465452 }; //"RTFR"
+		static constexpr uint32_t m_Version{ 1 };
+
+		struct RingHeader
+		{
+			uint32_t magic{};
+			uint32_t version{};
+			uint32_t slotCount{};
+			uint32_t headerSize{}; //bytes before the first slot, sizeof(RingHeader)
+			uint64_t slotStride{}; //bytes from one slot to the next, SlotHeader included
+			uint32_t maxWidth{};
+			uint32_t maxHeight{};
+			std::atomic<uint64_t> latestFrame{}; //number of the last frame that was completely written
+			uint8_t padding[24]{};
+		};
+
+		struct SlotHeader
+		{
+			std::atomic<uint64_t> sequence{}; //seqlock, odd while the writer is in this slot
+			uint64_t frameNumber{};
+			uint64_t timestampNs{}; //steady clock (CLOCK_MONOTONIC on Linux) when the frame was published
+			float renderMs{}; //how long the renderer took for the frame
+			uint32_t width{};
+			uint32_t height{};
+			uint32_t stride{}; //bytes per row
+			uint8_t redShift{}, greenShift{}, blueShift{}, alphaShift{};
+			uint8_t padding[20]{};
+		};
+
+		//What a reader gets next to the pixels, a copy of the slot header
+		struct FrameInfo
+		{
+			uint64_t frameNumber{};
+			uint64_t timestampNs{};
+			float renderMs{};
+			uint32_t width{};
+			uint32_t height{};
+			uint32_t stride{};
+			int redShift{}, greenShift{}, blueShift{};
+		};
+
+		SharedFrameRing() = default;
+		~SharedFrameRing();
+
+		SharedFrameRing(const SharedFrameRing&) = delete;
+		SharedFrameRing(SharedFrameRing&&) noexcept = delete;
+		SharedFrameRing& operator=(const SharedFrameRing&) = delete;
+		SharedFrameRing& operator=(SharedFrameRing&&) noexcept = delete;
+
+		//Writer: creates (or replaces) the shared memory object /name, frames up to maxWidth x maxHeight fit
+		bool Create(const std::string& name, uint32_t maxWidth, uint32_t maxHeight, uint32_t slotCount = 3);
+		//Reader: maps an existing ring read only
+		bool Open(const std::string& name);
+		bool IsOpen() const { return m_pMemory != nullptr; }
+
+		//Copies the frame into the next slot, false when it's bigger than the ring was created for
+		bool Publish(const uint32_t* pPixels, uint32_t width, uint32_t height, int redShift, int greenShift, int blueShift, float renderMs);
+
+		uint64_t GetLatestFrame() const;
+		static uint64_t GetTimeNs();
+		//Zero copy: read gets the pixels in shared memory. False when there's no frame yet, or when the writer came
+		//back to the slot while read was busy, then whatever read did with the pixels has to be thrown away
+		bool ReadLatest(const std::function<void(const FrameInfo& info, const uint32_t* pPixels)>& read) const;
+
+	private:
+		std::string m_Name{};
+		void* m_pMemory{ nullptr };
+		size_t m_Size{ 0 };
+		bool m_IsOwner{ false }; //the writer unlinks the name when it's done
+		uint64_t m_NextFrame{ 1 };
+
+		RingHeader* GetHeader() const { return static_cast<RingHeader*>(m_pMemory); }
+		SlotHeader* GetSlot(uint64_t frameNumber) const;
+		void Close();
+	};
+}
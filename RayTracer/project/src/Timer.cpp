@@ -1,23 +1,46 @@
 #include "Timer.h"
 
-#include <iostream>
-#include <numeric>
-
 #include <iostream>
 #include <fstream>
 
+#if defined(RT_NO_SDL)
+#include <chrono>
+#else
 #include "SDL.h"
+#endif
+
 using namespace dae;
 
+namespace
+{
+	uint64_t GetPerformanceCounter()
+	{
+#if defined(RT_NO_SDL)
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#else
+		return SDL_GetPerformanceCounter();
+#endif
+	}
+
+	uint64_t GetPerformanceFrequency()
+	{
+#if defined(RT_NO_SDL)
+		return 1'000'000'000;
+#else
+		return SDL_GetPerformanceFrequency();
+#endif
+	}
+}
+
 Timer::Timer()
 {
-	const uint64_t countsPerSecond = SDL_GetPerformanceFrequency();
+	const uint64_t countsPerSecond = GetPerformanceFrequency();
 	m_SecondsPerCount = 1.0f / static_cast<float>(countsPerSecond);
 }
 
 void Timer::Reset()
 {
-	const uint64_t currentTime = SDL_GetPerformanceCounter();
+	const uint64_t currentTime = GetPerformanceCounter();
 
 	m_BaseTime = currentTime;
 	m_PreviousTime = currentTime;
@@ -29,7 +52,7 @@ void Timer::Reset()
 
 void Timer::Start()
 {
-	const uint64_t startTime = SDL_GetPerformanceCounter();
+	const uint64_t startTime = GetPerformanceCounter();
 
 	if (m_IsStopped)
 	{
@@ -41,7 +64,16 @@ void Timer::Start()
 	}
 }
 
-void Timer::StartBenchmark(int numFrames)
+void Timer::SetFixedTime(float totalTime, float elapsedTime)
+{
+	m_IsFixedTime = true;
+	m_TotalTime = totalTime;
+	m_ElapsedTime = elapsedTime;
+	m_dFPS = elapsedTime > 0.f ? 1.f / elapsedTime : 0.f;
+	m_FPS = static_cast<uint32_t>(m_dFPS);
+}
+
+void Timer::StartBenchmark(int numFrames, float maxSeconds, const std::string& filename)
 {
 	if (m_BenchmarkActive)
 	{
@@ -50,20 +82,36 @@ void Timer::StartBenchmark(int numFrames)
 	}
 
 	m_BenchmarkActive = true;
-
-	m_BenchmarkAvg = 0.f;
-	m_BenchmarkHigh = FLT_MIN;
-	m_BenchmarkLow = FLT_MAX;
-
 	m_BenchmarkFrames = numFrames;
-	m_BenchmarkCurrFrame = 0;
-
-	m_Benchmarks.clear();
-	m_Benchmarks.resize(m_BenchmarkFrames);
+	m_BenchmarkSeconds = maxSeconds;
+	m_BenchmarkElapsed = 0.f;
+	m_BenchmarkFilename = filename;
+	m_FrameTimes.Reset();
 
 	std::cout << "**BENCHMARK STARTED**\n";
 }
 
+void Timer::FinishBenchmark()
+{
+	m_BenchmarkActive = false;
+
+	//Averages hide stutters, the tail percentiles and the worst frame show them
+	const FrameTimeHistogram::Summary summary = m_FrameTimes.GetSummary();
+	std::cout << "**BENCHMARK FINISHED**\n";
+	std::cout << ">> FRAMES = " << summary.amountOfFrames << " in " << m_BenchmarkElapsed << " s" << std::endl;
+	std::cout << ">> AVG = " << summary.averageMs << " ms (stddev " << summary.standardDeviationMs << " ms)" << std::endl;
+	std::cout << ">> P50 = " << summary.p50Ms << " ms, P90 = " << summary.p90Ms << " ms, P99 = " << summary.p99Ms
+		<< " ms, P99.9 = " << summary.p999Ms << " ms" << std::endl;
+	std::cout << ">> WORST = " << summary.worstMs << " ms" << std::endl;
+
+	std::ofstream csvStream(m_BenchmarkFilename + ".csv");
+	FrameTimeHistogram::WriteCsvHeader(csvStream);
+	m_FrameTimes.WriteCsv(csvStream);
+
+	std::ofstream jsonStream(m_BenchmarkFilename + ".json");
+	m_FrameTimes.WriteJson(jsonStream);
+}
+
 void Timer::Update()
 {
 	if (m_IsStopped)
@@ -74,24 +122,28 @@ void Timer::Update()
 		return;
 	}
 
-	const uint64_t currentTime = SDL_GetPerformanceCounter();
+	const uint64_t currentTime = GetPerformanceCounter();
 	m_CurrentTime = currentTime;
 
-	m_ElapsedTime = (float)((m_CurrentTime - m_PreviousTime) * m_SecondsPerCount);
+	float frameTime = (float)((m_CurrentTime - m_PreviousTime) * m_SecondsPerCount);
 	m_PreviousTime = m_CurrentTime;
 
-	if (m_ElapsedTime < 0.0f)
-		m_ElapsedTime = 0.0f;
+	if (frameTime < 0.0f)
+		frameTime = 0.0f;
 
-	if (m_ForceElapsedUpperBound && m_ElapsedTime > m_ElapsedUpperBound)
+	//The real frame time, before it gets clamped for the simulation
+	m_FrameTimes.Record(frameTime);
+	if (m_BenchmarkActive)
 	{
-		m_ElapsedTime = m_ElapsedUpperBound;
+		m_BenchmarkElapsed += frameTime;
+		const bool isFrameLimitReached = m_BenchmarkFrames > 0 && m_FrameTimes.GetAmountOfFrames() >= static_cast<uint64_t>(m_BenchmarkFrames);
+		const bool isTimeLimitReached = m_BenchmarkSeconds > 0.f && m_BenchmarkElapsed >= m_BenchmarkSeconds;
+		if (isFrameLimitReached || isTimeLimitReached)
+			FinishBenchmark();
 	}
 
-	m_TotalTime = (float)(((m_CurrentTime - m_PausedTime) - m_BaseTime) * m_SecondsPerCount);
-
 	//FPS LOGIC
-	m_FPSTimer += m_ElapsedTime;
+	m_FPSTimer += frameTime;
 	++m_FPSCount;
 	if (m_FPSTimer >= 1.0f)
 	{
@@ -99,43 +151,26 @@ void Timer::Update()
 		m_FPS = m_FPSCount;
 		m_FPSCount = 0;
 		m_FPSTimer = 0.0f;
+	}
+
+	//A replay sets the simulated time itself, the clock only measured how long the frame took
+	if (m_IsFixedTime)
+		return;
 
-		if (m_BenchmarkActive)
-		{
-			m_Benchmarks[m_BenchmarkCurrFrame] = m_dFPS;
-
-			m_BenchmarkLow = std::min(m_BenchmarkLow, m_dFPS);
-			m_BenchmarkHigh = std::max(m_BenchmarkHigh, m_dFPS);
-
-			++m_BenchmarkCurrFrame;
-			if (m_BenchmarkCurrFrame >= m_BenchmarkFrames)
-			{
-				m_BenchmarkActive = false;
-				m_BenchmarkAvg = std::accumulate(m_Benchmarks.begin(), m_Benchmarks.end(), 0.f) / float(m_BenchmarkFrames);
-
-				//print
-				std::cout << "**BENCHMARK FINISHED**\n";
-				std::cout << ">> HIGH = " << m_BenchmarkHigh << std::endl;
-				std::cout << ">> LOW = " << m_BenchmarkLow << std::endl;
-				std::cout << ">> AVG = " << m_BenchmarkAvg << std::endl;
-
-				//file save
-				std::ofstream fileStream("benchmark.txt");
-				fileStream << "FRAMES = " << m_BenchmarkCurrFrame << std::endl;
-				fileStream << "HIGH = " << m_BenchmarkHigh << std::endl;
-				fileStream << "LOW = " << m_BenchmarkLow << std::endl;
-				fileStream << "AVG = " << m_BenchmarkAvg << std::endl;
-				fileStream.close();
-			}
-		}
+	m_ElapsedTime = frameTime;
+	if (m_ForceElapsedUpperBound && m_ElapsedTime > m_ElapsedUpperBound)
+	{
+		m_ElapsedTime = m_ElapsedUpperBound;
 	}
+
+	m_TotalTime = (float)(((m_CurrentTime - m_PausedTime) - m_BaseTime) * m_SecondsPerCount);
 }
 
 void Timer::Stop()
 {
 	if (!m_IsStopped)
 	{
-		const uint64_t currentTime = SDL_GetPerformanceCounter();
+		const uint64_t currentTime = GetPerformanceCounter();
 
 		m_StopTime = currentTime;
 		m_IsStopped = true;
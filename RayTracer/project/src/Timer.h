@@ -2,7 +2,10 @@
 
 //Standard includes
 #include <cstdint>
-#include <vector>
+#include <string>
+
+//Project includes
+#include "FrameTimeHistogram.h"
 
 namespace dae
 {
@@ -17,18 +20,26 @@ namespace dae
 		Timer& operator=(const Timer&) = delete;
 		Timer& operator=(Timer&&) noexcept = delete;
 
-		void StartBenchmark(int numFrames = 10);
+		//Times every frame until numFrames frames or maxSeconds have passed (0 = no limit), then prints the
+		//frame time percentiles and writes them to <filename>.csv and <filename>.json
+		void StartBenchmark(int numFrames = 1000, float maxSeconds = 0.f, const std::string& filename = "benchmark");
+		bool IsBenchmarkActive() const { return m_BenchmarkActive; }
 
 		void Reset();
 		void Start();
 		void Update();
 		void Stop();
+		//Offline rendering and replays: from now on Update leaves the simulated time alone, it only moves when this is
+		//called again. Update still measures the real frame times for the FPS and benchmarks.
+		void SetFixedTime(float totalTime, float elapsedTime);
 
 		uint32_t GetFPS() const { return m_FPS; };
 		float GetdFPS() const { return m_dFPS; };
 		float GetElapsed() const { return m_ElapsedTime; };
 		float GetTotal() const { return m_TotalTime; };
 		bool IsRunning() const { return !m_IsStopped; };
+		//Every real frame time since the last benchmark started (or since the timer was created)
+		const FrameTimeHistogram& GetFrameTimes() const { return m_FrameTimes; }
 
 	private:
 		uint64_t m_BaseTime = 0;
@@ -49,13 +60,16 @@ namespace dae
 
 		bool m_IsStopped = true;
 		bool m_ForceElapsedUpperBound = false;
+		bool m_IsFixedTime = false;
+
+		FrameTimeHistogram m_FrameTimes{};
 
 		bool m_BenchmarkActive = false;
-		float m_BenchmarkHigh{ 0.f };
-		float m_BenchmarkLow{ 0.f };
-		float m_BenchmarkAvg{ 0.f };
 		int m_BenchmarkFrames{ 0 };
-		int m_BenchmarkCurrFrame{ 0 };
-		std::vector<float> m_Benchmarks{};
+		float m_BenchmarkSeconds{ 0.f };
+		float m_BenchmarkElapsed{ 0.f };
+		std::string m_BenchmarkFilename{};
+
+		void FinishBenchmark();
 	};
 }
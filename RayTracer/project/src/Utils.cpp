@@ -0,0 +1,430 @@
+#include "Utils.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <thread>
+
+namespace dae
+{
+	namespace
+	{
+		//Everything one line-aligned chunk of the file contributes
+		struct OBJChunk
+		{
+			const char* pBegin{ nullptr };
+			const char* pEnd{ nullptr };
+
+			std::vector<Vector3> positions{};
+			std::vector<int> indices{};
+			std::vector<size_t> relativeIndices{}; //slots in indices that still need the chunk's first vertex added
+
+			size_t positionOffset{ 0 };
+			size_t indexOffset{ 0 };
+		};
+
+		inline bool IsSpace(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		inline const char* SkipSpaces(const char* pCurrent, const char* pEnd)
+		{
+			while (pCurrent < pEnd && IsSpace(*pCurrent)) ++pCurrent;
+			return pCurrent;
+		}
+
+		inline const char* ParseFloat(const char* pCurrent, const char* pEnd, float& value)
+		{
+			pCurrent = SkipSpaces(pCurrent, pEnd);
+			if (pCurrent < pEnd && *pCurrent == '+') ++pCurrent; //from_chars doesn't accept a leading '+'
+			return std::from_chars(pCurrent, pEnd, value).ptr;
+		}
+
+		void ParseChunk(OBJChunk& chunk)
+		{
+			//Rough guess so the common case doesn't reallocate: ~30 bytes per line, twice as many faces as vertices
+			const size_t estimatedLines = (chunk.pEnd - chunk.pBegin) / 30 + 1;
+			chunk.positions.reserve(estimatedLines / 3);
+			chunk.indices.reserve(estimatedLines * 2);
+
+			std::vector<int> polygon{};
+			polygon.reserve(8);
+
+			const char* pLine = chunk.pBegin;
+			while (pLine < chunk.pEnd)
+			{
+				const char* pLineEnd = static_cast<const char*>(std::memchr(pLine, '\n', chunk.pEnd - pLine));
+				if (!pLineEnd) pLineEnd = chunk.pEnd;
+
+				const char* pCurrent = SkipSpaces(pLine, pLineEnd);
+				if (pLineEnd - pCurrent >= 2 && pCurrent[0] == 'v' && IsSpace(pCurrent[1]))
+				{
+					//Vertex
+					Vector3 position{};
+					pCurrent = ParseFloat(pCurrent + 2, pLineEnd, position.x);
+					pCurrent = ParseFloat(pCurrent, pLineEnd, position.y);
+					ParseFloat(pCurrent, pLineEnd, position.z);
+					chunk.positions.emplace_back(position);
+				}
+				else if (pLineEnd - pCurrent >= 2 && pCurrent[0] == 'f' && IsSpace(pCurrent[1]))
+				{
+					//Face, only the position index of every v/vt/vn triplet is used
+					polygon.clear();
+					pCurrent += 2;
+					while (true)
+					{
+						pCurrent = SkipSpaces(pCurrent, pLineEnd);
+						if (pCurrent >= pLineEnd) break;
+
+						int index{ 0 };
+						const auto result = std::from_chars(pCurrent, pLineEnd, index);
+						if (result.ec != std::errc{}) break;
+						polygon.emplace_back(index);
+
+						pCurrent = result.ptr;
+						while (pCurrent < pLineEnd && !IsSpace(*pCurrent)) ++pCurrent;
+					}
+
+					//Fan triangulation (0, i, i + 1)
+					for (size_t corner{ 1 }; corner + 1 < polygon.size(); ++corner)
+					{
+						for (const int index : { polygon[0], polygon[corner], polygon[corner + 1] })
+						{
+							if (index < 0)
+							{
+								//Relative to the vertices read so far, the chunk's offset gets added when merging
+								chunk.relativeIndices.emplace_back(chunk.indices.size());
+								chunk.indices.emplace_back(static_cast<int>(chunk.positions.size()) + index);
+							}
+							else
+							{
+								chunk.indices.emplace_back(index - 1);
+							}
+						}
+					}
+				}
+
+				pLine = pLineEnd + 1;
+			}
+		}
+
+		//Parses [pBegin, pEnd) in line aligned chunks on all cores and appends the positions and triangle indices.
+		//Indices count from the first vertex of the file, firstVertex vertices come before pBegin
+		void ParseRange(const char* pBegin, const char* pEnd, size_t firstVertex, std::vector<Vector3>& positions, std::vector<int>& indices)
+		{
+			const size_t size = pEnd - pBegin;
+
+			//Enough chunks to balance uneven lines over all cores
+			constexpr size_t minChunkSize{ 1 << 20 };
+			const size_t maxChunks = std::max(1u, std::thread::hardware_concurrency()) * 4;
+			const size_t amountOfChunks = std::clamp(size / minChunkSize, size_t{ 1 }, maxChunks);
+
+			std::vector<OBJChunk> chunks(amountOfChunks);
+			const char* pChunkBegin = pBegin;
+			for (size_t chunkIndex{ 0 }; chunkIndex < amountOfChunks; ++chunkIndex)
+			{
+				const char* pChunkEnd = pBegin + size * (chunkIndex + 1) / amountOfChunks;
+				if (pChunkEnd < pChunkBegin) pChunkEnd = pChunkBegin;
+				if (chunkIndex + 1 < amountOfChunks)
+				{
+					const char* pNewLine = static_cast<const char*>(std::memchr(pChunkEnd, '\n', pEnd - pChunkEnd));
+					pChunkEnd = pNewLine ? pNewLine + 1 : pEnd;
+				}
+
+				chunks[chunkIndex].pBegin = pChunkBegin;
+				chunks[chunkIndex].pEnd = pChunkEnd;
+				pChunkBegin = pChunkEnd;
+			}
+
+			std::for_each(std::execution::par, chunks.begin(), chunks.end(), ParseChunk);
+
+			//Prefix sums give every chunk its place in the output
+			const size_t firstPosition = positions.size();
+			const size_t firstIndex = indices.size();
+			size_t amountOfPositions{ 0 }, amountOfIndices{ 0 };
+			for (OBJChunk& chunk : chunks)
+			{
+				chunk.positionOffset = amountOfPositions;
+				chunk.indexOffset = amountOfIndices;
+				amountOfPositions += chunk.positions.size();
+				amountOfIndices += chunk.indices.size();
+			}
+
+			positions.resize(firstPosition + amountOfPositions);
+			indices.resize(firstIndex + amountOfIndices);
+
+			std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](OBJChunk& chunk)
+				{
+					std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + (firstPosition + chunk.positionOffset));
+
+					for (const size_t slot : chunk.relativeIndices)
+						chunk.indices[slot] += static_cast<int>(firstVertex + chunk.positionOffset);
+					std::copy(chunk.indices.begin(), chunk.indices.end(), indices.begin() + (firstIndex + chunk.indexOffset));
+
+					//Free the chunk's copy right away, large files would otherwise peak at twice their size
+					chunk.positions = {};
+					chunk.indices = {};
+				});
+		}
+
+		//Binary mesh cache, the arrays are stored in their in-memory layout right after the header
+		//Bump the version whenever the header or any stored type changes
+		constexpr char g_MeshCacheMagic[4]{ 'R', 'T', 'M', 'C' };
+		constexpr uint32_t g_MeshCacheVersion{ 2 };
+
+		struct MeshCacheHeader
+		{
+			char magic[4]{};
+			uint32_t version{ 0 };
+			uint64_t sourceHash{ 0 };
+			uint64_t sourceSize{ 0 };
+			int64_t sourceModifiedTime{ 0 }; //file clock ticks, a match (with the size) skips hashing the source
+			uint64_t amountOfPositions{ 0 };
+			uint64_t amountOfNormals{ 0 };
+			uint64_t amountOfIndices{ 0 };
+			uint64_t amountOfBVHNodes{ 0 }; //reserved for a serialised mesh BVH, always 0 for now
+		};
+
+		static_assert(sizeof(Vector3) == 3 * sizeof(float), "Mesh cache stores Vector3 as 3 packed floats");
+		static_assert(sizeof(MeshCacheHeader) == 64, "Mesh cache header layout changed, bump g_MeshCacheVersion");
+
+		struct SourceStamp
+		{
+			uint64_t size{ 0 };
+			int64_t modifiedTime{ 0 };
+		};
+
+		bool GetSourceStamp(const std::string& filename, SourceStamp& stamp)
+		{
+			std::error_code error{};
+			stamp.size = std::filesystem::file_size(filename, error);
+			if (error)
+				return false;
+			stamp.modifiedTime = std::filesystem::last_write_time(filename, error).time_since_epoch().count();
+			return !error;
+		}
+
+		uint64_t HashFile(const std::string& filename)
+		{
+			MappedFile source{};
+			return source.Open(filename) ? Utils::HashBytes(source.GetData(), source.GetSize()) : 0;
+		}
+
+		//The source is only read when its size still matches but its modification time doesn't (touched, copied,
+		//checked out again), then the hash decides and a match stores the new time so the next start skips it
+		bool ReadMeshCache(const std::string& cacheFilename, const std::string& sourceFilename, const SourceStamp& stamp,
+			std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+		{
+			MappedFile cache{};
+			if (!cache.Open(cacheFilename) || cache.GetSize() < sizeof(MeshCacheHeader))
+				return false;
+
+			MeshCacheHeader header{};
+			std::memcpy(&header, cache.GetData(), sizeof(MeshCacheHeader));
+			if (std::memcmp(header.magic, g_MeshCacheMagic, sizeof(header.magic)) != 0
+				|| header.version != g_MeshCacheVersion
+				|| header.sourceSize != stamp.size
+				|| header.amountOfBVHNodes != 0)
+				return false;
+
+			bool isStampOutdated{ false };
+			if (header.sourceModifiedTime != stamp.modifiedTime)
+			{
+				if (HashFile(sourceFilename) != header.sourceHash)
+					return false;
+				isStampOutdated = true;
+			}
+
+			const uint64_t expectedSize = sizeof(MeshCacheHeader)
+				+ (header.amountOfPositions + header.amountOfNormals) * sizeof(Vector3)
+				+ header.amountOfIndices * sizeof(int);
+			if (cache.GetSize() != expectedSize)
+				return false;
+
+			//TriangleMesh owns its arrays, so this is one bulk copy per array straight out of the mapping
+			const char* pCurrent = cache.GetData() + sizeof(MeshCacheHeader);
+			const auto pPositions = reinterpret_cast<const Vector3*>(pCurrent);
+			positions.insert(positions.end(), pPositions, pPositions + header.amountOfPositions);
+			pCurrent += header.amountOfPositions * sizeof(Vector3);
+
+			const auto pNormals = reinterpret_cast<const Vector3*>(pCurrent);
+			normals.insert(normals.end(), pNormals, pNormals + header.amountOfNormals);
+			pCurrent += header.amountOfNormals * sizeof(Vector3);
+
+			const auto pIndices = reinterpret_cast<const int*>(pCurrent);
+			indices.insert(indices.end(), pIndices, pIndices + header.amountOfIndices);
+
+			if (isStampOutdated)
+			{
+				cache.Close();
+				header.sourceModifiedTime = stamp.modifiedTime;
+				std::fstream file(cacheFilename, std::ios::binary | std::ios::in | std::ios::out);
+				file.write(reinterpret_cast<const char*>(&header), sizeof(MeshCacheHeader));
+			}
+			return true;
+		}
+
+		void WriteMeshCache(const std::string& cacheFilename, uint64_t sourceHash, const SourceStamp& stamp,
+			const Vector3* pPositions, size_t amountOfPositions, const Vector3* pNormals, size_t amountOfNormals, const int* pIndices, size_t amountOfIndices)
+		{
+			MeshCacheHeader header{};
+			std::memcpy(header.magic, g_MeshCacheMagic, sizeof(header.magic));
+			header.version = g_MeshCacheVersion;
+			header.sourceHash = sourceHash;
+			header.sourceSize = stamp.size;
+			header.sourceModifiedTime = stamp.modifiedTime;
+			header.amountOfPositions = amountOfPositions;
+			header.amountOfNormals = amountOfNormals;
+			header.amountOfIndices = amountOfIndices;
+
+			//Write to a temporary file first so a crash never leaves a truncated cache behind
+			const std::string tempFilename{ cacheFilename + ".tmp" };
+			{
+				std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+				if (!file)
+					return; //read-only location, just keep parsing the source
+
+				file.write(reinterpret_cast<const char*>(&header), sizeof(MeshCacheHeader));
+				file.write(reinterpret_cast<const char*>(pPositions), amountOfPositions * sizeof(Vector3));
+				file.write(reinterpret_cast<const char*>(pNormals), amountOfNormals * sizeof(Vector3));
+				file.write(reinterpret_cast<const char*>(pIndices), amountOfIndices * sizeof(int));
+				if (!file)
+				{
+					file.close();
+					std::remove(tempFilename.c_str());
+					return;
+				}
+			}
+
+			std::remove(cacheFilename.c_str()); //rename doesn't overwrite on Windows
+			if (std::rename(tempFilename.c_str(), cacheFilename.c_str()) != 0)
+				std::remove(tempFilename.c_str());
+		}
+	}
+
+	namespace Utils
+	{
+		uint64_t HashBytes(const char* pData, size_t size)
+		{
+			//FNV-1a of fixed size blocks in parallel, then FNV-1a of the block hashes: the same on any amount of cores
+			constexpr uint64_t offsetBasis{ 14695981039346656037ull };
+			constexpr uint64_t prime{ 1099511628211ull };
+			constexpr size_t blockSize{ 1 << 20 };
+
+			std::vector<uint64_t> blockHashes(std::max(size_t{ 1 }, (size + blockSize - 1) / blockSize));
+			std::vector<size_t> blocks(blockHashes.size());
+			std::iota(blocks.begin(), blocks.end(), size_t{ 0 });
+			std::for_each(std::execution::par, blocks.begin(), blocks.end(), [&](size_t block)
+				{
+					const size_t first = block * blockSize;
+					const size_t last = std::min(size, first + blockSize);
+					uint64_t hash{ offsetBasis };
+					for (size_t i{ first }; i < last; ++i)
+					{
+						hash ^= static_cast<unsigned char>(pData[i]);
+						hash *= prime;
+					}
+					blockHashes[block] = hash;
+				});
+
+			uint64_t hash{ offsetBasis };
+			for (const uint64_t blockHash : blockHashes)
+			{
+				hash ^= blockHash;
+				hash *= prime;
+			}
+			return hash;
+		}
+
+		bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+		{
+			MappedFile file{};
+			if (!file.Open(filename))
+				return false;
+
+			const size_t firstIndex = indices.size();
+			ParseRange(file.GetData(), file.GetData() + file.GetSize(), 0, positions, indices);
+			const size_t amountOfIndices = indices.size() - firstIndex;
+
+			//Precompute normals
+			const size_t firstNormal = normals.size();
+			const size_t amountOfTriangles = amountOfIndices / 3;
+			normals.resize(firstNormal + amountOfTriangles);
+
+			std::vector<size_t> triangleIndices(amountOfTriangles);
+			std::iota(triangleIndices.begin(), triangleIndices.end(), size_t{ 0 });
+			std::for_each(std::execution::par_unseq, triangleIndices.begin(), triangleIndices.end(), [&](size_t triangle)
+				{
+					const size_t index = firstIndex + triangle * 3;
+					const Vector3& v0 = positions[indices[index]];
+					const Vector3 edgeV0V1 = positions[indices[index + 1]] - v0;
+					const Vector3 edgeV0V2 = positions[indices[index + 2]] - v0;
+
+					normals[firstNormal + triangle] = Vector3::Cross(edgeV0V1, edgeV0V2).Normalized();
+				});
+
+			return true;
+		}
+
+		bool ParseOBJBatches(const std::string& filename, size_t batchSize,
+			const std::function<void(const std::vector<Vector3>& positions, const std::vector<int>& indices)>& consume)
+		{
+			MappedFile file{};
+			if (!file.Open(filename))
+				return false;
+
+			const char* const pEnd = file.GetData() + file.GetSize();
+			std::vector<Vector3> positions{};
+			std::vector<int> indices{};
+			size_t firstVertex{ 0 };
+			for (const char* pBatch = file.GetData(); pBatch < pEnd;)
+			{
+				const char* pBatchEnd = pBatch + std::min(batchSize, static_cast<size_t>(pEnd - pBatch));
+				const char* pNewLine = static_cast<const char*>(std::memchr(pBatchEnd, '\n', pEnd - pBatchEnd));
+				pBatchEnd = pNewLine ? pNewLine + 1 : pEnd;
+
+				positions.clear();
+				indices.clear();
+				ParseRange(pBatch, pBatchEnd, firstVertex, positions, indices);
+				consume(positions, indices);
+
+				firstVertex += positions.size();
+				pBatch = pBatchEnd;
+			}
+			return true;
+		}
+
+		bool ParseOBJCached(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+		{
+			SourceStamp stamp{};
+			if (!GetSourceStamp(filename, stamp))
+				return false;
+
+			const std::string cacheFilename{ filename + ".meshcache" };
+			if (ReadMeshCache(cacheFilename, filename, stamp, positions, normals, indices))
+				return true;
+
+			const size_t firstPosition = positions.size();
+			const size_t firstNormal = normals.size();
+			const size_t firstIndex = indices.size();
+			if (!ParseOBJ(filename, positions, normals, indices))
+				return false;
+
+			WriteMeshCache(cacheFilename, HashFile(filename), stamp,
+				positions.data() + firstPosition, positions.size() - firstPosition,
+				normals.data() + firstNormal, normals.size() - firstNormal,
+				indices.data() + firstIndex, indices.size() - firstIndex);
+
+			return true;
+		}
+	}
+}
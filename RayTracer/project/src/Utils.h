@@ -1,5 +1,6 @@
 #pragma once
-#include <fstream>
+#include <functional>
+#include <string>
 #include "Maths.h"
 #include "DataTypes.h"
 
@@ -160,14 +161,15 @@ namespace dae
 				return false;
 			}
 			bool hit{ false };
-			for (int indicesIndex{}; indicesIndex < mesh.indices.size(); indicesIndex += 3)
+			const std::vector<int>& indices = mesh.GetIndices();
+			for (int indicesIndex{}; indicesIndex < indices.size(); indicesIndex += 3)
 			{
 				HitRecord temp;
 				HitRecord FinalClosestHitTriangle;
 
-				Vector3 pos1 = mesh.transformedPositions[mesh.indices[indicesIndex]];
-				Vector3 pos2 = mesh.transformedPositions[mesh.indices[indicesIndex + 1]];
-				Vector3 pos3 = mesh.transformedPositions[mesh.indices[indicesIndex + 2]];
+				Vector3 pos1 = mesh.transformedPositions[indices[indicesIndex]];
+				Vector3 pos2 = mesh.transformedPositions[indices[indicesIndex + 1]];
+				Vector3 pos3 = mesh.transformedPositions[indices[indicesIndex + 2]];
 
 				//dae::Triangle();
 				auto triangle = Triangle{ pos1, pos2, pos3 };
@@ -214,95 +216,96 @@ namespace dae
 			return {};
 		}
 
-		inline ColorRGB GetRadiance(const Light& light, const Vector3& target)
+		//Radiance arriving at target from a point on the light (the light origin for point lights)
+		inline ColorRGB GetRadiance(const Light& light, const Vector3& lightPoint, const Vector3& target)
 		{
-			//todo W3
 			// W/(m^2*sr)
-			
-			if (light.type == LightType::Point)
+			const Vector3 toTarget = target - lightPoint;
+			const float sqrDistance = Vector3::Dot(toTarget, toTarget);
+
+			switch (light.type)
 			{
-				ColorRGB Clr = (light.color * (light.intensity / Vector3::Dot((light.origin - target), (light.origin - target))));
-				return Clr;
-			}
-			else if (light.type == LightType::Directional)
+			case LightType::Point:
+			case LightType::SphereArea:
+				return light.color * (light.intensity / sqrDistance);
+			case LightType::RectArea:
 			{
+				//One sided emitter, facing light.direction
+				const float cosEmitter = Vector3::Dot(light.direction, toTarget) / std::sqrt(sqrDistance);
+				if (cosEmitter <= 0.f) return {};
+				return light.color * (light.intensity * cosEmitter / sqrDistance);
+			}
+			case LightType::Directional:
+			default:
 				return (light.color * light.intensity);
 			}
 		}
-	}
 
-	namespace Utils
-	{
-		//Just parses vertices and indices
-#pragma warning(push)
-#pragma warning(disable : 4505) //Warning unreferenced local function
-		static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+		inline ColorRGB GetRadiance(const Light& light, const Vector3& target)
 		{
-			std::ifstream file(filename);
-			if (!file)
-				return false;
+			//todo W3
+			return GetRadiance(light, light.origin, target);
+		}
 
-			std::string sCommand;
-			// start a while iteration ending when the end of file is reached (ios::eof)
-			while (!file.eof())
+		/**
+		 * \brief Picks a point on the light for a single shadow ray
+		 * \param target shaded point
+		 * \param u1 sample in [0,1)
+		 * \param u2 sample in [0,1)
+		 * \return point on the light, the origin for point lights
+		 */
+		inline Vector3 SampleLightPoint(const Light& light, const Vector3& target, float u1, float u2)
+		{
+			switch (light.type)
 			{
-				//read the first word of the string, use the >> operator (istream::operator>>) 
-				file >> sCommand;
-				//use conditional statements to process the different commands	
-				if (sCommand == "#")
-				{
-					// Ignore Comment
-				}
-				else if (sCommand == "v")
-				{
-					//Vertex
-					float x, y, z;
-					file >> x >> y >> z;
-					positions.push_back({ x, y, z });
-				}
-				else if (sCommand == "f")
-				{
-					float i0, i1, i2;
-					file >> i0 >> i1 >> i2;
-
-					indices.push_back((int)i0 - 1);
-					indices.push_back((int)i1 - 1);
-					indices.push_back((int)i2 - 1);
-				}
-				//read till end of line and ignore all remaining chars
-				file.ignore(1000, '\n');
-
-				if (file.eof())
-					break;
-			}
-
-			//Precompute normals
-			for (uint64_t index = 0; index < indices.size(); index += 3)
+			case LightType::SphereArea:
 			{
-				uint32_t i0 = indices[index];
-				uint32_t i1 = indices[index + 1];
-				uint32_t i2 = indices[index + 2];
-
-				Vector3 edgeV0V1 = positions[i1] - positions[i0];
-				Vector3 edgeV0V2 = positions[i2] - positions[i0];
-				Vector3 normal = Vector3::Cross(edgeV0V1, edgeV0V2);
-
-				if (std::isnan(normal.x))
-				{
-					int k = 0;
-				}
-
-				normal.Normalize();
-				if (std::isnan(normal.x))
-				{
-					int k = 0;
-				}
-
-				normals.push_back(normal);
+				//Uniform point on the disk the sphere projects to, as seen from target
+				const Vector3 w = (target - light.origin).Normalized();
+				const Vector3 helper = std::abs(w.x) > 0.9f ? Vector3::UnitY : Vector3::UnitX;
+				const Vector3 u = Vector3::Cross(helper, w).Normalized();
+				const Vector3 v = Vector3::Cross(w, u);
+
+				const float r = light.radius * std::sqrt(u1);
+				const float phi = PI_2 * u2;
+				return light.origin + u * (r * std::cos(phi)) + v * (r * std::sin(phi));
+			}
+			case LightType::RectArea:
+				return light.origin + light.halfExtentU * (2.f * u1 - 1.f) + light.halfExtentV * (2.f * u2 - 1.f);
+			default:
+				return light.origin;
 			}
-
-			return true;
 		}
-#pragma warning(pop)
+	}
+
+	namespace Utils
+	{
+		//Stable across runs and platforms, used to detect changed source files. Hashes 1 MiB blocks in parallel
+		uint64_t HashBytes(const char* pData, size_t size);
+
+		/**
+		 * \brief Parses vertex positions and faces, faces with more than 3 vertices are fan triangulated
+		 * and face normals are precomputed per triangle. The file is memory mapped and parsed in parallel.
+		 * Supports v, v/vt, v//vn and v/vt/vn face syntax, including negative (relative) indices.
+		 * \return false when the file can't be opened
+		 */
+		bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices);
+
+		/**
+		 * \brief Streams an OBJ through consume in line aligned batches of about batchSize bytes, each parsed on all cores,
+		 * so memory stays bounded for files of any size. A batch's indices are 0 based and count from the first vertex of
+		 * the file, they can refer to vertices of earlier batches. No normals are computed.
+		 * \return false when the file can't be opened
+		 */
+		bool ParseOBJBatches(const std::string& filename, size_t batchSize,
+			const std::function<void(const std::vector<Vector3>& positions, const std::vector<int>& indices)>& consume);
+
+		/**
+		 * \brief Same result as ParseOBJ, but goes through a binary cache written next to the source (<filename>.meshcache).
+		 * A cache with the source's size and modification time is used without reading the source. When only the time
+		 * changed the source is hashed, and the cache is rebuilt when its version or that hash doesn't match.
+		 * \return false when neither the cache nor the source can be read
+		 */
+		bool ParseOBJCached(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices);
 	}
 }
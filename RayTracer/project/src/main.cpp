@@ -2,33 +2,757 @@
 #ifdef ENABLE_VLD
 #include "vld.h"
 #endif
+#if !defined(RT_NO_SDL)
 #include "SDL.h"
 #include "SDL_surface.h"
 #undef main
+#endif
 
 //Standard includes
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 //Project includes
 #include "Timer.h"
+#include "DistributedRenderer.h"
+#include "InputRecording.h"
+#include "OfflineRenderer.h"
+#include "PerfCounters.h"
+#include "RegressionTest.h"
 #include "Renderer.h"
+#include "RenderThread.h"
 #include "Scene.h"
+#include "SceneFile.h"
+#include "SceneSweep.h"
+#include "SharedFrameRing.h"
+#include "Trace.h"
 #include "Vector3.h"
 #include "Vector4.h"
 
 using namespace dae;
 
+#if !defined(RT_NO_SDL)
 void ShutDown(SDL_Window* pWindow)
 {
 	SDL_DestroyWindow(pWindow);
 	SDL_Quit();
 }
+#endif
+
+//RayTracer.exe [scene] [--headless] [--render <frames>] [--first <frame>] [--fps <n>] [--samples <n>] [--jobs <n>]
+//	[--size <width> <height>] [--camera <x> <y> <z> [<yaw> <pitch>]] [--fov <degrees>] [--out <prefix>] [--format png|ppm|exr]
+//	[--seed <n>] [--spheres <n>] [--meshes <n>] [--triangles <n>] [--lights <n>] [--distribution uniform|clustered|stadium]
+//	[--sweep spheres|meshes|triangles|lights] [--sweep-max <n>] [--time-limit <seconds>] [--memory-limit <MB>]
+//	[--stats-log <file.csv>] [--trace <file.json>] [--benchmark <frames>] [--benchmark-seconds <seconds>]
+//	[--perf] [--perf-log <file.csv>]
+//	[--regression images|timings|all] [--references <dir>] [--baseline <file.csv>] [--max-slowdown <percent>]
+//	[--update-references] [--update-baseline] [--record <file>] [--replay <file>]
+//	[--coordinator <port>] [--local-workers <n>] [--tile-size <n>] [--verify] [--worker <host>:<port>]
+//	[--shm <name>] [--shm-watch <name> [<frames>]]
+struct CommandLine
+{
+	std::string sceneName{};
+	std::string statsLogFilename{}; //one CSV row of timings and ray counts per rendered frame
+	std::string traceFilename{}; //records from the start, F11 in the window writes here too
+	int benchmarkFrames{ 0 }; //the window times this many frames (or benchmarkSeconds) and quits
+	float benchmarkSeconds{ 0.f };
+	bool isCountingPerf{ false }; //hardware counters per render stage and thread, Linux only
+	std::string perfLogFilename{};
+	std::string recordFilename{}; //the window writes every frame's scene, time, input and camera here
+	std::string replayFilename{}; //renders the frames of a recording instead of following input, also with --headless
+	bool isHeadless{ false };
+	bool isOffline{ false };
+	bool isSweep{ false };
+	bool isRegression{ false };
+	OfflineRenderer::Settings settings{}; //headless renders use the size, samples and output options
+	SceneSweep::Settings sweepSettings{}; //the generated scene uses its scene settings
+	RegressionTest::Settings regressionSettings{};
+	bool isCoordinator{ false }; //renders the --headless frame on workers, with the headless size, samples and camera
+	DistributedRenderer::Settings distributedSettings{};
+	std::string workerHost{}; //a worker renders tiles for the coordinator at workerHost:workerPort
+	uint16_t workerPort{ 0 };
+	std::string sharedMemoryName{}; //every rendered frame is published to this shared memory ring
+	std::string watchedSharedMemoryName{}; //reads the frames another ray tracer publishes
+	int amountOfWatchedFrames{ 300 };
+
+	bool hasCameraOrigin{ false };
+	Vector3 cameraOrigin{};
+	bool hasCameraAngles{ false };
+	float cameraYaw{}, cameraPitch{}; //degrees
+	float cameraFov{ 0.f };
+};
+
+//Built in scenes by name, anything else is loaded as a scene file
+Scene* CreateScene(const std::string& name, const CommandLine& commandLine)
+{
+	if (name == "test") return new Scene_W3_TestScene2();
+	if (name == "reference") return new Scene_W4_RefrenceScene();
+	if (name == "bunny") return new Scene_W4_BunnyScene();
+	if (name == "arealight") return new Scene_W5_AreaLightScene();
+	if (name == "generated") return new Scene_Generated(commandLine.sweepSettings.scene);
+
+	const auto pScene = new Scene_File(name);
+	pScene->SetHotReload(false);
+	return pScene;
+}
+
+//Workers get the scene name and generator settings from the coordinator
+Scene* CreateWorkerScene(const std::string& name, const Scene_Generated::Settings& generatorSettings)
+{
+	CommandLine commandLine{};
+	commandLine.sweepSettings.scene = generatorSettings;
+	return CreateScene(name, commandLine);
+}
+
+bool ParseCommandLine(int argc, char* args[], CommandLine& commandLine)
+{
+	OfflineRenderer::Settings& settings = commandLine.settings;
+	SceneSweep::Settings& sweepSettings = commandLine.sweepSettings;
+	Scene_Generated::Settings& generatorSettings = sweepSettings.scene;
+
+	// A number that isn't followed by another option belongs to the option before it
+	const auto isNumber = [&](int i) { return i < argc && (std::isdigit(args[i][0]) || (args[i][0] == '-' && std::isdigit(args[i][1])) || args[i][0] == '.'); };
+
+	try
+	{
+		for (int i{ 1 }; i < argc; ++i)
+		{
+			const bool hasValue = i + 1 < argc;
+			if (!std::strcmp(args[i], "--headless")) commandLine.isHeadless = true;
+			else if (!std::strcmp(args[i], "--render") && hasValue)
+			{
+				commandLine.isOffline = true;
+				settings.amountOfFrames = std::stoi(args[++i]);
+			}
+			else if (!std::strcmp(args[i], "--first") && hasValue) settings.firstFrame = std::stoi(args[++i]);
+			else if (!std::strcmp(args[i], "--fps") && hasValue) settings.framesPerSecond = std::stof(args[++i]);
+			else if (!std::strcmp(args[i], "--samples") && hasValue) settings.samplesPerFrame = std::stoi(args[++i]);
+			else if (!std::strcmp(args[i], "--jobs") && hasValue) settings.concurrentFrames = std::stoi(args[++i]);
+			else if (!std::strcmp(args[i], "--out") && hasValue) settings.prefix = args[++i];
+			else if (!std::strcmp(args[i], "--fov") && hasValue) commandLine.cameraFov = std::stof(args[++i]);
+			else if (!std::strcmp(args[i], "--size") && i + 2 < argc)
+			{
+				settings.width = std::stoi(args[++i]);
+				settings.height = std::stoi(args[++i]);
+				//The sweep renders small frames unless a size is given
+				sweepSettings.width = settings.width;
+				sweepSettings.height = settings.height;
+			}
+			else if (!std::strcmp(args[i], "--camera") && i + 3 < argc)
+			{
+				commandLine.hasCameraOrigin = true;
+				commandLine.cameraOrigin = { std::stof(args[i + 1]), std::stof(args[i + 2]), std::stof(args[i + 3]) };
+				i += 3;
+				if (isNumber(i + 1) && isNumber(i + 2))
+				{
+					commandLine.hasCameraAngles = true;
+					commandLine.cameraYaw = std::stof(args[i + 1]);
+					commandLine.cameraPitch = std::stof(args[i + 2]);
+					i += 2;
+				}
+			}
+			else if (!std::strcmp(args[i], "--format") && hasValue)
+			{
+				const std::string format = args[++i];
+				if (format == "ppm") settings.format = FrameWriter::Format::PPM;
+				else if (format == "exr") settings.format = FrameWriter::Format::EXR;
+				else settings.format = FrameWriter::Format::PNG;
+			}
+			else if (!std::strcmp(args[i], "--seed") && hasValue) generatorSettings.seed = static_cast<uint32_t>(std::stoul(args[++i]));
+			else if (!std::strcmp(args[i], "--spheres") && hasValue) generatorSettings.amountOfSpheres = static_cast<uint32_t>(std::stoul(args[++i]));
+			else if (!std::strcmp(args[i], "--meshes") && hasValue) generatorSettings.amountOfMeshInstances = static_cast<uint32_t>(std::stoul(args[++i]));
+			else if (!std::strcmp(args[i], "--triangles") && hasValue) generatorSettings.trianglesPerMesh = static_cast<uint32_t>(std::stoul(args[++i]));
+			else if (!std::strcmp(args[i], "--lights") && hasValue) generatorSettings.amountOfLights = static_cast<uint32_t>(std::stoul(args[++i]));
+			else if (!std::strcmp(args[i], "--distribution") && hasValue && Scene_Generated::ParseDistribution(args[i + 1], generatorSettings.distribution)) ++i;
+			else if (!std::strcmp(args[i], "--sweep") && hasValue && SceneSweep::ParseDimension(args[i + 1], sweepSettings.dimension))
+			{
+				commandLine.isSweep = true;
+				++i;
+			}
+			else if (!std::strcmp(args[i], "--sweep-max") && hasValue) sweepSettings.maxCount = static_cast<uint32_t>(std::stoul(args[++i]));
+			else if (!std::strcmp(args[i], "--time-limit") && hasValue) sweepSettings.timeLimit = std::stof(args[++i]);
+			else if (!std::strcmp(args[i], "--memory-limit") && hasValue) sweepSettings.memoryLimit = std::stoull(args[++i]) << 20;
+			else if (!std::strcmp(args[i], "--stats-log") && hasValue) commandLine.statsLogFilename = args[++i];
+			else if (!std::strcmp(args[i], "--trace") && hasValue) commandLine.traceFilename = args[++i];
+			else if (!std::strcmp(args[i], "--benchmark") && hasValue) commandLine.benchmarkFrames = std::stoi(args[++i]);
+			else if (!std::strcmp(args[i], "--benchmark-seconds") && hasValue) commandLine.benchmarkSeconds = std::stof(args[++i]);
+			else if (!std::strcmp(args[i], "--perf")) commandLine.isCountingPerf = true;
+			else if (!std::strcmp(args[i], "--regression") && hasValue)
+			{
+				const std::string checks = args[++i];
+				commandLine.isRegression = true;
+				commandLine.regressionSettings.isCheckingImages = checks != "timings";
+				commandLine.regressionSettings.isCheckingTimings = checks != "images";
+			}
+			else if (!std::strcmp(args[i], "--references") && hasValue) commandLine.regressionSettings.referenceDirectory = args[++i];
+			else if (!std::strcmp(args[i], "--baseline") && hasValue) commandLine.regressionSettings.baselineFilename = args[++i];
+			else if (!std::strcmp(args[i], "--max-slowdown") && hasValue) commandLine.regressionSettings.maxSlowdown = std::stof(args[++i]) / 100.f;
+			else if (!std::strcmp(args[i], "--update-references")) commandLine.regressionSettings.isUpdatingReferences = true;
+			else if (!std::strcmp(args[i], "--update-baseline")) commandLine.regressionSettings.isUpdatingBaseline = true;
+			else if (!std::strcmp(args[i], "--record") && hasValue) commandLine.recordFilename = args[++i];
+			else if (!std::strcmp(args[i], "--replay") && hasValue) commandLine.replayFilename = args[++i];
+			else if (!std::strcmp(args[i], "--coordinator") && hasValue)
+			{
+				commandLine.isCoordinator = true;
+				commandLine.distributedSettings.port = static_cast<uint16_t>(std::stoul(args[++i]));
+			}
+			else if (!std::strcmp(args[i], "--local-workers") && hasValue) commandLine.distributedSettings.localWorkers = std::stoi(args[++i]);
+			else if (!std::strcmp(args[i], "--tile-size") && hasValue) commandLine.distributedSettings.tileSize = std::stoi(args[++i]);
+			else if (!std::strcmp(args[i], "--verify")) commandLine.distributedSettings.isVerifying = true;
+			else if (!std::strcmp(args[i], "--worker") && hasValue)
+			{
+				const std::string address = args[++i];
+				const size_t colon = address.rfind(':');
+				if (colon == std::string::npos)
+				{
+					std::cout << "--worker needs <host>:<port>" << std::endl;
+					return false;
+				}
+				commandLine.workerHost = address.substr(0, colon);
+				commandLine.workerPort = static_cast<uint16_t>(std::stoul(address.substr(colon + 1)));
+			}
+			else if (!std::strcmp(args[i], "--shm") && hasValue) commandLine.sharedMemoryName = args[++i];
+			else if (!std::strcmp(args[i], "--shm-watch") && hasValue)
+			{
+				commandLine.watchedSharedMemoryName = args[++i];
+				if (isNumber(i + 1))
+					commandLine.amountOfWatchedFrames = std::stoi(args[++i]);
+			}
+			else if (!std::strcmp(args[i], "--perf-log") && hasValue)
+			{
+				commandLine.isCountingPerf = true;
+				commandLine.perfLogFilename = args[++i];
+			}
+			else if (args[i][0] != '-') commandLine.sceneName = args[i];
+			else
+			{
+				std::cout << "Unknown option " << args[i] << std::endl;
+				return false;
+			}
+		}
+	}
+	catch (const std::exception&)
+	{
+		std::cout << "Invalid number on the command line" << std::endl;
+		return false;
+	}
+
+	if (settings.width <= 0 || settings.height <= 0 || settings.framesPerSecond <= 0.f || (commandLine.isOffline && settings.amountOfFrames <= 0))
+	{
+		std::cout << "Nothing to render" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void WriteStatsHeader(std::ostream& output)
+{
+	output << "frame,total ms,trace ms,streaming ms,reconstruct ms,resolve ms,";
+	RayStats::WriteCsvHeader(output);
+	output << "\n";
+}
+
+void WriteStatsRow(std::ostream& output, uint32_t frame, const Renderer::FrameStats& stats)
+{
+	output << frame << "," << stats.totalMs << "," << stats.traceMs << "," << stats.streamingMs << "," << stats.reconstructMs << "," << stats.resolveMs << ",";
+	stats.rays.WriteCsv(output);
+	output << "\n";
+}
+
+//One line summary of a frame's ray counts, for the console and the window title
+std::string GetStatsSummary(const Renderer::FrameStats& stats)
+{
+	const RayStats& rays = stats.rays;
+	const auto percentage = [](uint64_t part, uint64_t total) { return total ? 100.f * part / total : 0.f; };
+
+	std::ostringstream summary{};
+	summary << std::fixed << std::setprecision(1)
+		<< rays.GetAmountOfRays() / (std::max(stats.traceMs + stats.streamingMs, 1e-3f) * 1000.f) << " Mrays/s, "
+		<< rays.GetTrianglesPerRay() << " tris/ray, "
+		<< percentage(rays.slabTestsPassed, rays.slabTestsPassed + rays.slabTestsFailed) << "% slabs passed, "
+		<< percentage(rays.shadowRaysOccluded, rays.shadowRays) << "% shadow rays occluded, "
+		<< percentage(rays.pixelsWithoutHit, rays.primaryRays) << "% no hit";
+	return summary.str();
+}
+
+//Starts the hardware counters for --perf, false if they're off or unavailable
+bool StartPerfCounters(const CommandLine& commandLine, std::ofstream& perfLog)
+{
+	if (!commandLine.isCountingPerf || !PerfCounters::Enable(g_PerfStageNames))
+		return false;
+
+	if (!commandLine.perfLogFilename.empty())
+	{
+		perfLog.open(commandLine.perfLogFilename);
+		PerfCounters::WriteCsvHeader(perfLog);
+	}
+	return true;
+}
+
+//Takes the counts of the frame that just finished, logs them and adds them to reports
+void CollectPerfCounters(std::ofstream& perfLog, uint32_t frame, float frameMs, std::vector<PerfCounters::ThreadReport>& reports)
+{
+	const std::vector<PerfCounters::ThreadReport> frameReports = PerfCounters::Collect();
+	if (perfLog.is_open())
+		PerfCounters::WriteCsv(perfLog, frame, frameMs, frameReports);
+	reports.insert(reports.end(), frameReports.begin(), frameReports.end());
+}
+
+//Creates the ring for --shm, frames of the renderer's size fit
+void CreateFrameRing(const CommandLine& commandLine, const Renderer& renderer, SharedFrameRing& frameRing)
+{
+	if (commandLine.sharedMemoryName.empty())
+		return;
+
+	if (frameRing.Create(commandLine.sharedMemoryName, renderer.GetWidth(), renderer.GetHeight()))
+		std::cout << "Publishing frames to shared memory " << commandLine.sharedMemoryName << std::endl;
+	else
+		std::cout << "Could not create shared memory " << commandLine.sharedMemoryName << std::endl;
+}
+
+void PublishFrame(SharedFrameRing& frameRing, const Renderer& renderer)
+{
+	if (frameRing.IsOpen())
+		frameRing.Publish(renderer.GetPixels(), renderer.GetWidth(), renderer.GetHeight(),
+			renderer.GetRedShift(), renderer.GetGreenShift(), renderer.GetBlueShift(), renderer.GetFrameStats().totalMs);
+}
+
+//An example reader of --shm: looks at every pixel of the newest frame in place, like an encoder would, prints how many
+//frames it saw and how old they were, and writes the last one to <out>_00000.ppm
+int WatchFrameRing(const CommandLine& commandLine)
+{
+	using Clock = std::chrono::steady_clock;
+	const std::string& name = commandLine.watchedSharedMemoryName;
+
+	SharedFrameRing frameRing{};
+	const auto openStart = Clock::now();
+	while (!frameRing.Open(name))
+	{
+		if (Clock::now() - openStart > std::chrono::seconds{ 10 })
+		{
+			std::cout << "No frames published to shared memory " << name << std::endl;
+			return 1;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 50 });
+	}
+
+	FrameWriter::Frame lastFrame{};
+	lastFrame.format = FrameWriter::Format::PPM;
+	uint64_t lastFrameNumber{ 0 };
+	int amountOfFrames{ 0 }, amountOfSkippedFrames{ 0 }, amountOfTornReads{ 0 };
+	float latencySumMs{ 0.f };
+	auto lastNewFrame = Clock::now();
+	auto lastPrint = Clock::now();
+	while (amountOfFrames < commandLine.amountOfWatchedFrames)
+	{
+		if (frameRing.GetLatestFrame() == lastFrameNumber)
+		{
+			//The renderer is gone when nothing new arrived for a while
+			if (Clock::now() - lastNewFrame > std::chrono::seconds{ 10 })
+				break;
+			std::this_thread::sleep_for(std::chrono::microseconds{ 500 });
+			continue;
+		}
+
+		SharedFrameRing::FrameInfo frameInfo{};
+		uint32_t checksum{ 0 };
+		const bool isComplete = frameRing.ReadLatest([&](const SharedFrameRing::FrameInfo& info, const uint32_t* pPixels)
+			{
+				frameInfo = info;
+				for (size_t pixel{ 0 }; pixel < static_cast<size_t>(info.width) * info.height; ++pixel)
+					checksum = checksum * 31 + pPixels[pixel];
+				if (amountOfFrames + 1 == commandLine.amountOfWatchedFrames)
+					lastFrame.pixels.assign(pPixels, pPixels + static_cast<size_t>(info.width) * info.height);
+			});
+		if (!isComplete)
+		{
+			++amountOfTornReads;
+			continue;
+		}
+
+		if (lastFrameNumber != 0)
+			amountOfSkippedFrames += static_cast<int>(frameInfo.frameNumber - lastFrameNumber - 1);
+		lastFrameNumber = frameInfo.frameNumber;
+		lastNewFrame = Clock::now();
+		latencySumMs += (SharedFrameRing::GetTimeNs() - frameInfo.timestampNs) / 1e6f;
+		++amountOfFrames;
+
+		lastFrame.width = static_cast<int>(frameInfo.width);
+		lastFrame.height = static_cast<int>(frameInfo.height);
+		lastFrame.redShift = frameInfo.redShift;
+		lastFrame.greenShift = frameInfo.greenShift;
+		lastFrame.blueShift = frameInfo.blueShift;
+
+		if (Clock::now() - lastPrint > std::chrono::seconds{ 1 })
+		{
+			lastPrint = Clock::now();
+			std::cout << "frame " << frameInfo.frameNumber << " (" << frameInfo.width << "x" << frameInfo.height << ", " << frameInfo.renderMs
+				<< " ms to render, checksum " << checksum << ")" << std::endl;
+		}
+	}
+
+	std::cout << amountOfFrames << " frames read, " << amountOfSkippedFrames << " skipped, " << amountOfTornReads
+		<< " overwritten while reading, " << (amountOfFrames ? latencySumMs / amountOfFrames : 0.f) << " ms old on average" << std::endl;
+	if (!lastFrame.pixels.empty())
+	{
+		const std::string filename = commandLine.settings.prefix + "_00000.ppm";
+		if (FrameWriter::Write(lastFrame, filename))
+			std::cout << "Last frame written to " << filename << std::endl;
+	}
+	return amountOfFrames > 0 ? 0 : 1;
+}
+
+//Writes what was recorded since Trace::Start
+void SaveTrace(const std::string& filename)
+{
+	if (Trace::Stop(filename))
+		std::cout << "Trace written to " << filename << ", open it in Perfetto" << std::endl;
+	else
+		std::cout << "Could not write " << filename << std::endl;
+}
+
+//The scenes F4 cycles through, a recording refers to them by index so the replay has to be given the same scene
+std::vector<std::unique_ptr<Scene>> CreateSceneCycle(const CommandLine& commandLine, int& currentScene)
+{
+	std::vector<std::unique_ptr<Scene>> pScenes{};
+	pScenes.emplace_back(new Scene_W3_TestScene2());
+	pScenes.emplace_back(new Scene_W4_RefrenceScene());
+	pScenes.emplace_back(new Scene_W4_BunnyScene());
+	pScenes.emplace_back(new Scene_W5_AreaLightScene());
+	currentScene = 1;
+
+	//A scene file or generated scene passed on the command line is added to the cycle and shown first
+	if (!commandLine.sceneName.empty())
+	{
+		if (commandLine.sceneName == "generated")
+			pScenes.emplace_back(new Scene_Generated(commandLine.sweepSettings.scene));
+		else
+			pScenes.emplace_back(new Scene_File(commandLine.sceneName));
+		currentScene = static_cast<int>(pScenes.size()) - 1;
+	}
+	return pScenes;
+}
+
+//F2, F3 and F5 to F8 change how frames are rendered, recordings store them. False for any other key
+bool HandleRenderModeKey(Renderer& renderer, int functionKey)
+{
+	switch (functionKey)
+	{
+	case 2: renderer.ToggleShadow(); return true;
+	case 3: renderer.CycleLightingMode(); return true;
+	case 5: renderer.ToggleTemporalReprojection(); return true;
+	case 6: renderer.ToggleCheckerboard(); return true;
+	case 7: renderer.ToggleFrameBudget(); return true;
+	case 8: renderer.CycleToneMapping(); return true;
+	default: return false;
+	}
+}
+
+//Presses the recorded keys and updates the scene at the recorded time with the recorded input.
+//Returns false when the camera ended up somewhere else than in the recording and had to be moved there.
+bool ReplayFrame(const InputRecording::Frame& frame, Scene* pScene, Renderer& renderer, Timer& timer)
+{
+	for (const int functionKey : frame.functionKeys)
+		HandleRenderModeKey(renderer, functionKey);
+
+	Camera& camera = pScene->GetCamera();
+	camera.hasExternalInput = true;
+	camera.input = frame.input;
+	timer.SetFixedTime(frame.totalTime, frame.elapsedTime);
+	{
+		TRACE_SCOPE("Scene::Update");
+		pScene->Update(&timer);
+	}
+	return InputRecording::ApplyPose(frame, camera);
+}
+
+bool LoadRecording(const std::string& filename, InputRecording& recording, int amountOfScenes)
+{
+	if (!recording.Load(filename) || recording.GetFrames().empty())
+	{
+		std::cout << "Could not read the recording " << filename << std::endl;
+		return false;
+	}
+	for (const InputRecording::Frame& frame : recording.GetFrames())
+	{
+		if (frame.sceneIndex >= amountOfScenes)
+		{
+			std::cout << "The recording shows scene " << frame.sceneIndex << ", pass the scene it was recorded with" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+void PrintFrameTimes(const FrameTimeHistogram& frameTimes)
+{
+	const FrameTimeHistogram::Summary frameSummary = frameTimes.GetSummary();
+	std::cout << "frame times: p50 " << frameSummary.p50Ms << " ms, p90 " << frameSummary.p90Ms << " ms, p99 " << frameSummary.p99Ms
+		<< " ms, p99.9 " << frameSummary.p999Ms << " ms, worst " << frameSummary.worstMs << " ms, stddev "
+		<< frameSummary.standardDeviationMs << " ms" << std::endl;
+}
+
+//The headless frame, rendered in tiles by worker processes
+int RenderDistributed(const CommandLine& commandLine)
+{
+	const OfflineRenderer::Settings& settings = commandLine.settings;
+	DistributedRenderer::Settings distributedSettings = commandLine.distributedSettings;
+	DistributedRenderer::Job& job = distributedSettings.job;
+	job.sceneName = commandLine.sceneName.empty() ? "reference" : commandLine.sceneName;
+	job.generatorSettings = commandLine.sweepSettings.scene;
+	job.width = settings.width;
+	job.height = settings.height;
+	job.samplesPerFrame = settings.samplesPerFrame;
+	job.time = settings.firstFrame / settings.framesPerSecond;
+	job.hasCameraOrigin = commandLine.hasCameraOrigin;
+	job.cameraOrigin = commandLine.cameraOrigin;
+	job.hasCameraAngles = commandLine.hasCameraAngles;
+	job.cameraYaw = commandLine.cameraYaw;
+	job.cameraPitch = commandLine.cameraPitch;
+	job.cameraFov = commandLine.cameraFov;
+	job.isHdr = settings.format == FrameWriter::Format::EXR;
+	distributedSettings.prefix = settings.prefix;
+	distributedSettings.format = settings.format;
+
+	DistributedRenderer distributedRenderer{ CreateWorkerScene, distributedSettings };
+	return distributedRenderer.Run() ? 0 : 1;
+}
+
+//Render an image sequence and quit
+int RenderOffline(const CommandLine& commandLine)
+{
+	const OfflineRenderer::Settings& settings = commandLine.settings;
+	const std::string sceneName = commandLine.sceneName.empty() ? "reference" : commandLine.sceneName;
+	OfflineRenderer offlineRenderer{ [&] { return CreateScene(sceneName, commandLine); }, settings };
+	return offlineRenderer.Run() ? 0 : 1;
+}
+
+//Render one image into memory, write it, print where the time went and quit
+int RenderHeadless(const CommandLine& commandLine)
+{
+	using Clock = std::chrono::steady_clock;
+	const auto milliseconds = [](Clock::time_point start) { return std::chrono::duration<float, std::milli>(Clock::now() - start).count(); };
+	const OfflineRenderer::Settings& settings = commandLine.settings;
+
+	const auto start = Clock::now();
+	const std::unique_ptr<Scene> pScene{ CreateScene(commandLine.sceneName.empty() ? "reference" : commandLine.sceneName, commandLine) };
+	pScene->Activate();
+	pScene->WaitForContent();
+	const float loadMs = milliseconds(start);
+
+	Camera& camera = pScene->GetCamera();
+	camera.isInputEnabled = false;
+	if (commandLine.hasCameraOrigin) camera.origin = commandLine.cameraOrigin;
+	if (commandLine.hasCameraAngles)
+	{
+		camera.totalYaw = commandLine.cameraYaw * TO_RADIANS;
+		camera.totalPitch = commandLine.cameraPitch * TO_RADIANS;
+	}
+	if (commandLine.cameraFov > 0.f) camera.fovAngle = commandLine.cameraFov;
+
+	Renderer renderer{ settings.width, settings.height };
+	SharedFrameRing frameRing{};
+	CreateFrameRing(commandLine, renderer, frameRing);
+	Timer timer{};
+	timer.SetFixedTime(settings.firstFrame / settings.framesPerSecond, 0.f);
+	{
+		TRACE_SCOPE("Scene::Update");
+		pScene->Update(&timer);
+	}
+
+	std::ofstream statsLog{};
+	if (!commandLine.statsLogFilename.empty())
+	{
+		statsLog.open(commandLine.statsLogFilename);
+		WriteStatsHeader(statsLog);
+	}
+
+	std::ofstream perfLog{};
+	std::vector<PerfCounters::ThreadReport> perfReports{};
+	const bool isCountingPerf = StartPerfCounters(commandLine, perfLog);
+
+	//Every sample is a full frame, area lights converge over them
+	Renderer::FrameStats total{};
+	FrameTimeHistogram frameTimes{};
+	const int amountOfSamples = std::max(1, settings.samplesPerFrame);
+	const auto renderStart = Clock::now();
+	for (int sample{ 0 }; sample < amountOfSamples; ++sample)
+	{
+		renderer.Render(pScene.get());
+		PublishFrame(frameRing, renderer);
+
+		const Renderer::FrameStats& stats = renderer.GetFrameStats();
+		total.traceMs += stats.traceMs;
+		total.streamingMs += stats.streamingMs;
+		total.reconstructMs += stats.reconstructMs;
+		total.resolveMs += stats.resolveMs;
+		total.rays += stats.rays;
+		frameTimes.Record(stats.totalMs / 1000.f);
+		if (statsLog.is_open())
+			WriteStatsRow(statsLog, sample, stats);
+		if (isCountingPerf)
+			CollectPerfCounters(perfLog, sample, stats.totalMs, perfReports);
+	}
+	const float renderMs = milliseconds(renderStart);
+
+	const auto writeStart = Clock::now();
+	renderer.SaveBufferToImage(settings.format, settings.prefix, 0);
+	renderer.FlushImages();
+	const float writeMs = milliseconds(writeStart);
+
+	std::cout << settings.width << "x" << settings.height << ", " << amountOfSamples << " frame(s)\n"
+		<< "load:        " << loadMs << " ms\n"
+		<< "trace:       " << total.traceMs << " ms\n"
+		<< "streaming:   " << total.streamingMs << " ms\n"
+		<< "reconstruct: " << total.reconstructMs << " ms\n"
+		<< "resolve:     " << total.resolveMs << " ms\n"
+		<< "render:      " << renderMs << " ms\n"
+		<< "write:       " << writeMs << " ms\n"
+		<< "total:       " << milliseconds(start) << " ms\n"
+		<< "rays:        " << total.rays.GetAmountOfRays() << " (" << total.rays.GetAmountOfRays() / (renderMs * 1000.f) << " Mrays/s)\n"
+		<< "stats:       " << GetStatsSummary(total) << "\n";
+
+	PrintFrameTimes(frameTimes);
+
+	if (isCountingPerf)
+	{
+		std::cout << "hardware counters, " << amountOfSamples << " frame(s):\n";
+		PerfCounters::WriteReport(std::cout, perfReports);
+	}
+	return 0;
+}
+
+//Render every frame of a recording into memory, print the frame times, write them to replay.csv/.json and quit
+int ReplayHeadless(const CommandLine& commandLine)
+{
+	using Clock = std::chrono::steady_clock;
+	const OfflineRenderer::Settings& settings = commandLine.settings;
+
+	int currentScene{};
+	const std::vector<std::unique_ptr<Scene>> pScenes = CreateSceneCycle(commandLine, currentScene);
+	InputRecording recording{};
+	if (!LoadRecording(commandLine.replayFilename, recording, static_cast<int>(pScenes.size())))
+		return 1;
+
+	std::ofstream statsLog{};
+	if (!commandLine.statsLogFilename.empty())
+	{
+		statsLog.open(commandLine.statsLogFilename);
+		WriteStatsHeader(statsLog);
+	}
+
+	Renderer renderer{ settings.width, settings.height };
+	SharedFrameRing frameRing{};
+	CreateFrameRing(commandLine, renderer, frameRing);
+	Timer timer{};
+	FrameTimeHistogram frameTimes{};
+	int amountOfCorrectedFrames{ 0 };
+	currentScene = -1;
+	uint32_t frameNumber{ 0 };
+	for (const InputRecording::Frame& frame : recording.GetFrames())
+	{
+		//Loading isn't part of a frame, the window hides it with a background preload
+		Scene* pScene = pScenes[frame.sceneIndex].get();
+		if (frame.sceneIndex != currentScene)
+		{
+			currentScene = frame.sceneIndex;
+			pScene->Activate();
+			pScene->WaitForContent();
+		}
+
+		const auto frameStart = Clock::now();
+		if (!ReplayFrame(frame, pScene, renderer, timer))
+			++amountOfCorrectedFrames;
+		renderer.Render(pScene);
+		frameTimes.Record(std::chrono::duration<float>(Clock::now() - frameStart).count());
+		PublishFrame(frameRing, renderer);
+
+		if (statsLog.is_open())
+			WriteStatsRow(statsLog, frameNumber, renderer.GetFrameStats());
+		++frameNumber;
+	}
+
+	std::cout << "Replayed " << frameNumber << " frames at " << settings.width << "x" << settings.height;
+	if (amountOfCorrectedFrames > 0)
+		std::cout << ", the camera was corrected in " << amountOfCorrectedFrames << " of them";
+	std::cout << std::endl;
+	PrintFrameTimes(frameTimes);
+
+	std::ofstream csvStream{ "replay.csv" };
+	FrameTimeHistogram::WriteCsvHeader(csvStream);
+	frameTimes.WriteCsv(csvStream);
+	std::ofstream jsonStream{ "replay.json" };
+	frameTimes.WriteJson(jsonStream);
+	return 0;
+}
 
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	CommandLine commandLine{};
+	if (!ParseCommandLine(argc, args, commandLine))
+		return 1;
+
+	if (commandLine.isSweep)
+	{
+		SceneSweep sweep{ commandLine.sweepSettings };
+		sweep.Run(std::cout);
+		return 0;
+	}
+	if (commandLine.isRegression)
+	{
+		RegressionTest regressionTest{ commandLine.regressionSettings };
+		switch (regressionTest.Run(std::cout))
+		{
+		case RegressionTest::Result::Passed: return 0;
+		case RegressionTest::Result::BaselineCreated: return RegressionTest::s_SkipExitCode;
+		default: return 1;
+		}
+	}
+	//Before anything starts a thread, the coordinator forks its local workers
+	if (!commandLine.workerHost.empty())
+		return DistributedRenderer::RunWorker(CreateWorkerScene, commandLine.workerHost, commandLine.workerPort) ? 0 : 1;
+	if (commandLine.isCoordinator)
+		return RenderDistributed(commandLine);
+	if (!commandLine.watchedSharedMemoryName.empty())
+		return WatchFrameRing(commandLine);
+
+	Trace::SetThreadName("Main");
+	const bool isTracing = !commandLine.traceFilename.empty();
+	if (isTracing)
+		Trace::Start();
+
+#if !defined(RT_NO_SDL)
+	if (commandLine.isOffline || commandLine.isHeadless)
+#endif
+	{
+		//Without SDL there is no window to open
+		if (!commandLine.recordFilename.empty())
+			std::cout << "Only the window records input, --record is ignored" << std::endl;
+		int result{};
+		if (commandLine.isOffline)
+			result = RenderOffline(commandLine);
+		else if (!commandLine.replayFilename.empty())
+			result = ReplayHeadless(commandLine);
+		else
+			result = RenderHeadless(commandLine);
+		if (isTracing)
+			SaveTrace(commandLine.traceFilename);
+		return result;
+	}
+
+#if !defined(RT_NO_SDL)
+	const std::string traceFilename = isTracing ? commandLine.traceFilename : "RayTracer_Trace.json";
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -48,27 +772,140 @@ int main(int argc, char* args[])
 	//Initialize "framework"
 	const auto pTimer = new Timer();
 	const auto pRenderer = new Renderer(pWindow);
+	SharedFrameRing frameRing{};
+	CreateFrameRing(commandLine, *pRenderer, frameRing);
+
+	//Scenes are initialized on first activation, the next one in the F4 cycle is preloaded in the background
+	int currentScene{};
+	const std::vector<std::unique_ptr<Scene>> pScenes = CreateSceneCycle(commandLine, currentScene);
+	const int amountOfScenes{ static_cast<int>(pScenes.size()) };
+
+	//A replay follows the recording instead of the keyboard and mouse, and quits after its last frame
+	InputRecording replay{};
+	const bool isReplaying = !commandLine.replayFilename.empty();
+	if (isReplaying && !LoadRecording(commandLine.replayFilename, replay, amountOfScenes))
+	{
+		delete pRenderer;
+		delete pTimer;
+		ShutDown(pWindow);
+		return 1;
+	}
+	size_t replayFrame{ 0 };
+	int amountOfCorrectedFrames{ 0 };
 
-	int currentScene = 1;
-	
-	const auto pSceneTest = new Scene_W3_TestScene2();
-	const auto pSceneRefrence = new Scene_W4_RefrenceScene();
-	const auto pSceneBunny = new Scene_W4_BunnyScene();
-	
-	
-	pSceneTest->Initialize();
-	pSceneRefrence->Initialize();
-	pSceneBunny->Initialize();
+	InputRecording recording{};
+	if (!commandLine.recordFilename.empty() && !recording.StartRecording(commandLine.recordFilename))
+		std::cout << "Could not write " << commandLine.recordFilename << std::endl;
+	std::vector<int> pressedFunctionKeys{};
+
+	if (isReplaying)
+		currentScene = replay.GetFrames().front().sceneIndex;
+	pScenes[currentScene]->Activate();
+	pScenes[(currentScene + 1) % amountOfScenes]->PreloadAsync();
 
 	//Start loop
 	pTimer->Start();
 
-	// Start Benchmark
-	// pTimer->StartBenchmark();
+	//A benchmark run ends the program once it's written its frame times, a replay times all of its frames
+	const bool isBenchmarkRun = commandLine.benchmarkFrames > 0 || commandLine.benchmarkSeconds > 0.f;
+	if (isBenchmarkRun)
+		pTimer->StartBenchmark(commandLine.benchmarkFrames, commandLine.benchmarkSeconds);
+	else if (isReplaying)
+		pTimer->StartBenchmark(static_cast<int>(replay.GetFrames().size()), 0.f, "replay");
+
+	std::ofstream statsLog{};
+	if (!commandLine.statsLogFilename.empty())
+	{
+		statsLog.open(commandLine.statsLogFilename);
+		WriteStatsHeader(statsLog);
+	}
+	uint32_t frame{ 0 };
 
+	std::ofstream perfLog{};
+	std::vector<PerfCounters::ThreadReport> perfReports{}; //printed and cleared every second
+	const bool isCountingPerf = StartPerfCounters(commandLine, perfLog);
+
+	//The render thread owns the scenes, the renderer and the timer from here on. It updates and renders frame N+1
+	//while the main thread presents frame N and keeps polling input, anything else goes to it as a command.
 	float printTimer = 0.f;
+	std::atomic<bool> showStats{ false };
+	std::mutex titleMutex{};
+	std::string statsTitle{}; //from the render thread, the window title can only be set here
+	RenderThread renderThread{ static_cast<int>(width), static_cast<int>(height), [&](uint32_t* pPixels, const CameraInput& input)
+		{
+			bool isLastFrame{ false };
+			pRenderer->SetOutputBuffer(pPixels);
+
+			//--------- Update ---------
+			if (isReplaying)
+			{
+				//Content that streams in would make the frames differ between runs, a replay waits for it
+				const InputRecording::Frame& frame = replay.GetFrames()[replayFrame];
+				if (frame.sceneIndex != currentScene)
+				{
+					currentScene = frame.sceneIndex;
+					pScenes[currentScene]->Activate();
+					pScenes[(currentScene + 1) % amountOfScenes]->PreloadAsync();
+				}
+				pScenes[currentScene]->WaitForContent();
+				if (!ReplayFrame(frame, pScenes[currentScene].get(), *pRenderer, *pTimer))
+					++amountOfCorrectedFrames;
+				if (++replayFrame == replay.GetFrames().size())
+					isLastFrame = true;
+			}
+			else
+			{
+				TRACE_SCOPE("Scene::Update");
+				Camera& camera = pScenes[currentScene]->GetCamera();
+				camera.hasExternalInput = true;
+				camera.input = input;
+				pScenes[currentScene]->Update(pTimer);
+			}
+
+			if (recording.IsRecording())
+			{
+				InputRecording::Frame frame = InputRecording::Capture(currentScene, *pTimer, pScenes[currentScene]->GetCamera());
+				frame.functionKeys = std::move(pressedFunctionKeys);
+				recording.Record(frame);
+			}
+			pressedFunctionKeys.clear();
+
+			//--------- Render ---------
+			pRenderer->Render(pScenes[currentScene].get());
+			PublishFrame(frameRing, *pRenderer);
+			if (statsLog.is_open())
+				WriteStatsRow(statsLog, frame, pRenderer->GetFrameStats());
+			if (isCountingPerf)
+				CollectPerfCounters(perfLog, frame, pRenderer->GetFrameStats().totalMs, perfReports);
+			++frame;
+
+			//--------- Timer ---------
+			pTimer->Update();
+			if (isBenchmarkRun && !pTimer->IsBenchmarkActive())
+				isLastFrame = true;
+			printTimer += pTimer->GetElapsed();
+			if (printTimer >= 1.f)
+			{
+				printTimer = 0.f;
+				std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+				if (showStats)
+				{
+					const std::string summary = GetStatsSummary(pRenderer->GetFrameStats());
+					std::cout << summary << std::endl;
+					const std::lock_guard lock{ titleMutex };
+					statsTitle = "RayTracer - Warlop Mathijs | " + summary;
+				}
+				if (isCountingPerf)
+				{
+					PerfCounters::WriteReport(std::cout, perfReports);
+					perfReports.clear();
+				}
+			}
+			return !isLastFrame;
+		} };
+	renderThread.Start();
+
 	bool isLooping = true;
-	bool takeScreenshot = false;
 	while (isLooping)
 	{
 		//--------- Get input events ---------
@@ -81,100 +918,101 @@ int main(int argc, char* args[])
 				isLooping = false;
 				break;
 			case SDL_KEYUP:
+				//Screenshots are taken between frames, of the last full render
 				if (e.key.keysym.scancode == SDL_SCANCODE_X)
-					takeScreenshot = true;
-				if (e.key.keysym.scancode == SDL_SCANCODE_F2)
 				{
-					pRenderer->ToggleShadow(); 
+					const bool hdrScreenshot = (e.key.keysym.mod & KMOD_SHIFT) != 0;
+					renderThread.Post([pRenderer, hdrScreenshot]
+						{
+							pRenderer->SaveBufferToImage(hdrScreenshot ? FrameWriter::Format::EXR : FrameWriter::Format::PNG);
+							std::cout << "Screenshot queued!" << std::endl;
+						});
+				}
+				//Render mode keys are recorded, a replay ignores them and presses the recorded ones
+				if (e.key.keysym.scancode >= SDL_SCANCODE_F1 && e.key.keysym.scancode <= SDL_SCANCODE_F12 && !isReplaying)
+				{
+					const int functionKey = e.key.keysym.scancode - SDL_SCANCODE_F1 + 1;
+					renderThread.Post([&, functionKey]
+						{
+							if (HandleRenderModeKey(*pRenderer, functionKey))
+								pressedFunctionKeys.emplace_back(functionKey);
+						});
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F4 && !isReplaying)
+				{
+					renderThread.Post([&]
+						{
+							currentScene = (currentScene + 1) % amountOfScenes;
+							pScenes[currentScene]->Activate();
+							pScenes[(currentScene + 1) % amountOfScenes]->PreloadAsync();
+						});
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+				{
+					renderThread.Post([pRenderer] { pRenderer->ToggleCapture(); });
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F10)
+				{
+					showStats = !showStats;
+					if (!showStats)
+						SDL_SetWindowTitle(pWindow, "RayTracer - Warlop Mathijs");
 				}
-				if (e.key.keysym.scancode == SDL_SCANCODE_F3)
+				if (e.key.keysym.scancode == SDL_SCANCODE_F12)
 				{
-					pRenderer->CycleLightingMode();
+					renderThread.Post([pTimer] { pTimer->StartBenchmark(); });
 				}
-				if (e.key.keysym.scancode == SDL_SCANCODE_F4)
+				//Between frames no marker is open on the render workers
+				if (e.key.keysym.scancode == SDL_SCANCODE_F11)
 				{
-					if (currentScene == 1)
-					{
-						currentScene = 2;
-					}
-					else if (currentScene == 2)
-					{
-						currentScene = 0;
-					}
-					else currentScene = 1;
+					renderThread.Post([&traceFilename]
+						{
+							if (Trace::IsRecording())
+								SaveTrace(traceFilename);
+							else
+							{
+								Trace::Start();
+								std::cout << "Recording trace, F11 again to write it" << std::endl;
+							}
+						});
 				}
 				break;
 			}
 		}
+		//Relative mouse motion adds up until the render thread starts its next frame
+		if (!isReplaying)
+			renderThread.PublishInput(Camera::ReadInput());
 
-		//--------- Update ---------
-		if (currentScene == 1)
-		{
-			pSceneRefrence->Update(pTimer);
-		}
-		else if (currentScene == 2)
-		{
-			pSceneBunny->Update(pTimer);
-		}
-		else pSceneTest->Update(pTimer);
-		
-
-		//--------- Render ---------
-		if (currentScene == 1)
-		{
-			pRenderer->Render(pSceneRefrence);
-			//std::cout << currentScene << std::endl;
-		}
-		else if (currentScene == 2)
-		{
-			pRenderer->Render(pSceneBunny);
-		}
-		else pRenderer->Render(pSceneTest);
-		//pRenderer->Render(pScene);
+		//--------- Present ---------
+		const bool isRendering = renderThread.IsRunning();
+		if (const uint32_t* pPixels = renderThread.AcquireFrame())
+			pRenderer->Present(pPixels);
+		if (!isRendering)
+			isLooping = false;
 
-		//--------- Timer ---------
-		pTimer->Update();
-		printTimer += pTimer->GetElapsed();
-		if (printTimer >= 1.f)
-		{
-			printTimer = 0.f;
-			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
-			//std::cout << currentScene << std::endl;
-			
-		}
-		//Save screenshot after full render
-		if (takeScreenshot)
+		if (showStats)
 		{
-			if (!pRenderer->SaveBufferToImage())
-				std::cout << "Screenshot saved!" << std::endl;
-			else
-				std::cout << "Something went wrong. Screenshot not saved!" << std::endl;
-			takeScreenshot = false;
+			const std::lock_guard lock{ titleMutex };
+			if (!statsTitle.empty())
+				SDL_SetWindowTitle(pWindow, statsTitle.c_str());
+			statsTitle.clear();
 		}
 
-		//TESTS
-
-		//float dotResult{};
-		//dotResult = Vector3::Dot(Vector3::UnitX, Vector3::UnitY); 
-		//std::cout << dotResult << std::endl;
-
-		//Vector3 CrossResult{};
-		//CrossResult = Vector3::Cross(Vector3::UnitX, Vector3::UnitZ);
-		//std::cout << CrossResult.x << CrossResult.y << CrossResult.z << std::endl;
-
-		
+		//Sleeps until the next event, or a millisecond so finished frames are picked up
+		SDL_WaitEventTimeout(nullptr, 1);
 	}
+	renderThread.Stop();
 	pTimer->Stop();
+	if (Trace::IsRecording())
+		SaveTrace(traceFilename);
+	if (amountOfCorrectedFrames > 0)
+		std::cout << "The replayed camera was corrected in " << amountOfCorrectedFrames << " frames" << std::endl;
 
 	//Shutdown "framework"
-	//delete pScene;
-	delete pSceneTest;
-	delete pSceneBunny;
-	delete pSceneRefrence;
 	delete pRenderer;
 	delete pTimer;
 
 	ShutDown(pWindow);
 	return 0;
+#endif
 }
 
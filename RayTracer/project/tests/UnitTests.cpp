@@ -2,6 +2,25 @@
 #include "../src/Vector3.h"
 #include "../src/Vector4.h"
 #include "../src/Matrix.h"
+#include "../src/Utils.h"
+#include "../src/ClusteredMesh.h"
+#include "../src/Scene.h"
+#include "../src/FrameTimeHistogram.h"
+#include "../src/InputRecording.h"
+#include "../src/RegressionTest.h"
+#include "../src/RenderThread.h"
+#include "../src/SharedFrameRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
 
 namespace dae
 {
@@ -37,6 +56,311 @@ namespace dae
 
 	// W1
 
+	// W4
+	TEST(Utils, ParseOBJ) {
+		const std::string filename{ "ParseOBJ_Test.obj" };
+		{
+			std::ofstream file(filename, std::ios::binary);
+			file << "# comment\r\n"
+				<< "v 0 0 0\r\n"
+				<< "v 1 0 0\n"
+				<< "v 1 1 0\n"
+				<< "v 0 1 +0.0\n"
+				<< "vn 0 0 1\n"
+				<< "f 1/1/1 2/2/1 3/3/1 4/4/1\n" // quad, fan triangulated
+				<< "f -4//1 -3//1 -2//1"; // relative indices, no trailing newline
+		}
+
+		std::vector<Vector3> positions{}, normals{};
+		std::vector<int> indices{};
+		ASSERT_TRUE(Utils::ParseOBJ(filename, positions, normals, indices));
+		std::remove(filename.c_str());
+
+		ASSERT_EQ(4u, positions.size());
+		EXPECT_EQ(Vector3(1.f, 1.f, 0.f), positions[2]);
+		EXPECT_EQ((std::vector<int>{ 0, 1, 2, 0, 2, 3, 0, 1, 2 }), indices);
+		ASSERT_EQ(3u, normals.size());
+		EXPECT_EQ(Vector3::UnitZ, normals[1]);
+
+		EXPECT_FALSE(Utils::ParseOBJ("DoesNotExist.obj", positions, normals, indices));
+	}
+
+	TEST(Utils, ParseOBJCached) {
+		const std::string filename{ "ParseOBJCached_Test.obj" };
+		const auto write = [&](const char* pContents)
+			{
+				std::ofstream file(filename, std::ios::binary);
+				file << pContents;
+			};
+		const auto parse = [&]
+			{
+				std::vector<Vector3> positions{}, normals{};
+				std::vector<int> indices{};
+				EXPECT_TRUE(Utils::ParseOBJCached(filename, positions, normals, indices));
+				return positions;
+			};
+		write("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+		EXPECT_EQ(Vector3(1.f, 0.f, 0.f), parse()[1]);
+		EXPECT_EQ(Vector3(1.f, 0.f, 0.f), parse()[1]); // from the cache
+
+		// Same size, new time: the hash finds the change
+		write("v 0 0 0\nv 2 0 0\nv 0 1 0\nf 1 2 3\n");
+		std::filesystem::last_write_time(filename, std::filesystem::last_write_time(filename) + std::chrono::seconds{ 10 });
+		EXPECT_EQ(Vector3(2.f, 0.f, 0.f), parse()[1]);
+
+		// Only the time changed: the cache is still used, with the new time stored
+		std::filesystem::last_write_time(filename, std::filesystem::last_write_time(filename) + std::chrono::seconds{ 10 });
+		EXPECT_EQ(Vector3(2.f, 0.f, 0.f), parse()[1]);
+		EXPECT_EQ(Vector3(2.f, 0.f, 0.f), parse()[1]);
+
+		std::remove(filename.c_str());
+		std::remove((filename + ".meshcache").c_str());
+	}
+
+	TEST(ClusteredMesh, TreeMatchesBruteForce) {
+		const std::string filename{ "ClusteredMesh_Test.obj" };
+		const std::string clusterFilename{ filename + ".clusters" };
+		{
+			// Random triangles, in a few clumps so the split sees empty space and overlap
+			std::ofstream file(filename, std::ios::binary);
+			uint32_t seed{ 7 };
+			const auto random = [&] { seed = seed * 1664525u + 1013904223u; return static_cast<float>(seed >> 8) / 16777216.f; };
+			for (int triangle{ 0 }; triangle < 500; ++triangle)
+			{
+				const Vector3 centre{ std::floor(random() * 3.f) * 4.f, random() * 2.f, random() * 2.f };
+				for (int corner{ 0 }; corner < 3; ++corner)
+					file << "v " << centre.x + random() << ' ' << centre.y + random() << ' ' << centre.z + random() << '\n';
+				file << "f -3 -2 -1\n";
+			}
+		}
+
+		ClusteredMesh mesh{};
+		ASSERT_TRUE(ClusteredMesh::Build(filename, clusterFilename, Matrix::CreateTranslation(0.f, 0.f, 0.f), 4));
+		ASSERT_TRUE(mesh.Open(clusterFilename));
+		ASSERT_EQ(500u, mesh.GetAmountOfTriangles());
+		for (uint32_t cluster{ 0 }; cluster < mesh.GetAmountOfClusters(); ++cluster)
+			ASSERT_TRUE(mesh.LoadCluster(cluster));
+		mesh.cullMode = TriangleCullMode::NoCulling;
+
+		std::vector<Vector3> positions{}, normals{};
+		std::vector<int> indices{};
+		ASSERT_TRUE(Utils::ParseOBJ(filename, positions, normals, indices));
+		std::remove(filename.c_str());
+		std::remove(clusterFilename.c_str());
+
+		for (int rayIndex{ 0 }; rayIndex < 400; ++rayIndex)
+		{
+			const float angle = rayIndex * 0.37f;
+			Ray ray{ Vector3{ 5.f, 1.5f, -6.f }, Vector3{ std::sin(angle) * 0.6f, std::cos(angle * 1.3f) * 0.3f, 1.f }.Normalized() };
+			if (rayIndex % 2 == 1) // from the other side
+			{
+				ray.origin = Vector3{ 5.f, 1.5f, 8.f };
+				ray.direction = -ray.direction;
+			}
+
+			HitRecord expected{};
+			for (size_t index{ 0 }; index < indices.size(); index += 3)
+			{
+				Triangle triangle{ positions[indices[index]], positions[indices[index + 1]], positions[indices[index + 2]] };
+				triangle.cullMode = TriangleCullMode::NoCulling;
+				HitRecord hit{};
+				if (GeometryUtils::HitTest_Triangle(triangle, ray, hit) && hit.t < expected.t)
+					expected = hit;
+			}
+
+			HitRecord closestHit{};
+			mesh.GetClosestHit(ray, closestHit, 1, 0);
+			ASSERT_EQ(expected.didHit, closestHit.didHit) << "ray " << rayIndex;
+			if (expected.didHit)
+			{
+				EXPECT_EQ(expected.t, closestHit.t) << "ray " << rayIndex;
+			}
+			EXPECT_EQ(expected.didHit, mesh.DoesHit(ray, 0)) << "ray " << rayIndex;
+		}
+		EXPECT_FALSE(ClusteredMesh::HadMiss());
+	}
+
+	TEST(Scene_Generated, SameSeedSameScene) {
+		Scene_Generated::Settings settings{};
+		settings.amountOfSpheres = 100;
+		settings.amountOfMeshInstances = 10;
+		settings.trianglesPerMesh = 48;
+		settings.distribution = Scene_Generated::Distribution::Clustered;
+
+		Scene_Generated first{ settings }, second{ settings };
+		first.Activate();
+		second.Activate();
+		settings.seed = 2;
+		Scene_Generated other{ settings };
+		other.Activate();
+
+		ASSERT_EQ(100u, first.GetSphereGeometries().size());
+		EXPECT_EQ(10u * 48u, first.GetAmountOfTriangles());
+		for (size_t index{ 0 }; index < first.GetSphereGeometries().size(); ++index)
+		{
+			EXPECT_EQ(first.GetSphereGeometries()[index].origin, second.GetSphereGeometries()[index].origin);
+			EXPECT_EQ(first.GetSphereGeometries()[index].radius, second.GetSphereGeometries()[index].radius);
+		}
+		EXPECT_NE(first.GetSphereGeometries()[0].origin, other.GetSphereGeometries()[0].origin);
+	}
+
+	TEST(FrameTimeHistogram, Percentiles) {
+		FrameTimeHistogram frameTimes{};
+		for (int milliseconds{ 1 }; milliseconds <= 1000; ++milliseconds)
+			frameTimes.Record(milliseconds / 1000.f);
+
+		// Buckets are at most ~3% wide, the middle of one is at most half that off
+		const FrameTimeHistogram::Summary summary = frameTimes.GetSummary();
+		EXPECT_EQ(1000u, summary.amountOfFrames);
+		EXPECT_NEAR(500.5f, summary.averageMs, 0.01f);
+		EXPECT_NEAR(288.67f, summary.standardDeviationMs, 0.1f);
+		EXPECT_NEAR(500.f, summary.p50Ms, 500.f * 0.016f);
+		EXPECT_NEAR(900.f, summary.p90Ms, 900.f * 0.016f);
+		EXPECT_NEAR(990.f, summary.p99Ms, 990.f * 0.016f);
+		EXPECT_LE(summary.p999Ms, 1000.f);
+		EXPECT_FLOAT_EQ(1000.f, summary.worstMs);
+
+		// One stutter in a thousand smooth frames only shows in the tail
+		frameTimes.Reset();
+		for (int frame{ 0 }; frame < 999; ++frame)
+			frameTimes.Record(0.016f);
+		frameTimes.Record(0.25f);
+		EXPECT_NEAR(16.f, frameTimes.GetPercentileMs(99.f), 16.f * 0.016f);
+		EXPECT_FLOAT_EQ(250.f, frameTimes.GetPercentileMs(100.f));
+	}
+
+	TEST(RegressionTest, CompareImages) {
+		const std::vector<uint8_t> reference(100 * 3, 128);
+		std::vector<uint8_t> image = reference;
+		EXPECT_EQ(0.f, RegressionTest::CompareImages(image, reference, 2.3f).differentPixels);
+
+		// One step of 8 bit grey is below a just noticeable difference, pure red instead of grey is far above it
+		image[0] = image[1] = image[2] = 129;
+		EXPECT_EQ(0.f, RegressionTest::CompareImages(image, reference, 2.3f).differentPixels);
+		image[3] = 255;
+		image[4] = image[5] = 0;
+		const RegressionTest::ImageDifference difference = RegressionTest::CompareImages(image, reference, 2.3f);
+		EXPECT_FLOAT_EQ(0.01f, difference.differentPixels);
+		EXPECT_GT(difference.maxDeltaE, 50.f);
+	}
+
+	TEST(InputRecording, ReplayIsExact) {
+		// A camera driven by the recorded input ends up exactly where the recording says it was
+		Camera camera{ Vector3{ 0.f, 3.f, -9.f }, 45.f };
+		InputRecording::Frame frame{};
+		frame.totalTime = 1.f / 3.f;
+		frame.elapsedTime = 1.f / 60.f;
+		frame.input.isMovingForward = frame.input.isBoosting = frame.input.isRightButtonDown = true;
+		frame.input.mouseX = -7;
+		frame.input.mouseY = 3;
+		frame.functionKeys = { 2, 8 };
+		camera.ApplyInput(frame.input, frame.elapsedTime);
+		frame.origin = camera.origin;
+		frame.yaw = camera.totalYaw;
+		frame.pitch = camera.totalPitch;
+		frame.fov = camera.fovAngle;
+
+		std::stringstream file{};
+		InputRecording::WriteHeader(file);
+		InputRecording::WriteFrame(file, frame);
+		InputRecording::WriteFrame(file, InputRecording::Frame{});
+		InputRecording recording{};
+		ASSERT_TRUE(recording.Load(file));
+		ASSERT_EQ(2u, recording.GetFrames().size());
+
+		const InputRecording::Frame& loaded = recording.GetFrames()[0];
+		EXPECT_EQ(frame.totalTime, loaded.totalTime);
+		EXPECT_EQ(frame.elapsedTime, loaded.elapsedTime);
+		EXPECT_EQ(frame.origin.z, loaded.origin.z);
+		EXPECT_EQ(frame.yaw, loaded.yaw);
+		EXPECT_EQ(frame.functionKeys, loaded.functionKeys);
+		EXPECT_TRUE(recording.GetFrames()[1].functionKeys.empty());
+
+		Camera replayed{ Vector3{ 0.f, 3.f, -9.f }, 45.f };
+		replayed.ApplyInput(loaded.input, loaded.elapsedTime);
+		EXPECT_TRUE(InputRecording::ApplyPose(loaded, replayed));
+		EXPECT_FALSE(InputRecording::ApplyPose(recording.GetFrames()[1], replayed));
+		EXPECT_EQ(Vector3{}.z, replayed.origin.z);
+	}
+
+	TEST(RenderThread, FramesAreWholeAndInOrder) {
+		// Every frame fills its buffer with its number, the presenting side must never see two numbers in one frame
+		constexpr uint32_t amountOfFrames{ 200 };
+		uint32_t renderedFrames{ 0 };
+		bool isCommandRun{ false };
+		CameraInput firstInput{};
+		RenderThread renderThread{ 4, 4, [&](uint32_t* pPixels, const CameraInput& input)
+			{
+				if (renderedFrames == 0)
+					firstInput = input;
+				EXPECT_TRUE(isCommandRun);
+				std::fill_n(pPixels, 16, ++renderedFrames);
+				return renderedFrames < amountOfFrames;
+			} };
+
+		CameraInput input{};
+		input.isMovingLeft = true;
+		input.mouseX = 2;
+		renderThread.PublishInput(input);
+		input.mouseY = -1;
+		renderThread.PublishInput(input);
+		renderThread.Post([&] { isCommandRun = true; });
+		renderThread.Start();
+
+		uint32_t lastPresented{ 0 };
+		for (bool isRendering = true; isRendering;)
+		{
+			isRendering = renderThread.IsRunning();
+			if (const uint32_t* pPixels = renderThread.AcquireFrame())
+			{
+				EXPECT_GT(pPixels[0], lastPresented);
+				EXPECT_TRUE(std::all_of(pPixels, pPixels + 16, [&](uint32_t pixel) { return pixel == pPixels[0]; }));
+				lastPresented = pPixels[0];
+			}
+		}
+		renderThread.Stop();
+
+		EXPECT_EQ(amountOfFrames, lastPresented);
+		EXPECT_TRUE(firstInput.isMovingLeft);
+		EXPECT_FALSE(firstInput.isMovingForward);
+		EXPECT_EQ(4, firstInput.mouseX);
+		EXPECT_EQ(-1, firstInput.mouseY);
+	}
+
+#if !defined(_WIN32)
+	TEST(SharedFrameRing, SeqlockRead) {
+		SharedFrameRing writer{};
+		const std::string name = "/raytracer_test_" + std::to_string(getpid());
+		ASSERT_TRUE(writer.Create(name, 4, 2, 2));
+
+		SharedFrameRing reader{};
+		ASSERT_TRUE(reader.Open(name));
+		EXPECT_FALSE(reader.ReadLatest([](const SharedFrameRing::FrameInfo&, const uint32_t*) {}));
+
+		const std::vector<uint32_t> first(8, 0xFF112233), second(8, 0xFF445566);
+		EXPECT_FALSE(writer.Publish(first.data(), 5, 2, 16, 8, 0, 1.f));
+		ASSERT_TRUE(writer.Publish(first.data(), 4, 2, 16, 8, 0, 1.f));
+		ASSERT_TRUE(writer.Publish(second.data(), 4, 2, 16, 8, 0, 2.f));
+
+		// The reader sees the newest frame in place
+		EXPECT_TRUE(reader.ReadLatest([&](const SharedFrameRing::FrameInfo& info, const uint32_t* pPixels)
+			{
+				EXPECT_EQ(2u, info.frameNumber);
+				EXPECT_EQ(16u, info.stride);
+				EXPECT_EQ(2.f, info.renderMs);
+				EXPECT_EQ(second, std::vector<uint32_t>(pPixels, pPixels + 8));
+			}));
+
+		// The writer never waits: going around the ring into the slot being read makes that read fail
+		EXPECT_FALSE(reader.ReadLatest([&](const SharedFrameRing::FrameInfo&, const uint32_t*)
+			{
+				writer.Publish(first.data(), 4, 2, 16, 8, 0, 3.f);
+				writer.Publish(first.data(), 4, 2, 16, 8, 0, 4.f);
+			}));
+		EXPECT_EQ(4u, reader.GetLatestFrame());
+	}
+#endif
+
 	int main(int argc, char** argv) {
 		::testing::InitGoogleTest(&argc, argv);
 		return RUN_ALL_TESTS();
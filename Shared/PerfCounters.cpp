@@ -0,0 +1,385 @@
+#include "PerfCounters.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+using namespace dae;
+
+namespace
+{
+	constexpr size_t g_AmountOfCounters{ 5 };
+	using CounterArray = std::array<uint64_t, g_AmountOfCounters>;
+
+	//One batch in this many is sampled, the others are charged to g_UnsampledStage until Collect spreads them
+	constexpr uint32_t g_BatchSampleInterval{ 16 };
+	constexpr uint32_t g_UnsampledStage{ static_cast<uint32_t>(g_MaxPerfStages) };
+
+	struct ThreadCounters
+	{
+		uint32_t threadId{};
+		std::array<PerfCounterValues, g_MaxPerfStages + 1> stages{}; //the last one is g_UnsampledStage
+		PerfCounters::StageValues sampledStages{}; //what the sampled batches counted, also in stages
+		uint32_t stage{ 0 };
+		uint32_t amountOfBatches{ 0 };
+		bool isInSampledBatch{ false };
+		CounterArray lastValues{};
+		bool isOpen{ false };
+#if defined(__linux__)
+		std::array<int, g_AmountOfCounters> fds{ -1, -1, -1, -1, -1 };
+		std::array<perf_event_mmap_page*, g_AmountOfCounters> pages{};
+#endif
+	};
+
+	//Counts outlive their thread so Collect still sees them, the counters themselves are closed with the thread
+	std::mutex g_CountersMutex{};
+	std::vector<std::unique_ptr<ThreadCounters>> g_Counters{};
+	std::vector<std::string> g_StageNames{};
+
+#if defined(__linux__)
+	perf_event_attr CreateAttributes(uint32_t type, uint64_t config)
+	{
+		perf_event_attr attributes{};
+		attributes.size = sizeof(perf_event_attr);
+		attributes.type = type;
+		attributes.config = config;
+		attributes.exclude_kernel = 1; //allowed without privileges up to perf_event_paranoid 2
+		attributes.exclude_hv = 1;
+		return attributes;
+	}
+
+	//Opens the counters of the calling thread as one group, so they are scheduled on the PMU together
+	bool OpenCounters(ThreadCounters& counters, int& error)
+	{
+		const perf_event_attr attributes[g_AmountOfCounters]
+		{
+			CreateAttributes(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES),
+			CreateAttributes(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS),
+			CreateAttributes(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)),
+			CreateAttributes(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES),
+			CreateAttributes(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES),
+		};
+
+		const long pageSize = sysconf(_SC_PAGESIZE);
+		for (size_t index{ 0 }; index < g_AmountOfCounters; ++index)
+		{
+			perf_event_attr eventAttributes = attributes[index];
+			const int groupFd = index == 0 ? -1 : counters.fds[0];
+			counters.fds[index] = static_cast<int>(syscall(SYS_perf_event_open, &eventAttributes, 0, -1, groupFd, 0));
+			if (counters.fds[index] < 0)
+			{
+				//Without cycles nothing is worth counting, a missing cache event only leaves its column at 0
+				if (index == 0)
+				{
+					error = errno;
+					return false;
+				}
+				continue;
+			}
+
+			void* pPage = mmap(nullptr, pageSize, PROT_READ, MAP_SHARED, counters.fds[index], 0);
+			counters.pages[index] = pPage == MAP_FAILED ? nullptr : static_cast<perf_event_mmap_page*>(pPage);
+		}
+		return true;
+	}
+
+	void CloseCounters(ThreadCounters& counters)
+	{
+		const long pageSize = sysconf(_SC_PAGESIZE);
+		for (size_t index{ 0 }; index < g_AmountOfCounters; ++index)
+		{
+			if (counters.pages[index]) munmap(counters.pages[index], pageSize);
+			if (counters.fds[index] >= 0) close(counters.fds[index]);
+			counters.pages[index] = nullptr;
+			counters.fds[index] = -1;
+		}
+		counters.isOpen = false;
+	}
+
+	//rdpmc straight from user space when the kernel allows it and the counter is on the PMU right now
+	uint64_t ReadCounter(int fd, const perf_event_mmap_page* pPage)
+	{
+		if (fd < 0)
+			return 0;
+
+#if defined(__x86_64__) || defined(__i386__)
+		if (pPage && pPage->cap_user_rdpmc)
+		{
+			const volatile perf_event_mmap_page* pSharedPage = pPage;
+			uint32_t sequence{}, counterIndex{};
+			uint64_t value{};
+			do
+			{
+				sequence = pSharedPage->lock;
+				std::atomic_signal_fence(std::memory_order_seq_cst);
+				counterIndex = pSharedPage->index;
+				value = pSharedPage->offset;
+				if (counterIndex != 0)
+				{
+					const uint32_t width = pSharedPage->pmc_width;
+					const int64_t count = static_cast<int64_t>(__builtin_ia32_rdpmc(static_cast<int>(counterIndex) - 1) << (64 - width)) >> (64 - width);
+					value += static_cast<uint64_t>(count);
+				}
+				std::atomic_signal_fence(std::memory_order_seq_cst);
+			} while (pSharedPage->lock != sequence);
+
+			if (counterIndex != 0)
+				return value;
+		}
+#else
+		(void)pPage;
+#endif
+
+		uint64_t value{};
+		return read(fd, &value, sizeof(value)) == sizeof(value) ? value : 0;
+	}
+
+	CounterArray ReadCounters(const ThreadCounters& counters)
+	{
+		CounterArray values{};
+		for (size_t index{ 0 }; index < g_AmountOfCounters; ++index)
+			values[index] = ReadCounter(counters.fds[index], counters.pages[index]);
+		return values;
+	}
+#endif
+
+	//Adds unsampled to stages in the proportions of sampled, counter by counter
+	void SpreadUnsampled(const PerfCounterValues& unsampled, const PerfCounters::StageValues& sampled, PerfCounters::StageValues& stages)
+	{
+		for (uint64_t PerfCounterValues::* pCounter : { &PerfCounterValues::cycles, &PerfCounterValues::instructions,
+			&PerfCounterValues::l1dMisses, &PerfCounterValues::llcMisses, &PerfCounterValues::branchMisses })
+		{
+			uint64_t total{ 0 };
+			size_t largestStage{ 0 };
+			for (size_t stage{ 0 }; stage < sampled.size(); ++stage)
+			{
+				total += sampled[stage].*pCounter;
+				if (sampled[stage].*pCounter > sampled[largestStage].*pCounter) largestStage = stage;
+			}
+
+			//Nothing sampled to go by: other; rounding leftovers go to the biggest stage
+			uint64_t remaining = unsampled.*pCounter;
+			for (size_t stage{ 0 }; stage < sampled.size() && total > 0; ++stage)
+			{
+				const uint64_t share = static_cast<uint64_t>(static_cast<double>(unsampled.*pCounter) * sampled[stage].*pCounter / total);
+				stages[stage].*pCounter += std::min(share, remaining);
+				remaining -= std::min(share, remaining);
+			}
+			stages[largestStage].*pCounter += remaining;
+		}
+	}
+
+	//Closes the thread's counters when it ends, its counts stay in g_Counters
+	struct ThreadCountersOwner
+	{
+		ThreadCounters* pCounters{ nullptr };
+		int openError{ 0 };
+
+		~ThreadCountersOwner()
+		{
+#if defined(__linux__)
+			if (pCounters) CloseCounters(*pCounters);
+#endif
+		}
+	};
+	thread_local ThreadCountersOwner t_Owner{};
+
+	ThreadCounters& GetThreadCounters()
+	{
+		if (!t_Owner.pCounters)
+		{
+			auto pCounters = std::make_unique<ThreadCounters>();
+#if defined(__linux__)
+			pCounters->isOpen = OpenCounters(*pCounters, t_Owner.openError);
+			if (pCounters->isOpen)
+				pCounters->lastValues = ReadCounters(*pCounters);
+			else
+				CloseCounters(*pCounters);
+#endif
+			const std::lock_guard lock{ g_CountersMutex };
+			pCounters->threadId = static_cast<uint32_t>(g_Counters.size()) + 1;
+			t_Owner.pCounters = pCounters.get();
+			g_Counters.emplace_back(std::move(pCounters));
+		}
+		return *t_Owner.pCounters;
+	}
+}
+
+bool PerfCounters::Enable(std::span<const char* const> stageNames)
+{
+	{
+		const std::lock_guard lock{ g_CountersMutex };
+		g_StageNames.assign(stageNames.begin(), stageNames.begin() + std::min(stageNames.size(), g_MaxPerfStages));
+	}
+
+#if defined(__linux__)
+	if (!GetThreadCounters().isOpen)
+	{
+		std::cout << "Hardware counters unavailable: " << std::strerror(t_Owner.openError)
+			<< " (check /proc/sys/kernel/perf_event_paranoid, virtual machines often have no PMU)" << std::endl;
+		return false;
+	}
+	s_IsEnabled.store(true, std::memory_order_relaxed);
+	return true;
+#else
+	std::cout << "Hardware counters need Linux (perf_event_open)" << std::endl;
+	return false;
+#endif
+}
+
+void PerfCounters::Disable()
+{
+	s_IsEnabled.store(false, std::memory_order_relaxed);
+}
+
+uint32_t PerfCounters::SwitchStage(uint32_t stage)
+{
+	ThreadCounters& counters = GetThreadCounters();
+	const uint32_t previous = counters.stage;
+	counters.stage = stage;
+
+#if defined(__linux__)
+	if (counters.isOpen)
+	{
+		const CounterArray values = ReadCounters(counters);
+		PerfCounterValues delta{};
+		delta.cycles = values[0] - counters.lastValues[0];
+		delta.instructions = values[1] - counters.lastValues[1];
+		delta.l1dMisses = values[2] - counters.lastValues[2];
+		delta.llcMisses = values[3] - counters.lastValues[3];
+		delta.branchMisses = values[4] - counters.lastValues[4];
+		counters.lastValues = values;
+
+		counters.stages[previous] += delta;
+		if (counters.isInSampledBatch)
+			counters.sampledStages[previous] += delta;
+	}
+#endif
+	return previous;
+}
+
+uint32_t PerfCounters::BeginBatch(uint32_t stage)
+{
+	ThreadCounters& counters = GetThreadCounters();
+	const bool isSampled = counters.amountOfBatches++ % g_BatchSampleInterval == 0;
+
+	const uint32_t previous = SwitchStage(isSampled ? stage : g_UnsampledStage);
+	counters.isInSampledBatch = isSampled;
+	t_IsSampling = isSampled;
+	return previous;
+}
+
+void PerfCounters::EndBatch(uint32_t previousStage)
+{
+	SwitchStage(previousStage);
+	GetThreadCounters().isInSampledBatch = false;
+	t_IsSampling = true;
+}
+
+std::vector<PerfCounters::ThreadReport> PerfCounters::Collect()
+{
+	std::vector<ThreadReport> reports{};
+
+	const std::lock_guard lock{ g_CountersMutex };
+
+	//Proportions of every thread's sampled batches together, a single thread samples too few of them
+	StageValues sampled{};
+	for (const auto& pCounters : g_Counters)
+	{
+		for (size_t stage{ 0 }; stage < sampled.size(); ++stage)
+			sampled[stage] += pCounters->sampledStages[stage];
+	}
+
+	for (const auto& pCounters : g_Counters)
+	{
+		bool hasCounts{ false };
+		for (const PerfCounterValues& values : pCounters->stages)
+			hasCounts = hasCounts || values.cycles != 0;
+		if (!hasCounts)
+			continue;
+
+		ThreadReport& report = reports.emplace_back(ThreadReport{ pCounters->threadId });
+		std::copy_n(pCounters->stages.begin(), g_MaxPerfStages, report.stages.begin());
+		SpreadUnsampled(pCounters->stages[g_UnsampledStage], sampled, report.stages);
+		pCounters->stages = {};
+		pCounters->sampledStages = {};
+	}
+	return reports;
+}
+
+PerfCounters::StageValues PerfCounters::GetTotal(const std::vector<ThreadReport>& reports)
+{
+	StageValues total{};
+	for (const ThreadReport& report : reports)
+	{
+		for (size_t stage{ 0 }; stage < total.size(); ++stage)
+			total[stage] += report.stages[stage];
+	}
+	return total;
+}
+
+const char* PerfCounters::GetStageName(uint32_t stage)
+{
+	return stage < g_StageNames.size() ? g_StageNames[stage].c_str() : "other";
+}
+
+void PerfCounters::WriteReport(std::ostream& output, const std::vector<ThreadReport>& reports)
+{
+	const auto writeRow = [&output](const char* name, const PerfCounterValues& values)
+		{
+			output << std::left << std::setw(14) << name << std::right
+				<< std::setw(14) << values.cycles << std::setw(14) << values.instructions
+				<< std::setw(7) << std::fixed << std::setprecision(2) << values.GetInstructionsPerCycle() << std::defaultfloat
+				<< std::setw(13) << values.l1dMisses << std::setw(13) << values.llcMisses << std::setw(13) << values.branchMisses << "\n";
+		};
+
+	output << std::left << std::setw(14) << "stage" << std::right << std::setw(14) << "cycles" << std::setw(14) << "instructions"
+		<< std::setw(7) << "IPC" << std::setw(13) << "L1D misses" << std::setw(13) << "LLC misses" << std::setw(13) << "br misses" << "\n";
+
+	const StageValues total = GetTotal(reports);
+	for (size_t stage{ 0 }; stage < std::max<size_t>(g_StageNames.size(), 1); ++stage)
+		writeRow(GetStageName(static_cast<uint32_t>(stage)), total[stage]);
+
+	//Reports of several frames can be passed at once, a thread gets one line
+	std::map<uint32_t, PerfCounterValues> threadTotals{};
+	for (const ThreadReport& report : reports)
+	{
+		for (const PerfCounterValues& values : report.stages)
+			threadTotals[report.threadId] += values;
+	}
+	for (const auto& [threadId, values] : threadTotals)
+		writeRow(("thread " + std::to_string(threadId)).c_str(), values);
+}
+
+void PerfCounters::WriteCsvHeader(std::ostream& output)
+{
+	output << "frame,frame ms,thread,stage,cycles,instructions,IPC,L1D misses,LLC misses,branch misses\n";
+}
+
+void PerfCounters::WriteCsv(std::ostream& output, uint32_t frame, float frameMs, const std::vector<ThreadReport>& reports)
+{
+	for (const ThreadReport& report : reports)
+	{
+		for (size_t stage{ 0 }; stage < std::max<size_t>(g_StageNames.size(), 1); ++stage)
+		{
+			const PerfCounterValues& values = report.stages[stage];
+			output << frame << "," << frameMs << "," << report.threadId << "," << GetStageName(static_cast<uint32_t>(stage)) << ","
+				<< values.cycles << "," << values.instructions << "," << values.GetInstructionsPerCycle() << ","
+				<< values.l1dMisses << "," << values.llcMisses << "," << values.branchMisses << "\n";
+		}
+	}
+}
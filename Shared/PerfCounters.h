@@ -0,0 +1,139 @@
+#pragma once
+
+//Standard includes
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	//A renderer numbers the stages of its work from 1 (0 is everything outside a PerfStageScope) and names them in Enable
+	constexpr size_t g_MaxPerfStages{ 8 };
+
+	struct PerfCounterValues
+	{
+		uint64_t cycles{};
+		uint64_t instructions{};
+		uint64_t l1dMisses{}; //L1 data cache read misses
+		uint64_t llcMisses{}; //last level cache misses
+		uint64_t branchMisses{};
+
+		PerfCounterValues& operator+=(const PerfCounterValues& other)
+		{
+			cycles += other.cycles;
+			instructions += other.instructions;
+			l1dMisses += other.l1dMisses;
+			llcMisses += other.llcMisses;
+			branchMisses += other.branchMisses;
+			return *this;
+		}
+
+		float GetInstructionsPerCycle() const { return cycles ? static_cast<float>(instructions) / cycles : 0.f; }
+	};
+
+	/**
+	 * \brief Hardware counters (perf_event_open, Linux only) charged to the render stage a thread is in. Every thread
+	 * opens its own counters the first time it switches stage and reads them with rdpmc where the kernel allows it,
+	 * a read() per counter otherwise. While disabled a stage switch is a single relaxed load.
+	 * Stages switched per pixel or per ray would cost more than the work they measure, so that work runs in batches
+	 * (PerfBatchScope) and only a sample of the batches switches stage inside, see Collect.
+	 */
+	class PerfCounters final
+	{
+	public:
+		using StageValues = std::array<PerfCounterValues, g_MaxPerfStages>;
+		struct ThreadReport
+		{
+			uint32_t threadId{};
+			StageValues stages{};
+		};
+
+		PerfCounters() = delete;
+
+		//Names of the stages from 0 up. False with the reason on the console when the kernel (or the platform) has no
+		//counters for us
+		static bool Enable(std::span<const char* const> stageNames);
+		static void Disable();
+		static bool IsEnabled() { return s_IsEnabled.load(std::memory_order_relaxed); }
+		//False on a thread that is running a batch that isn't sampled
+		static bool IsSampling() { return t_IsSampling; }
+
+		//Charges what this thread did since its last switch to the stage it was in, returns that stage
+		static uint32_t SwitchStage(uint32_t stage);
+		//Every g_BatchSampleInterval'th batch a thread runs is sampled: it's charged to stage, with the stages switched
+		//inside it. The others are charged to none until Collect. Returns the stage to end the batch with
+		static uint32_t BeginBatch(uint32_t stage);
+		static void EndBatch(uint32_t previousStage);
+
+		//Every thread's counts since the last call, then starts again from zero. Call it between frames.
+		//What the batches that weren't sampled counted is spread over the stages in the proportions the sampled ones had
+		static std::vector<ThreadReport> Collect();
+		static StageValues GetTotal(const std::vector<ThreadReport>& reports);
+
+		static const char* GetStageName(uint32_t stage);
+		//A line per stage summed over the threads, then a line per thread
+		static void WriteReport(std::ostream& output, const std::vector<ThreadReport>& reports);
+		static void WriteCsvHeader(std::ostream& output);
+		//A row per thread and stage
+		static void WriteCsv(std::ostream& output, uint32_t frame, float frameMs, const std::vector<ThreadReport>& reports);
+
+	private:
+		static inline std::atomic<bool> s_IsEnabled{ false };
+		static inline thread_local bool t_IsSampling{ true };
+	};
+
+	class PerfStageScope final
+	{
+	public:
+		template<typename Stage>
+		explicit PerfStageScope(Stage stage) :
+			m_IsActive{ PerfCounters::IsEnabled() && PerfCounters::IsSampling() },
+			m_Previous{ m_IsActive ? PerfCounters::SwitchStage(static_cast<uint32_t>(stage)) : 0 }
+		{
+		}
+		~PerfStageScope()
+		{
+			if (m_IsActive)
+				PerfCounters::SwitchStage(m_Previous);
+		}
+
+		PerfStageScope(const PerfStageScope&) = delete;
+		PerfStageScope(PerfStageScope&&) noexcept = delete;
+		PerfStageScope& operator=(const PerfStageScope&) = delete;
+		PerfStageScope& operator=(PerfStageScope&&) noexcept = delete;
+
+	private:
+		bool m_IsActive;
+		uint32_t m_Previous;
+	};
+
+	//A tile, a triangle: work charged to stage as a whole, see PerfCounters::BeginBatch
+	class PerfBatchScope final
+	{
+	public:
+		template<typename Stage>
+		explicit PerfBatchScope(Stage stage) :
+			m_IsActive{ PerfCounters::IsEnabled() },
+			m_Previous{ m_IsActive ? PerfCounters::BeginBatch(static_cast<uint32_t>(stage)) : 0 }
+		{
+		}
+		~PerfBatchScope()
+		{
+			if (m_IsActive)
+				PerfCounters::EndBatch(m_Previous);
+		}
+
+		PerfBatchScope(const PerfBatchScope&) = delete;
+		PerfBatchScope(PerfBatchScope&&) noexcept = delete;
+		PerfBatchScope& operator=(const PerfBatchScope&) = delete;
+		PerfBatchScope& operator=(PerfBatchScope&&) noexcept = delete;
+
+	private:
+		bool m_IsActive;
+		uint32_t m_Previous;
+	};
+}
@@ -0,0 +1,138 @@
+#include "Trace.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace dae;
+
+namespace
+{
+	struct TraceEvent
+	{
+		const char* name{};
+		int64_t startNs{};
+		int64_t endNs{};
+	};
+
+	//Only its own thread writes to a buffer, Stop reads what was published through amountWritten
+	struct ThreadBuffer
+	{
+		uint32_t threadId{};
+		std::string name{};
+		std::vector<TraceEvent> events{};
+		std::atomic<uint64_t> amountWritten{ 0 };
+	};
+
+	constexpr size_t g_EventsPerThread{ 1 << 16 };
+
+	//Buffers live until exit, a thread can end before the recording is saved
+	std::mutex g_BuffersMutex{};
+	std::vector<std::unique_ptr<ThreadBuffer>> g_Buffers{};
+	thread_local ThreadBuffer* t_pBuffer{ nullptr };
+
+	const std::chrono::steady_clock::time_point g_Epoch{ std::chrono::steady_clock::now() };
+
+	ThreadBuffer& GetThreadBuffer()
+	{
+		if (!t_pBuffer)
+		{
+			auto pBuffer = std::make_unique<ThreadBuffer>();
+			pBuffer->events.resize(g_EventsPerThread);
+
+			const std::lock_guard lock{ g_BuffersMutex };
+			pBuffer->threadId = static_cast<uint32_t>(g_Buffers.size()) + 1;
+			t_pBuffer = pBuffer.get();
+			g_Buffers.emplace_back(std::move(pBuffer));
+		}
+		return *t_pBuffer;
+	}
+
+	void WriteString(std::ostream& output, const std::string& text)
+	{
+		output << '"';
+		for (const char character : text)
+		{
+			if (character == '"' || character == '\\') output << '\\';
+			output << character;
+		}
+		output << '"';
+	}
+}
+
+void Trace::Start()
+{
+	{
+		const std::lock_guard lock{ g_BuffersMutex };
+		for (const auto& pBuffer : g_Buffers)
+			pBuffer->amountWritten.store(0, std::memory_order_relaxed);
+	}
+	s_IsRecording.store(true, std::memory_order_relaxed);
+}
+
+bool Trace::Stop(const std::string& filename)
+{
+	s_IsRecording.store(false, std::memory_order_relaxed);
+
+	std::ofstream file{ filename };
+	if (!file)
+		return false;
+
+	//Chrome trace-event format, complete ("X") events with microsecond timestamps
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << std::fixed << std::setprecision(3);
+	bool isFirst{ true };
+	const auto separate = [&] { file << (isFirst ? "" : ",\n"); isFirst = false; };
+
+	const std::lock_guard lock{ g_BuffersMutex };
+	for (const auto& pBuffer : g_Buffers)
+	{
+		const uint64_t amountWritten = pBuffer->amountWritten.load(std::memory_order_acquire);
+		if (amountWritten == 0)
+			continue;
+
+		if (!pBuffer->name.empty())
+		{
+			separate();
+			file << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << pBuffer->threadId << ",\"args\":{\"name\":";
+			WriteString(file, pBuffer->name);
+			file << "}}";
+		}
+
+		for (uint64_t index = amountWritten > g_EventsPerThread ? amountWritten - g_EventsPerThread : 0; index < amountWritten; ++index)
+		{
+			const TraceEvent& event = pBuffer->events[index % g_EventsPerThread];
+			separate();
+			file << "{\"ph\":\"X\",\"name\":";
+			WriteString(file, event.name);
+			file << ",\"pid\":1,\"tid\":" << pBuffer->threadId << ",\"ts\":" << event.startNs / 1000.0
+				<< ",\"dur\":" << (event.endNs - event.startNs) / 1000.0 << "}";
+		}
+	}
+	file << "\n]}\n";
+	return static_cast<bool>(file);
+}
+
+void Trace::SetThreadName(const char* name)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+	const std::lock_guard lock{ g_BuffersMutex };
+	if (buffer.name.empty())
+		buffer.name = name;
+}
+
+void Trace::Record(const char* name, int64_t startNs, int64_t endNs)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+	const uint64_t index = buffer.amountWritten.load(std::memory_order_relaxed);
+	buffer.events[index % g_EventsPerThread] = TraceEvent{ name, startNs, endNs };
+	buffer.amountWritten.store(index + 1, std::memory_order_release);
+}
+
+int64_t Trace::GetTimeNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_Epoch).count();
+}
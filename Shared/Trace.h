@@ -0,0 +1,65 @@
+#pragma once
+
+//Standard includes
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace dae
+{
+	/**
+	 * \brief Timeline of scoped markers, saved as Chrome trace-event JSON (open it in Perfetto or chrome://tracing).
+	 * Every thread records into a ring buffer of its own, when it wraps only the newest events are kept.
+	 * While nothing is recording a marker costs a single relaxed load.
+	 */
+	class Trace final
+	{
+	public:
+		Trace() = delete;
+
+		//Forgets everything recorded so far, call it while no marker is open on another thread
+		static void Start();
+		//Stops recording and writes every thread's events, false if the file can't be written
+		static bool Stop(const std::string& filename);
+		static bool IsRecording() { return s_IsRecording.load(std::memory_order_relaxed); }
+
+		//Shown instead of the thread id, the first name a thread gets sticks
+		static void SetThreadName(const char* name);
+
+		//name has to outlive the recording, markers use string literals
+		static void Record(const char* name, int64_t startNs, int64_t endNs);
+		static int64_t GetTimeNs();
+
+	private:
+		static inline std::atomic<bool> s_IsRecording{ false };
+	};
+
+	class TraceScope final
+	{
+	public:
+		explicit TraceScope(const char* name) :
+			m_Name{ Trace::IsRecording() ? name : nullptr },
+			m_StartNs{ m_Name ? Trace::GetTimeNs() : 0 }
+		{
+		}
+		~TraceScope()
+		{
+			if (m_Name)
+				Trace::Record(m_Name, m_StartNs, Trace::GetTimeNs());
+		}
+
+		TraceScope(const TraceScope&) = delete;
+		TraceScope(TraceScope&&) noexcept = delete;
+		TraceScope& operator=(const TraceScope&) = delete;
+		TraceScope& operator=(TraceScope&&) noexcept = delete;
+
+	private:
+		const char* m_Name;
+		int64_t m_StartNs;
+	};
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+//Times the rest of the enclosing scope
+#define TRACE_SCOPE(name) const dae::TraceScope TRACE_CONCAT(traceScope, __LINE__){ name }